@@ -8,42 +8,1542 @@
  #include <iostream>
  #include <sqlite3.h>
  #include <string>
+ #include <string_view>
  #include <limits>
+ #include <map>
+ #include <unordered_map>
+ #include <deque>
+ #include <queue>
+ #include <list>
+ #include <vector>
+ #include <mutex>
+ #include <chrono>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <fstream>
+ #include <sstream>
+ #include <algorithm>
+ #include <random>
+ #include <thread>
+ #include <atomic>
+ #include <condition_variable>
+ #include <csignal>
+ #include <cstring>
+ #include <cerrno>
+ #include <cmath>
+ #include <cctype>
+ #include <charconv>
+ #include <memory>
+ #include <functional>
+ #include <optional>
+ #include <type_traits>
+ #include <utility>
+ #include <tuple>
+ #include <cassert>
+ #include <sys/socket.h>
+ #include <sys/un.h>
+ #include <netinet/in.h>
+ #include <arpa/inet.h>
+ #include <poll.h>
+ #include <unistd.h>
+ #include <sys/resource.h>
+ #include <sys/stat.h>
+ #include <sys/file.h>
+ #include <sys/mman.h>
+ #include <fcntl.h>
+ #ifdef __linux__
+ #include <sys/syscall.h>
+ #endif
+ #ifdef __APPLE__
+ #include <pthread/qos.h>
+ #endif
+ #if defined(__SSE2__)
+ #include <emmintrin.h>
+ #elif defined(__ARM_NEON)
+ #include <arm_neon.h>
+ #endif
  
  using namespace std;
+
+// Cache of compiled statements for one connection, keyed by SQL text
+struct StatementCache {
+    struct Entry {
+        sqlite3_stmt* stmt;
+        bool inUse;
+    };
+    unordered_map<string_view, Entry> entries; // Keys point into sqlText
+    deque<string> sqlText;                      // Owns the SQL text for the keys
+    long long hits = 0;
+    long long misses = 0;
+    bool enabled = true;                        // When false every borrow prepares a fresh statement
+};
+
+// Borrows a statement from the connection's cache and hands it back (reset, bindings cleared) when done
+class CachedStatement {
+public:
+    CachedStatement(sqlite3* db, const char* sql);
+    ~CachedStatement() { release(); }
+    CachedStatement(const CachedStatement&) = delete;
+    CachedStatement& operator=(const CachedStatement&) = delete;
+
+    operator sqlite3_stmt*() const { return stmt; }
+    void release(); // Return the statement early, e.g. before waiting on user input
+
+private:
+    StatementCache::Entry* entry = nullptr; // Null when the statement is not cached
+    sqlite3_stmt* stmt = nullptr;
+};
+
+// Typed parameters and result columns for a cached statement, picked at compile time from the C++ types:
+// int, sqlite3_int64, double, string_view and optional<T> (NULL). Text is bound without a copy, and text
+// columns are string_views into SQLite's row buffer, valid only until the row callback returns; a NULL
+// column reads as 0 or an empty view unless it is read as an optional
+inline void bindValue(sqlite3_stmt* stmt, int index, int value) { sqlite3_bind_int(stmt, index, value); }
+inline void bindValue(sqlite3_stmt* stmt, int index, sqlite3_int64 value) { sqlite3_bind_int64(stmt, index, value); }
+inline void bindValue(sqlite3_stmt* stmt, int index, double value) { sqlite3_bind_double(stmt, index, value); }
+inline void bindValue(sqlite3_stmt* stmt, int index, string_view value) {
+    // Static: the caller's text outlives the run, and the statement is reset before it returns
+    sqlite3_bind_text(stmt, index, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+}
+template <typename T>
+void bindValue(sqlite3_stmt* stmt, int index, const optional<T>& value) {
+    if (value) bindValue(stmt, index, *value);
+    else sqlite3_bind_null(stmt, index);
+}
+
+template <typename T> struct ColumnReader;
+template <> struct ColumnReader<int> {
+    static int read(sqlite3_stmt* stmt, int column) { return sqlite3_column_int(stmt, column); }
+};
+template <> struct ColumnReader<sqlite3_int64> {
+    static sqlite3_int64 read(sqlite3_stmt* stmt, int column) { return sqlite3_column_int64(stmt, column); }
+};
+template <> struct ColumnReader<double> {
+    static double read(sqlite3_stmt* stmt, int column) { return sqlite3_column_double(stmt, column); }
+};
+// Up to the terminator SQLite adds, like the std::string copies were: strlen is cheaper here than a
+// second call (and mutex round trip) for sqlite3_column_bytes
+template <> struct ColumnReader<string_view> {
+    static string_view read(sqlite3_stmt* stmt, int column) {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+        return text ? string_view(text) : string_view();
+    }
+};
+template <typename T> struct ColumnReader<optional<T>> {
+    static optional<T> read(sqlite3_stmt* stmt, int column) {
+        if (sqlite3_column_type(stmt, column) == SQLITE_NULL) return nullopt;
+        return ColumnReader<T>::read(stmt, column);
+    }
+};
+
+// A cached statement with its parameter types (?1, ?2 ... in order) and column types, e.g.
+//   Query<tuple<int>, tuple<string_view, int>> pets(db, "SELECT pet_name, age FROM pet WHERE client_id = ?1;");
+//   pets.run(clientId, [&](string_view name, int age) { ... });
+// The row callback may return bool; false stops the query. run and exec return false on an SQLite error
+// (sqlite3_errmsg has it) and leave the statement reset, so it can be run again. The types must match the
+// statement's highest ?N and its column count, which is asserted when it is prepared
+template <typename Params, typename Columns> class Query;
+template <typename... Params, typename... Columns>
+class Query<tuple<Params...>, tuple<Columns...>> {
+public:
+    Query(sqlite3* db, const char* sql) : stmt(db, sql) {
+        assert(!stmt || (sqlite3_bind_parameter_count(stmt) == static_cast<int>(sizeof...(Params)) &&
+                         sqlite3_column_count(stmt) == static_cast<int>(sizeof...(Columns))));
+    }
+    explicit operator bool() const { return stmt != nullptr; }
+    void release() { stmt.release(); }
+
+    template <typename OnRow>
+    bool run(const Params&... params, OnRow&& onRow) {
+        bindAll(index_sequence_for<Params...>(), params...);
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            if (!deliver(onRow, index_sequence_for<Columns...>())) {
+                rc = SQLITE_DONE;
+                break;
+            }
+        }
+        sqlite3_reset(stmt);
+        return rc == SQLITE_DONE;
+    }
+
+    // For statements without rows (INSERT, UPDATE ...)
+    bool exec(const Params&... params) {
+        static_assert(sizeof...(Columns) == 0, "use run() for a statement that returns rows");
+        bindAll(index_sequence_for<Params...>(), params...);
+        int rc = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        return rc == SQLITE_DONE;
+    }
+
+private:
+    template <size_t... I>
+    void bindAll(index_sequence<I...>, const Params&... params) {
+        (bindValue(stmt, static_cast<int>(I + 1), params), ...);
+    }
+
+    template <typename OnRow, size_t... I>
+    bool deliver(OnRow& onRow, index_sequence<I...>) {
+        if constexpr (is_same_v<invoke_result_t<OnRow&, Columns...>, bool>) {
+            return onRow(ColumnReader<Columns>::read(stmt, static_cast<int>(I))...);
+        } else {
+            onRow(ColumnReader<Columns>::read(stmt, static_cast<int>(I))...);
+            return true;
+        }
+    }
+
+    CachedStatement stmt;
+};
+
+// A row formatter with typed columns, e.g. void f(ostream& out, int id, optional<string_view> name), as the
+// raw-statement function a PagedList takes: RowFormatter<f>::format reads columns 0, 1 ... like Query does
+template <auto formatter> struct RowFormatter;
+template <typename... Columns, void (*formatter)(ostream&, Columns...)>
+struct RowFormatter<formatter> {
+    static constexpr int columns = sizeof...(Columns);
+    static void format(sqlite3_stmt* stmt, ostream& out) { read(stmt, out, index_sequence_for<Columns...>()); }
+
+private:
+    template <size_t... I>
+    static void read(sqlite3_stmt* stmt, ostream& out, index_sequence<I...>) {
+        formatter(out, ColumnReader<Columns>::read(stmt, static_cast<int>(I))...);
+    }
+};
+
+const int LATENCY_BUCKETS = 128; // Quarter-octave buckets of microseconds, the last one open-ended
+
+// Latency distribution of one operation
+struct LatencyHistogram {
+    long long buckets[LATENCY_BUCKETS] = {};
+    long long count = 0;
+    double totalMicros = 0, maxMicros = 0;
+};
+
+// trace_v2 timings and sqlite3_stmt_status counters summed over every run of one SQL text
+struct QueryProfile {
+    long long runs = 0;
+    double totalMillis = 0, maxMillis = 0;
+    long long fullScanSteps = 0, sorts = 0, autoIndexes = 0, vmSteps = 0;
+};
+
+// One thread's diagnostics. Only that thread records into it, so its lock is only contended
+// while a report is merging the shards
+struct DiagnosticsShard {
+    mutex lock;
+    unordered_map<string_view, LatencyHistogram> operations; // Keys are operation name literals
+    unordered_map<string_view, QueryProfile> queries;         // Keys point into sqlText
+    deque<string> sqlText;
+};
+
+// Process-wide diagnostics: a shard per thread, merged when shown. A finished thread's shard keeps
+// its numbers and is handed to the next new thread, so short-lived threads do not pile up shards
+struct Diagnostics {
+    mutex lock; // Guards the shard lists, never held while recording
+    deque<unique_ptr<DiagnosticsShard>> shards;
+    vector<DiagnosticsShard*> idle;
+};
+
+// Records the time from construction to destruction in the named operation's histogram
+class OperationTimer {
+public:
+    explicit OperationTimer(const char* name) : name(name), start(chrono::steady_clock::now()) {}
+    ~OperationTimer();
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+
+private:
+    const char* name;
+    chrono::steady_clock::time_point start;
+};
+
+// Client fields as entered at the desk
+struct ClientRecord {
+    string name, phone, email, address;
+};
+
+// Pet fields as entered at the desk
+struct PetRecord {
+    string name, breed;
+    int age = 0;
+    string medicalCondition, dietRestriction;
+    int friendly = 1;
+    string emergencyContact;
+    int clientId = 0;
+};
+
+// One line item of a sale
+struct SaleLine {
+    int itemId;
+    int quantity;
+};
+
+// A complete sale that can be recorded without prompting
+struct Sale {
+    int clientId;
+    int employeeId;
+    int date;
+    int time;
+    string paymentMethod;
+    vector<SaleLine> items;
+};
+
+// Client row read from an import file; key is the source system's ID for that client
+struct ImportClientRow {
+    string key, name, phone, email, address;
+};
+
+// Pet row read from an import file, linked to its owner through the owner's import key
+struct ImportPetRow {
+    string clientKey, name, breed, age, medicalCondition, dietRestriction, friendly, emergencyContact;
+    long long lineNumber;
+};
+
+// State of one running client/pet import
+struct ClientImport {
+    sqlite3* db = nullptr;
+    vector<ImportClientRow> clients;                  // Rows waiting for the next multi-row INSERT
+    vector<ImportPetRow> pets;
+    unordered_map<string, sqlite3_int64> clientIds;   // Import key -> new client_id
+    long long clientCount = 0, petCount = 0, rejected = 0;
+};
+
+const size_t IMPORT_ROWS_PER_INSERT = 200; // Rows per multi-row INSERT statement
+
+// Connection settings chosen with --profile and applied to every connection the program opens on the
+// database. Sized for a kennel database of up to a few hundred MB (about 10M ledger rows)
+struct TuningProfile {
+    const char* name;
+    int cacheKib;            // Page cache per connection
+    long long mmapBytes;     // How much of the file reads may map instead of copying through the cache
+    bool foreignKeys;        // Enforce the schema's FOREIGN KEY clauses
+    int sorterThreads;       // Helper threads for large sorts (CREATE INDEX, ORDER BY on big results)
+    const char* description;
+};
+
+const TuningProfile TUNING_PROFILES[] = {
+    {"interactive", 16384, 256LL << 20, true, 0, "menu and server: modest cache per connection, foreign keys checked"},
+    {"reporting", 131072, 1LL << 30, true, 2, "reports and exports: large cache and mmap, sorts use helper threads"},
+    {"bulk-load", 262144, 0, false, 2, "imports: large cache for index building, the loader links rows itself"},
+};
+
+// The profile chosen at startup; main picks one by mode when --profile is not given
+static const TuningProfile* activeTuningProfile = &TUNING_PROFILES[0];
+
+const int MAINTENANCE_ANALYSIS_LIMIT = 1000; // Rows ANALYZE samples per index, which bounds each table's slice
+
+// How interactive writes reach the disk. FULL fsyncs every write's commit; NORMAL (in WAL mode) leaves
+// the fsync to the next checkpoint, so a power cut can lose the last writes but never corrupts;
+// BATCHED commits queued writes in groups with one fsync per group
+enum Durability {
+    DURABILITY_FULL,
+    DURABILITY_NORMAL,
+    DURABILITY_BATCHED
+};
+
+const int GROUP_COMMIT_MS = 4;              // A group is committed at most this long after its first write,
+const int GROUP_COMMIT_IDLE_US = 200;       // ...or once no write has arrived for this long,
+const size_t GROUP_COMMIT_WRITES = 64;      // ...or as soon as it holds this many
+
+// One write: runs on the writer connection and returns false to undo just itself
+using WriteOperation = function<bool(sqlite3*)>;
+
+// Every write of a process goes through one of these, on one connection guarded by dbMutex.
+// In FULL and NORMAL a write is its own transaction, run on the caller's thread. In BATCHED a
+// thread takes the queued writes, runs each under its own savepoint and commits them together
+class GroupCommitWriter {
+public:
+    GroupCommitWriter(sqlite3* db, mutex& dbMutex, Durability durability);
+    ~GroupCommitWriter();
+    GroupCommitWriter(const GroupCommitWriter&) = delete;
+    GroupCommitWriter& operator=(const GroupCommitWriter&) = delete;
+
+    bool run(WriteOperation apply);                                // Returns once committed: true if it was
+    void post(WriteOperation apply, function<void(bool)> done);    // Returns once queued; done gets the outcome
+    void flush();                                                  // Waits for every write posted so far
+    void shutdown();                                               // Flushes and stops the commit thread
+    Durability durability() const { return mode; }
+
+private:
+    struct QueuedWrite {
+        WriteOperation apply;
+        function<void(bool)> done;
+    };
+    void commitLoop();
+
+    sqlite3* db;
+    mutex& dbMutex;
+    Durability mode;
+    mutex queueMutex;
+    condition_variable queueReady;
+    condition_variable queueDrained;
+    deque<QueuedWrite> queue;
+    size_t inFlight = 0;             // Writes taken off the queue but not yet committed
+    bool stopping = false;
+    thread worker;
+};
+
+// Grooming days are split into 15-minute slots from 06:00 to 22:00, one bit each in a 64-bit word
+const int SLOT_MINUTES = 15;
+const int SLOT_DAY_START = 6 * 60;        // Minutes after midnight of slot 0
+const int GROOMING_OPEN = 800;            // First bookable start (HHMM)
+const int GROOMING_CLOSE = 1800;          // Appointments must end by then (HHMM)
+const int APPOINTMENT_SLOTS = 4;          // Every appointment takes an hour
+
+// In-memory index of booked grooming slots from today on: groomer -> date -> busy slot bitmap.
+// Built once from grooming_appointment, then caught up with the appointments added since
+struct GroomingSchedule {
+    mutex lock;
+    bool loaded = false;
+    int firstDate = 0;                                           // Dates before this are not indexed
+    sqlite3_int64 lastAppointmentId = 0;                         // Appointments up to this ID are indexed
+    long long changesSeen = -1;                                  // booking_changes count it was loaded at
+    vector<int> groomerIds;
+    unordered_map<int, unordered_map<int, uint64_t>> busy;
+};
+
+// One bookable start time for one groomer
+struct FreeSlot {
+    int groomerId;
+    int date;
+    int time;
+};
+
+const int BOARDING_CAPACITY = 30;        // Pets the kennel can board on one night
+const int MAX_BOARDING_NIGHTS = 366;     // Longest stay a reservation may cover
+
+// Pets on site per night, kept as a count per night from the day it was loaded on. Built with a
+// sweep over boarding_reservation and then caught up with only the reservations added since
+struct BoardingOccupancy {
+    mutex lock;
+    int firstDay = 0;                    // Day number (days since 1970-01-01) of nights[0]
+    sqlite3_int64 lastReservationId = -1; // Reservations up to this ID are counted; -1 = not loaded
+    long long changesSeen = -1;          // booking_changes count it was loaded at
+    vector<int> nights;
+};
+
+// A booking index update made inside a caller's transaction (the group commit writer's): applied once
+// that transaction commits, discarded if it or the write's savepoint rolls back
+struct PendingIndexUpdate {
+    function<void()> apply;
+    function<void()> discard;
+};
+
+const size_t PROFILE_CACHE_SIZE = 256;            // Client profiles kept in memory, least recently used dropped first
+const auto PROFILE_MAX_AGE = chrono::minutes(5);  // Older entries are read again, so writes by other processes show up
+const int PROFILE_RECENT_ROWS = 5;                // Stays, grooming appointments and sales shown per profile
+
+// Everything the desk looks at when a client checks in, read from one snapshot
+struct ClientProfile {
+    int clientId = 0;
+    ClientRecord client;
+    vector<pair<int, PetRecord>> pets;           // pet_id, pet
+    vector<string> medicalRecords;               // One formatted line each, newest first
+    vector<string> stays, appointments, sales;   // The PROFILE_RECENT_ROWS most recent of each, newest first
+    chrono::steady_clock::time_point loaded;
+};
+
+const size_t PROFILE_GENERATION_SLOTS = 1024;     // Per-client change counters, clients hashed by ID
+
+// Bounded LRU cache of client profiles. Writes drop exactly the profiles they touch: a client's own
+// rows by client_id, a pet's by the profile holding that pet. A write inside a transaction drops the
+// profile at once and again in settle() after the commit, and a fetch that overlapped an invalidation
+// of its client is not stored, so a profile read from the snapshot before a commit never outlives that
+// commit. Other processes' commits are seen through PRAGMA data_version on the connection this process
+// writes through (it does not count that connection's own commits), checked on every lookup; any such
+// commit drops every profile, since it could have touched any client
+class ClientProfileCache {
+public:
+    explicit ClientProfileCache(size_t capacity) : capacity(capacity) {}
+    ClientProfileCache(const ClientProfileCache&) = delete;
+    ClientProfileCache& operator=(const ClientProfileCache&) = delete;
+
+    shared_ptr<const ClientProfile> find(int clientId);  // nullptr on a miss or for an entry past PROFILE_MAX_AGE
+    uint64_t generation(int clientId);                    // Taken before a fetch and handed back to store
+    void store(shared_ptr<const ClientProfile> profile, uint64_t fetchGeneration);
+    void invalidateClient(int clientId);
+    void invalidatePet(int petId);
+    void settle();                                        // Called once the invalidating writes have committed
+    void watchWriter(sqlite3* writer, mutex* writerMutex); // The process's write connection; nullptr stops watching
+    void checkWriterVersion(sqlite3* writer);             // The writer's mutex must be held
+    void printStats(ostream& out);
+
+private:
+    void erase(int clientId);                             // lock must be held
+    void bumpClient(int clientId);                        // lock must be held
+    void dropAll();                                       // lock must be held
+
+    mutex lock;
+    size_t capacity;
+    list<shared_ptr<const ClientProfile>> recent;         // Most recently used first
+    unordered_map<int, list<shared_ptr<const ClientProfile>>::iterator> byClient;
+    unordered_map<int, int> petOwners;                    // pet_id -> client_id of the cached profiles
+    vector<int> pendingClients, pendingPets;              // Invalidated since the last settle
+    bool pendingAll = false;                              // Too many pending: settle drops everything
+    uint64_t clientChanges[PROFILE_GENERATION_SLOTS] = {};
+    uint64_t sharedChanges = 0;                           // Changes whose client is unknown (a pet not in the cache, everything)
+    sqlite3* writer = nullptr;
+    mutex* writerMutex = nullptr;
+    long long writerVersion = -1;                         // Its data_version at the last check
+    long long hits = 0, misses = 0, invalidations = 0, evictions = 0, foreignCommits = 0;
+};
+
+// Process-wide, shared by the menu or by every server worker
+static ClientProfileCache clientProfiles(PROFILE_CACHE_SIZE);
+
+// A terminal's socket and whatever it sent after its last complete command
+struct ServerConnection {
+    int fd;
+    string buffer;
+};
+
+// Shared state of a running --serve process. Terminals are not tied to a worker: the accept loop polls
+// every idle connection and queues the ones with a command waiting, so any number of terminals share the pool
+struct KennelServer {
+    string dbPath;
+    sqlite3* writer = nullptr;           // The only connection that writes, used under writerMutex
+    mutex writerMutex;
+    mutex queueMutex;
+    condition_variable queueReady;
+    deque<ServerConnection> readyConnections;   // Commands waiting for a free worker
+    vector<ServerConnection> servedConnections; // Handed back by workers for the accept loop to watch again
+    int wakeFds[2] = {-1, -1};                  // A pipe workers write to so the accept loop picks those up
+    atomic<bool> stopping{false};
+    GroomingSchedule schedule;           // Slot index shared by all workers, filled through the writer
+    BoardingOccupancy occupancy;         // Nightly counts shared by all workers, synced through the writer
+    unique_ptr<GroupCommitWriter> writes; // Runs every write on the writer connection
+};
+
+const size_t EXPORT_BUFFER_BYTES = 1 << 20; // Exports are written in blocks of this size
+
+// Output for exports: rows are appended into one large buffer that is written out when full,
+// instead of a stream write (and flush) per field
+class ExportWriter {
+public:
+    explicit ExportWriter(FILE* file) : file(file), buffer(new char[EXPORT_BUFFER_BYTES]) {}
+    ~ExportWriter() { flush(); }
+    ExportWriter(const ExportWriter&) = delete;
+    ExportWriter& operator=(const ExportWriter&) = delete;
+
+    void append(const char* data, size_t size);
+    void append(char c) {
+        if (used == EXPORT_BUFFER_BYTES) flush();
+        buffer[used++] = c;
+    }
+    void appendInt(sqlite3_int64 value);
+    void appendCsvField(const char* text, size_t size);  // Quoted only when it holds a comma, quote or line break
+    void appendJsonString(const char* text, size_t size);
+    bool flush();
+    bool failed() const { return writeFailed; }
+
+private:
+    FILE* file;
+    unique_ptr<char[]> buffer;
+    size_t used = 0;
+    bool writeFailed = false;
+};
+
+// Columns of a sales snapshot (--snapshot): one row per sale, and one per sale line. Rows are in date
+// order, dates are day numbers, money is whole cents and text is a code into a dictionary
+enum SnapshotColumn {
+    SALE_DAY, SALE_CENTS, SALE_EMPLOYEE, SALE_PAYMENT,        // int32, int32, uint16, uint16
+    LINE_DAY, LINE_CENTS, LINE_QUANTITY, LINE_CATEGORY,      // int32, int32 (quantity * price), int32, uint16
+    SNAPSHOT_COLUMNS
+};
+enum SnapshotDictionary { DICT_EMPLOYEE, DICT_PAYMENT, DICT_CATEGORY, SNAPSHOT_DICTIONARIES };
+
+const char SNAPSHOT_MAGIC[8] = {'K', 'N', 'L', 'S', 'N', 'A', 'P', '1'};
+const size_t SNAPSHOT_ALIGN = 64;            // Every column starts on a cache line
+
+// Start of a snapshot file, in native byte order. The columns follow, then the dictionaries: for each,
+// a uint32 count and then every entry as a uint32 length and its bytes
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t saleRows, lineRows;
+    int32_t firstDay, lastDay;               // Day numbers of the first and last sale
+    uint64_t columnOffset[SNAPSHOT_COLUMNS]; // From the start of the file
+    uint64_t dictionaryOffset, dictionaryBytes;
+};
+
+// What --analytics totals by
+enum AnalyticsGroup { BY_CATEGORY, BY_EMPLOYEE, BY_PAYMENT, BY_DAY, BY_WEEK, BY_MONTH, BY_YEAR };
+
+// One group of an analytics result: sales (units for categories) and revenue in cents
+struct AnalyticsRow {
+    string label;
+    long long count = 0;
+    long long cents = 0;
+};
+
+// A snapshot file mapped read-only into memory; the column pointers point straight into the mapping
+class SalesSnapshot {
+public:
+    SalesSnapshot() = default;
+    ~SalesSnapshot();
+    SalesSnapshot(const SalesSnapshot&) = delete;
+    SalesSnapshot& operator=(const SalesSnapshot&) = delete;
+
+    bool open(const char* path, string& error);
+    const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(base); }
+    template <typename T> const T* column(SnapshotColumn c) const {
+        return reinterpret_cast<const T*>(static_cast<const char*>(base) + header().columnOffset[c]);
+    }
+    const vector<string>& dictionary(SnapshotDictionary d) const { return dictionaries[d]; }
+
+private:
+    void* base = nullptr;
+    size_t size = 0;
+    vector<string> dictionaries[SNAPSHOT_DICTIONARIES];
+};
+
+// Runs a PASSIVE checkpoint once a second on its own connection while it exists. Processes that use
+// it turn SQLite's auto-checkpoint off: with a long report holding an old snapshot, the automatic
+// checkpoint after every commit rescans all the WAL frames written since, and sales slow down 5x
+class WalCheckpointer {
+public:
+    explicit WalCheckpointer(const char* dbPath);
+    ~WalCheckpointer();
+    WalCheckpointer(const WalCheckpointer&) = delete;
+    WalCheckpointer& operator=(const WalCheckpointer&) = delete;
+
+private:
+    thread worker;
+    mutex stopMutex;
+    condition_variable stopRequested;
+    bool stopping = false;
+};
+
+// One change to a captured table, as stored in the change log (--tail-changes reads it). Every change
+// committed together has the same sequence number, sequence numbers follow commit order, and records
+// sit in the file in sequence order
+enum ChangeTable : uint8_t { CHANGE_CLIENT = 1, CHANGE_PET, CHANGE_LEDGER, CHANGE_BOARDING };
+enum ChangeOperation : uint8_t { CHANGE_VOID = 0, CHANGE_INSERT, CHANGE_UPDATE, CHANGE_DELETE, CHANGE_RESYNC };
+// A CHANGE_RESYNC record (table 0, rowid 0) says the whole database was replaced, by a restore or by
+// generating it again: consumers must read every table afresh. A CHANGE_VOID record fills the place of a
+// change whose COMMIT failed after its place was taken, and is skipped. An all-zero record (sequence 0)
+// is a place not written yet
+struct ChangeRecord {
+    uint64_t sequence;
+    int64_t rowid;
+    uint32_t commitTime;      // Unix seconds
+    uint8_t table;            // ChangeTable
+    uint8_t operation;        // ChangeOperation
+    uint8_t reserved[2];
+};
+static_assert(sizeof(ChangeRecord) == 24, "change log records are 24 bytes");
+
+const char CHANGE_LOG_MAGIC[8] = {'K', 'N', 'L', 'C', 'H', 'G', 'S', '1'};
+// Start of a change log file; the records follow it. nextSequence and nextSlot (the next record's place
+// in the file) are shared through a mapping by every process writing the log, and only taken together
+// under the database write lock, so file order is sequence order
+struct ChangeLogHeader {
+    char magic[8];
+    uint64_t nextSequence;
+    uint64_t nextSlot;
+    uint64_t reserved[5];
+};
+const size_t CHANGE_RING_SIZE = 1 << 14;     // Records waiting for the drain thread; a power of two
+const char* CHANGE_LOG_SUFFIX = "-changes";  // The log sits beside the database, like its -wal file
+const int CHANGE_SLOT_WAIT_SECONDS = 5;      // How long --tail-changes waits on an unwritten record with later ones after it
+
+// Change data capture for client, pet, general_ledger and boarding_reservation. Attached connections get
+// update/commit/rollback/WAL hooks: the update hook notes the row, and the commit hook, which runs before
+// SQLite writes the commit, stamps the transaction's rows with the next sequence number and file slots
+// but holds them back. The WAL hook, which SQLite calls once the commit is done, puts them in a lock-free
+// ring, and a thread writes the ring to their slots in the log file (fsync at most once a second). A
+// COMMIT that fails rolls back, and the rollback hook writes CHANGE_VOID into the slots instead. Outside
+// WAL mode (--import's bulk load) a commit is known to have worked at the next write or at detach.
+// SQLite has no hook for ROLLBACK TO, so code that rolls back to a savepoint notes pendingChanges when it
+// opens it and calls discardChanges after ROLLBACK TO and before RELEASE (which commits when the savepoint
+// is the whole transaction). Attach after setting PRAGMA wal_autocheckpoint, which replaces the WAL hook
+class ChangeLog {
+public:
+    explicit ChangeLog(const string& path);
+    ~ChangeLog();                               // Writes out everything captured, then stops the thread
+    ChangeLog(const ChangeLog&) = delete;
+    ChangeLog& operator=(const ChangeLog&) = delete;
+
+    void attach(sqlite3* db);                   // Does nothing when the log could not be opened
+    void detach(sqlite3* db);
+    void resync();                              // Logs a CHANGE_RESYNC record; call with no other writers
+    void printStats(ostream& out);
+
+    static size_t pendingChanges(sqlite3* db);  // Changes captured so far in db's open transaction
+    static void discardChanges(sqlite3* db, size_t from); // Drops those from index from on, after ROLLBACK TO
+
+private:
+    struct Capture {
+        ChangeLog* log;
+        sqlite3* db;
+        int autocheckpointPages;                // The connection's wal_autocheckpoint, which the WAL hook keeps doing
+        vector<ChangeRecord> pending;           // This connection's open transaction
+        vector<ChangeRecord> committing;        // Stamped by the commit hook, not known to be committed yet
+        uint64_t firstSlot = 0;                 // File slot of committing[0]
+    };
+    struct Cell {
+        atomic<size_t> turn;
+        ChangeRecord record;
+        uint64_t slot;
+    };
+    static void onUpdate(void* capture, int operation, const char* schema, const char* table, sqlite3_int64 rowid);
+    static int onCommit(void* capture);
+    static void onRollback(void* capture);
+    static int onWalCommit(void* capture, sqlite3* db, const char* schema, int walPages);
+    void publish(Capture& capture, bool committed); // Writes out committing, or CHANGE_VOID in its slots
+    void unhook(Capture& capture);
+    void push(const ChangeRecord& record, uint64_t slot);
+    bool pop(ChangeRecord& record, uint64_t& slot);
+    void drainLoop();
+
+    string path;
+    int fd = -1;
+    ChangeLogHeader* header = nullptr;          // Mapped from the file
+    unique_ptr<Cell[]> ring;
+    atomic<size_t> tail{0};                     // Next cell a producer claims
+    size_t head = 0;                            // Next cell the drain thread reads
+    mutex capturesMutex;
+    vector<unique_ptr<Capture>> captures;
+    thread drainThread;
+    atomic<bool> stopping{false};
+    atomic<long long> captured{0}, commits{0}, voided{0}, written{0}, ringWaits{0}, writeErrors{0};
+};
+
+// What one online backup did; longestStepMs is the longest the source connection was held
+struct BackupStats {
+    long long pages = 0, bytes = 0;
+    int steps = 0, restarts = 0;
+    double seconds = 0, longestStepMs = 0;
+};
+
+const int BACKUP_STEP_PAGES = 64;             // Pages copied per step while the writer waits
+const int BACKUP_PAUSE_MS = 10;               // Pause after each step, when the writer gets the connection back
+const char* BACKUP_SUFFIX = "-backup";        // Where --backup-every keeps its copy, beside the database
+
+// Takes an online backup every interval on a thread of its own, from the connection that does this process's
+// writes, so those writes are carried into the copy instead of restarting it. sourceMutex is only held for
+// each small step. The copy is replaced only once a new one is complete and checked
+class BackgroundBackup {
+public:
+    BackgroundBackup(sqlite3* source, mutex& sourceMutex, const string& destPath, chrono::minutes interval, ostream* log);
+    ~BackgroundBackup();
+    BackgroundBackup(const BackgroundBackup&) = delete;
+    BackgroundBackup& operator=(const BackgroundBackup&) = delete;
+
+    void printStats(ostream& out);
+
+private:
+    thread worker;
+    mutex stopMutex;
+    condition_variable stopRequested;
+    bool stopping = false;
+    atomic<bool> cancel{false};
+    mutex statsMutex;
+    int completed = 0, failed = 0;
+    BackupStats last;
+    string lastError;
+};
+
+// A report export running on a worker thread with its own read-only connection, so the menu
+// (and its connection) stays free. In WAL mode the export reads one snapshot and never blocks sales
+struct BackgroundReport {
+    thread worker;
+    mutex readerMutex;               // Held while closing reader, so a cancel never interrupts a closed connection
+    sqlite3* reader = nullptr;
+    atomic<bool> running{false};
+    atomic<long long> rows{0};
+    bool announced = true;           // Whether the finished job's result has been shown
+    string description;
+    ostringstream log;               // Written by the worker, read only once running is false
+    chrono::steady_clock::time_point started;
+};
+
+const size_t LOCATION_BATCH_ROWS = 1024;   // Rows a location's reader hands to the merge at a time
+const size_t LOCATION_QUEUE_BATCHES = 8;   // Batches a reader may get ahead of the merge before it waits
+
+// One row of a --locations report. Grooming rows fill every field; revenue rows are one month
+// each, with the month (YYYYMM) in date and the sale count in id
+struct LocationRow {
+    int date = 0, time = 0;
+    sqlite3_int64 id = 0;
+    int clientId = 0, groomerId = 0;
+    optional<string> client, groomer; // Missing names stay null
+    double revenue = 0;
+};
+
+// One location's database, read on a thread and connection of its own in the order the merge takes
+// rows, and handed over in batches. Only LOCATION_QUEUE_BATCHES wait at a time, so a slow output holds
+// the readers back instead of every location piling up in memory
+class LocationStream {
+public:
+    LocationStream(const string& path, const string& report);
+    ~LocationStream(); // Stops the reader when the merge gives up early
+    LocationStream(const LocationStream&) = delete;
+    LocationStream& operator=(const LocationStream&) = delete;
+
+    bool next(LocationRow& row); // False once the rows run out, check error() then
+    string error();
+    long long rows() const { return rowsRead; }
+    double readSeconds();        // CPU time of the reader thread, so neither waits on the merge nor other locations count
+    bool readLedger();           // Revenue came from general_ledger: the database has no daily_revenue rollup yet
+
+private:
+    void read(const string& report);
+
+    string dbPath;
+    thread worker;
+    mutex lock;
+    condition_variable changed;
+    deque<vector<LocationRow>> batches;
+    vector<LocationRow> current; // The batch the merge is taking rows from
+    size_t position = 0;
+    bool done = false, stopping = false;
+    string failure;
+    double busySeconds = 0;
+    bool ledger = false;
+    atomic<long long> rowsRead{0};
+};
+
+// Row counts for --generate; -1 means scale it from the ledger count
+struct DatasetSize {
+    long long clients = -1, pets = -1, groomers = -1, employees = -1, retailItems = -1;
+    long long groomingAppointments = -1, boardingReservations = -1, medicalRecords = -1;
+    long long ledgerRows = 100000;
+    unsigned seed = 42;
+};
+
+// Outcome of adding a single item to a sale
+enum SaleItemResult { SALE_ITEM_OK, SALE_ITEM_NOT_FOUND, SALE_ITEM_NO_STOCK, SALE_ITEM_ERROR };
+
+// What a cascading delete starts from: clients (with their pets, bookings and sales) or pets
+enum CascadeTarget { CASCADE_CLIENTS, CASCADE_PETS };
+
+const int CASCADE_CHUNK_SIZE = 50; // Clients or pets removed per transaction by a bulk purge
+
+// Rows removed by a cascading delete, per table
+struct CascadeCounts {
+    long long clients = 0, pets = 0, medicalRecords = 0, boardingReservations = 0;
+    long long groomingAppointments = 0, sales = 0, saleItems = 0;
+};
+
+// One schema change, applied once and recorded in PRAGMA user_version
+struct Migration {
+    int version;
+    const char* description;
+    const char* sql;
+    void (*report)(sqlite3* db) = nullptr; // Optional, run after the migration commits
+};
+
+void reportForeignKeyViolations(sqlite3* db);
+
+// Schema changes in order; append new ones with the next version number, never edit applied ones
+const Migration MIGRATIONS[] = {
+    {1, "Indexes for report, sale and foreign key access paths", R"(
+        CREATE INDEX IF NOT EXISTS idx_boarding_client_checkin
+            ON boarding_reservation (client_id, check_in, pet_id, check_out, amount);
+        CREATE INDEX IF NOT EXISTS idx_grooming_date_time
+            ON grooming_appointment (grooming_date DESC, grooming_time, client_id, groomer_id);
+        CREATE INDEX IF NOT EXISTS idx_ledger_item_ledger
+            ON ledger_item (ledger_id, item_id, quantity);
+        CREATE INDEX IF NOT EXISTS idx_pet_client
+            ON pet (client_id);
+    )"},
+    {2, "Name indexes for pick list filters, row ID tie-breaks for keyset paging", R"(
+        CREATE INDEX IF NOT EXISTS idx_client_name
+            ON client (client_name COLLATE NOCASE);
+        CREATE INDEX IF NOT EXISTS idx_pet_name
+            ON pet (pet_name COLLATE NOCASE);
+        DROP INDEX IF EXISTS idx_boarding_client_checkin;
+        CREATE INDEX idx_boarding_client_checkin
+            ON boarding_reservation (client_id, check_in, reservation_id, pet_id, check_out, amount);
+        DROP INDEX IF EXISTS idx_grooming_date_time;
+        CREATE INDEX idx_grooming_date_time
+            ON grooming_appointment (grooming_date DESC, grooming_time, appointment_id, client_id, groomer_id);
+    )"},
+    {3, "Full-text search indexes over clients, pets and medical histories", R"(
+        CREATE VIRTUAL TABLE client_fts USING fts5(
+            client_name, phone, email, client_address,
+            content = 'client', content_rowid = 'client_id', tokenize = 'trigram');
+        CREATE VIRTUAL TABLE pet_fts USING fts5(
+            pet_name, breed, medical_condition,
+            content = 'pet', content_rowid = 'pet_id', prefix = '2 3');
+        CREATE VIRTUAL TABLE medical_fts USING fts5(
+            medical_history,
+            content = 'medical_record', content_rowid = 'record_id', prefix = '2 3');
+        INSERT INTO client_fts (client_fts) VALUES ('rebuild');
+        INSERT INTO pet_fts (pet_fts) VALUES ('rebuild');
+        INSERT INTO medical_fts (medical_fts) VALUES ('rebuild');
+
+        CREATE TRIGGER client_fts_insert AFTER INSERT ON client BEGIN
+            INSERT INTO client_fts (rowid, client_name, phone, email, client_address)
+            VALUES (new.client_id, new.client_name, new.phone, new.email, new.client_address);
+        END;
+        CREATE TRIGGER client_fts_delete AFTER DELETE ON client BEGIN
+            INSERT INTO client_fts (client_fts, rowid, client_name, phone, email, client_address)
+            VALUES ('delete', old.client_id, old.client_name, old.phone, old.email, old.client_address);
+        END;
+        CREATE TRIGGER client_fts_update AFTER UPDATE OF client_name, phone, email, client_address ON client BEGIN
+            INSERT INTO client_fts (client_fts, rowid, client_name, phone, email, client_address)
+            VALUES ('delete', old.client_id, old.client_name, old.phone, old.email, old.client_address);
+            INSERT INTO client_fts (rowid, client_name, phone, email, client_address)
+            VALUES (new.client_id, new.client_name, new.phone, new.email, new.client_address);
+        END;
+
+        CREATE TRIGGER pet_fts_insert AFTER INSERT ON pet BEGIN
+            INSERT INTO pet_fts (rowid, pet_name, breed, medical_condition)
+            VALUES (new.pet_id, new.pet_name, new.breed, new.medical_condition);
+        END;
+        CREATE TRIGGER pet_fts_delete AFTER DELETE ON pet BEGIN
+            INSERT INTO pet_fts (pet_fts, rowid, pet_name, breed, medical_condition)
+            VALUES ('delete', old.pet_id, old.pet_name, old.breed, old.medical_condition);
+        END;
+        CREATE TRIGGER pet_fts_update AFTER UPDATE OF pet_name, breed, medical_condition ON pet BEGIN
+            INSERT INTO pet_fts (pet_fts, rowid, pet_name, breed, medical_condition)
+            VALUES ('delete', old.pet_id, old.pet_name, old.breed, old.medical_condition);
+            INSERT INTO pet_fts (rowid, pet_name, breed, medical_condition)
+            VALUES (new.pet_id, new.pet_name, new.breed, new.medical_condition);
+        END;
+
+        CREATE TRIGGER medical_fts_insert AFTER INSERT ON medical_record BEGIN
+            INSERT INTO medical_fts (rowid, medical_history) VALUES (new.record_id, new.medical_history);
+        END;
+        CREATE TRIGGER medical_fts_delete AFTER DELETE ON medical_record BEGIN
+            INSERT INTO medical_fts (medical_fts, rowid, medical_history) VALUES ('delete', old.record_id, old.medical_history);
+        END;
+        CREATE TRIGGER medical_fts_update AFTER UPDATE OF medical_history ON medical_record BEGIN
+            INSERT INTO medical_fts (medical_fts, rowid, medical_history) VALUES ('delete', old.record_id, old.medical_history);
+            INSERT INTO medical_fts (rowid, medical_history) VALUES (new.record_id, new.medical_history);
+        END;
+    )"},
+    {4, "Daily revenue and item sales rollups, kept up to date by triggers", R"(
+        CREATE TABLE daily_revenue (
+            ledger_date INTEGER PRIMARY KEY,
+            sale_count INTEGER NOT NULL,
+            revenue REAL NOT NULL
+        ) WITHOUT ROWID;
+        CREATE TABLE daily_item_sales (
+            ledger_date INTEGER NOT NULL,
+            item_id INTEGER NOT NULL,
+            quantity INTEGER NOT NULL,
+            PRIMARY KEY (ledger_date, item_id)
+        ) WITHOUT ROWID;
+        INSERT INTO daily_revenue (ledger_date, sale_count, revenue)
+            SELECT ledger_date, COUNT(*), TOTAL(amount) FROM general_ledger WHERE ledger_date IS NOT NULL GROUP BY ledger_date;
+        INSERT INTO daily_item_sales (ledger_date, item_id, quantity)
+            SELECT g.ledger_date, li.item_id, TOTAL(li.quantity)
+            FROM ledger_item li JOIN general_ledger g ON g.general_ledger_id = li.ledger_id
+            WHERE g.ledger_date IS NOT NULL
+            GROUP BY g.ledger_date, li.item_id;
+
+        CREATE TRIGGER daily_revenue_insert AFTER INSERT ON general_ledger BEGIN
+            INSERT INTO daily_revenue (ledger_date, sale_count, revenue)
+            SELECT new.ledger_date, 1, COALESCE(new.amount, 0) WHERE new.ledger_date IS NOT NULL
+            ON CONFLICT (ledger_date) DO UPDATE SET sale_count = sale_count + 1, revenue = revenue + excluded.revenue;
+        END;
+        CREATE TRIGGER daily_revenue_delete AFTER DELETE ON general_ledger BEGIN
+            UPDATE daily_revenue SET sale_count = sale_count - 1, revenue = revenue - COALESCE(old.amount, 0)
+            WHERE ledger_date IS old.ledger_date;
+        END;
+        CREATE TRIGGER daily_revenue_update AFTER UPDATE OF ledger_date, amount ON general_ledger BEGIN
+            UPDATE daily_revenue SET sale_count = sale_count - 1, revenue = revenue - COALESCE(old.amount, 0)
+            WHERE ledger_date IS old.ledger_date;
+            INSERT INTO daily_revenue (ledger_date, sale_count, revenue)
+            SELECT new.ledger_date, 1, COALESCE(new.amount, 0) WHERE new.ledger_date IS NOT NULL
+            ON CONFLICT (ledger_date) DO UPDATE SET sale_count = sale_count + 1, revenue = revenue + excluded.revenue;
+        END;
+
+        CREATE TRIGGER daily_item_sales_insert AFTER INSERT ON ledger_item BEGIN
+            INSERT INTO daily_item_sales (ledger_date, item_id, quantity)
+            SELECT g.ledger_date, new.item_id, COALESCE(new.quantity, 0) FROM general_ledger g
+            WHERE g.general_ledger_id = new.ledger_id AND g.ledger_date IS NOT NULL
+            ON CONFLICT (ledger_date, item_id) DO UPDATE SET quantity = quantity + excluded.quantity;
+        END;
+        CREATE TRIGGER daily_item_sales_delete AFTER DELETE ON ledger_item BEGIN
+            UPDATE daily_item_sales SET quantity = quantity - COALESCE(old.quantity, 0)
+            WHERE item_id IS old.item_id
+              AND ledger_date = (SELECT ledger_date FROM general_ledger WHERE general_ledger_id = old.ledger_id);
+        END;
+        CREATE TRIGGER daily_item_sales_update AFTER UPDATE OF ledger_id, item_id, quantity ON ledger_item BEGIN
+            UPDATE daily_item_sales SET quantity = quantity - COALESCE(old.quantity, 0)
+            WHERE item_id IS old.item_id
+              AND ledger_date = (SELECT ledger_date FROM general_ledger WHERE general_ledger_id = old.ledger_id);
+            INSERT INTO daily_item_sales (ledger_date, item_id, quantity)
+            SELECT g.ledger_date, new.item_id, COALESCE(new.quantity, 0) FROM general_ledger g
+            WHERE g.general_ledger_id = new.ledger_id AND g.ledger_date IS NOT NULL
+            ON CONFLICT (ledger_date, item_id) DO UPDATE SET quantity = quantity + excluded.quantity;
+        END;
+        -- A ledger row moved to another day takes its items' quantities with it
+        CREATE TRIGGER daily_item_sales_move AFTER UPDATE OF ledger_date ON general_ledger
+        WHEN old.ledger_date IS NOT new.ledger_date BEGIN
+            UPDATE daily_item_sales
+            SET quantity = quantity - (SELECT TOTAL(li.quantity) FROM ledger_item li
+                                       WHERE li.ledger_id = old.general_ledger_id AND li.item_id = daily_item_sales.item_id)
+            WHERE ledger_date = old.ledger_date
+              AND item_id IN (SELECT item_id FROM ledger_item WHERE ledger_id = old.general_ledger_id);
+            INSERT INTO daily_item_sales (ledger_date, item_id, quantity)
+            SELECT new.ledger_date, item_id, TOTAL(quantity) FROM ledger_item
+            WHERE ledger_id = new.general_ledger_id AND new.ledger_date IS NOT NULL GROUP BY item_id
+            ON CONFLICT (ledger_date, item_id) DO UPDATE SET quantity = quantity + excluded.quantity;
+        END;
+    )"},
+    {5, "Groomer day index for booking conflict checks", R"(
+        CREATE INDEX IF NOT EXISTS idx_grooming_groomer_date
+            ON grooming_appointment (groomer_id, grooming_date, grooming_time);
+    )"},
+    {6, "Child key indexes for cascading deletes, deletion counters for the booking indexes", R"(
+        CREATE INDEX IF NOT EXISTS idx_medical_pet ON medical_record (pet_id);
+        CREATE INDEX IF NOT EXISTS idx_boarding_pet ON boarding_reservation (pet_id);
+        CREATE INDEX IF NOT EXISTS idx_grooming_client_date ON grooming_appointment (client_id, grooming_date);
+        CREATE INDEX IF NOT EXISTS idx_ledger_client_date ON general_ledger (client_id, ledger_date);
+
+        CREATE TABLE booking_changes (
+            table_name TEXT PRIMARY KEY,
+            changes INTEGER NOT NULL
+        ) WITHOUT ROWID;
+        INSERT INTO booking_changes VALUES ('boarding_reservation', 0), ('grooming_appointment', 0);
+        CREATE TRIGGER boarding_reservation_removed AFTER DELETE ON boarding_reservation BEGIN
+            UPDATE booking_changes SET changes = changes + 1 WHERE table_name = 'boarding_reservation';
+        END;
+        CREATE TRIGGER boarding_reservation_moved AFTER UPDATE OF check_in, check_out ON boarding_reservation BEGIN
+            UPDATE booking_changes SET changes = changes + 1 WHERE table_name = 'boarding_reservation';
+        END;
+        CREATE TRIGGER grooming_appointment_removed AFTER DELETE ON grooming_appointment BEGIN
+            UPDATE booking_changes SET changes = changes + 1 WHERE table_name = 'grooming_appointment';
+        END;
+        CREATE TRIGGER grooming_appointment_moved AFTER UPDATE OF groomer_id, grooming_date, grooming_time ON grooming_appointment BEGIN
+            UPDATE booking_changes SET changes = changes + 1 WHERE table_name = 'grooming_appointment';
+        END;
+    )"},
+    {7, "Registry of yearly history archives, date indexes for moving old rows out", R"(
+        CREATE TABLE history_archive (
+            year INTEGER PRIMARY KEY,
+            file TEXT NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_ledger_date ON general_ledger (ledger_date);
+        CREATE INDEX IF NOT EXISTS idx_boarding_checkout ON boarding_reservation (check_out);
+    )"},
+    {8, "One-time foreign key check of rows written before foreign keys were enforced", R"(
+        CREATE TABLE foreign_key_violation (
+            table_name TEXT NOT NULL,
+            row_id INTEGER,
+            parent TEXT NOT NULL,
+            fk_index INTEGER NOT NULL
+        );
+        INSERT INTO foreign_key_violation SELECT "table", rowid, parent, fkid FROM pragma_foreign_key_check;
+    )", reportForeignKeyViolations},
+};
+
+// Tables of one yearly archive file, attached as "archive" while --archive fills it. No foreign keys:
+// the clients and pets stay in the live file. Rows keep their live IDs, so a re-run copy is ignored
+const char* ARCHIVE_SCHEMA = R"(
+    CREATE TABLE IF NOT EXISTS archive.general_ledger (
+        general_ledger_id INTEGER PRIMARY KEY,
+        ledger_date INTEGER,
+        ledger_time INTEGER,
+        item_or_service_purchase VARCHAR,
+        amount REAL,
+        discount REAL,
+        payment_method VARCHAR,
+        client_id INTEGER,
+        employee_id INTEGER
+    );
+    CREATE TABLE IF NOT EXISTS archive.ledger_item (
+        ledger_item_id INTEGER PRIMARY KEY,
+        ledger_id INTEGER,
+        item_id INTEGER,
+        quantity INTEGER
+    );
+    CREATE TABLE IF NOT EXISTS archive.boarding_reservation (
+        reservation_id INTEGER PRIMARY KEY,
+        check_in INTEGER,
+        check_out INTEGER,
+        client_id INTEGER,
+        pet_id INTEGER,
+        amount REAL
+    );
+    CREATE INDEX IF NOT EXISTS archive.idx_ledger_item_ledger ON ledger_item (ledger_id);
+    CREATE INDEX IF NOT EXISTS archive.idx_boarding_client_checkin
+        ON boarding_reservation (client_id, check_in, reservation_id, pet_id, check_out, amount);
+)";
+
+// A list screen that is paged with keyset cursors instead of OFFSET.
+// All sort keys must be integer columns; the last key must be unique so every row has a distinct position
+struct PagedList {
+    const char* title;
+    const char* columns;        // Display columns, read by formatRow from index 0; the keys are appended after them
+    const char* from;           // FROM and JOIN clauses
+    const char* scope;          // Optional fixed condition on ?1, e.g. "b.client_id = ?1"
+    const char* filterColumn;   // Column the name-prefix filter applies to
+    int keyCount;
+    const char* keys[3];
+    bool descending[3];
+    void (*formatRow)(sqlite3_stmt* stmt, ostream& out); // RowFormatter<f>::format
+    int formatColumns;                                   // RowFormatter<f>::columns, which must be the display columns
+};
+
+const int PAGE_SIZE = 20; // Rows per page on list screens
+
+// One formatted row of a page, with the sort key values that locate it
+struct PageRow {
+    string text;
+    vector<sqlite3_int64> key;
+};
+
+// Row formatters for the list screens
+void formatIdNameRow(ostream& out, int id, optional<string_view> name);
+void formatBoardingRow(ostream& out, optional<string_view> petName, int checkIn, int checkOut, double amount);
+void formatGroomingRow(ostream& out, int appointmentId, optional<string_view> clientName, optional<string_view> groomerName,
+                       int date, int time);
+
+// List screens, shared by the menus and the query plan self-check
+const PagedList CLIENT_PICK_LIST = {
+    "Client List", "client_id, client_name", "client", nullptr, "client_name",
+    1, {"client_id"}, {false}, RowFormatter<formatIdNameRow>::format, RowFormatter<formatIdNameRow>::columns};
+const PagedList PET_PICK_LIST = {
+    "Pet List", "pet_id, pet_name", "pet", nullptr, "pet_name",
+    1, {"pet_id"}, {false}, RowFormatter<formatIdNameRow>::format, RowFormatter<formatIdNameRow>::columns};
+const PagedList BOARDING_HISTORY_LIST = {
+    "Boarding History",
+    "p.pet_name, b.check_in, b.check_out, b.amount",
+    "boarding_history b JOIN pet p ON b.pet_id = p.pet_id", // Temp view over the live and archived stays
+    "b.client_id = ?1", "p.pet_name",
+    2, {"b.check_in", "b.reservation_id"}, {true, true}, RowFormatter<formatBoardingRow>::format, RowFormatter<formatBoardingRow>::columns};
+const PagedList GROOMING_APPOINTMENTS_LIST = {
+    "Grooming Appointments",
+    "g.appointment_id, c.client_name, gr.groomer_name, g.grooming_date, g.grooming_time",
+    // CROSS JOIN keeps groomer inner: with only a handful of groomers the planner would otherwise loop over
+    // them on idx_grooming_groomer_date and sort the result
+    "grooming_appointment g JOIN client c ON g.client_id = c.client_id CROSS JOIN groomer gr ON g.groomer_id = gr.groomer_id",
+    nullptr, "c.client_name",
+    3, {"g.grooming_date", "g.grooming_time", "g.appointment_id"}, {true, false, false},
+    RowFormatter<formatGroomingRow>::format, RowFormatter<formatGroomingRow>::columns};
+
+// Paging functions
+string pagedListSQL(const PagedList& list, bool afterCursor, bool backward, bool filtered);
+bool fetchPagedList(sqlite3* db, const PagedList& list, sqlite3_int64 scopeValue, const string& prefix,
+                    const vector<sqlite3_int64>* cursor, bool backward, vector<PageRow>& page);
+void browsePagedList(sqlite3* db, const PagedList& list, sqlite3_int64 scopeValue = 0);
+
+// Schema functions
+bool runMigrations(sqlite3* db);
+int checkQueryPlans(sqlite3* db);   // Returns non-zero if a report query still scans a table or sorts
+
+// Tuning and maintenance functions
+const TuningProfile* findTuningProfile(const string& name);
+void applyTuningProfile(sqlite3* db, const TuningProfile* profile = nullptr); // nullptr: the one chosen at startup
+int runMaintenance(sqlite3* db, int sliceMs);          // optimize, ANALYZE and incremental vacuum in slices
+int enableIncrementalVacuum(sqlite3* db);              // One-time VACUUM that switches auto_vacuum on
+
+// Statement cache functions
+StatementCache& statementCacheFor(sqlite3* db);
+void clearStatementCache(sqlite3* db);                // Finalizes every cached statement, call before sqlite3_close
+void printStatementCacheStats(sqlite3* db);
+bool runCachedStatement(sqlite3* db, const char* sql);
+
+// Diagnostics functions
+void enableProfiling(sqlite3* db);                     // Installs the trace_v2 profile hook on a connection
+void recordOperation(const char* name, double micros);
+void writeDiagnostics(ostream& out, size_t maxQueries); // maxQueries 0 writes every statement
+void setMetricsFile(const char* path);                  // Dumps the diagnostics to path when the program exits
  
 // Add functions
-void addClient(sqlite3* db);
-void addPet(sqlite3* db);
+void addClient(sqlite3* db, GroupCommitWriter& writes);
+void addPet(sqlite3* db, GroupCommitWriter& writes);
 
 // Update functions
-void updateClient(sqlite3* db);
-void updatePet(sqlite3* db);
+void updateClient(sqlite3* db, GroupCommitWriter& writes);
+void updatePet(sqlite3* db, GroupCommitWriter& writes);
 
 // Delete functions
 void deleteClient(sqlite3* db);
 void deletePet(sqlite3* db);
 
+// Headless record operations behind the add/update/delete menus.
+// Updates and deletes return 1 when a row changed, 0 when the ID does not exist and -1 on error
+sqlite3_int64 insertClient(sqlite3* db, const ClientRecord& client);
+sqlite3_int64 insertPet(sqlite3* db, const PetRecord& pet);
+int updateClientRecord(sqlite3* db, int clientId, const ClientRecord& client);
+int updatePetRecord(sqlite3* db, int petId, const PetRecord& pet);
+int deleteClientRecord(sqlite3* db, int clientId);
+int deletePetRecord(sqlite3* db, int petId);
+
+// Cascading deletes: where is an SQL condition on client (or pet) rows picking what to remove
+bool cascadeDelete(sqlite3* db, CascadeTarget target, const string& where, int chunkSize, CascadeCounts& counts);
+int purgeRecords(sqlite3* db, const string& what, const string& selection, int chunkSize);
+
+// History archive functions: sales and stays older than a cutoff live in kennel_archive_YYYY.db files
+bool attachArchives(sqlite3* db);                 // Attaches the archive years and (re)builds the boarding_history view
+int archiveHistory(sqlite3* db, int cutoff);      // Moves sales and stays dated before cutoff into the archives
+
 // Function for a transaction
-void makeSaleTransaction(sqlite3* db);
+void makeSaleTransaction(sqlite3* db, GroupCommitWriter& writes);
+
+// Sale building blocks shared by the interactive and headless paths
+int insertSaleLedger(sqlite3* db, const Sale& sale, float totalAmount);
+SaleItemResult reserveSaleItem(sqlite3* db, int itemId, int quantity, float& totalAmount, int& available);
+SaleItemResult checkSaleItem(sqlite3* db, int itemId, int quantity, int& available);
+bool insertLedgerItems(sqlite3* db, int ledgerId, const vector<SaleLine>& items);
+bool processSale(sqlite3* db, const Sale& sale, float& totalAmount, string& error);
+
+// Bulk ingestion functions
+bool parseSaleLine(const string& line, Sale& sale, string& error);
+int ingestSales(sqlite3* db, const char* csvPath, int batchSize);
+bool splitCsvLine(const string& line, vector<string>& fields);
+string multiRowInsertSQL(const char* head, int columns, int rows);
+bool parseJsonObject(const string& line, map<string, string>& fields, string& error);
+int importClientsAndPets(sqlite3* db, const char* path, int batchRows);
+
+// Benchmark functions
+int benchmarkSales(const char* dbPath, int saleCount);
+bool parseDatasetOption(const string& option, DatasetSize& size);
+int generateDataset(const char* templatePath, const char* outPath, const DatasetSize& requested);
+int runBenchmarkSuite(const char* dbPath, int iterations);   // p50/p99 and ops/sec per headless operation
+int runDurabilityBenchmark(const char* dbPath, int writesPerTerminal, int terminals); // Writes/sec per durability mode
+
+// Server functions
+int runServer(const char* dbPath, const string& address, int workers, atomic<bool>& stop,
+              Durability durability = DURABILITY_FULL, int backupMinutes = 0);
+int runLoadTest(const char* dbPath, int maxClients, double secondsPerStep, Durability durability = DURABILITY_FULL);
+extern atomic<bool> serverStopRequested;
+void requestServerStop(int signal);
 
 // Report functions
 void viewBoardingHistoryForClient(sqlite3* db);   // Joins pets and clients
 void viewGroomingAppointments(sqlite3* db);       // Joins groomers and clients and appointments
+int exportReport(sqlite3* db, const string& report, const string& format, const char* path, int clientId,
+                 ostream& log = cerr, atomic<long long>* rowsDone = nullptr);
+void backgroundReportMenu(BackgroundReport& job);  // Start, watch or cancel an export on its own connection
+void announceBackgroundReport(BackgroundReport& job);
+void cancelBackgroundReport(BackgroundReport& job); // Interrupts a running export and waits for its thread
+int locationReport(const string& report, const vector<string>& paths, const string& format, const char* outPath); // Merged over locations
+void viewRevenueByPeriod(sqlite3* db);            // Reads the daily_revenue rollup
+void viewTopItemsByCategory(sqlite3* db);         // Reads the daily_item_sales rollup
+int backfillRollups(sqlite3* db);                 // Rebuilds both rollups from the ledger
+
+// Sales snapshot functions
+int writeSalesSnapshot(sqlite3* db, const char* path);   // Columnar copy of the ledger, archives included
+bool parseAnalyticsGroup(const string& name, AnalyticsGroup& group);
+vector<AnalyticsRow> snapshotAnalytics(const SalesSnapshot& snapshot, AnalyticsGroup group, int fromDate, int toDate);
+bool sqlAnalytics(sqlite3* db, AnalyticsGroup group, int fromDate, int toDate, vector<AnalyticsRow>& rows); // Same totals in SQL
+int runAnalytics(const char* path, const string& group, int fromDate, int toDate);
+int benchmarkAnalytics(sqlite3* db, const char* path);
+int benchmarkRowDecoding(sqlite3* db, int runs);   // ns/row for copied strings against typed string_view rows
+
+// Backup functions
+bool backupDatabase(sqlite3* source, mutex* sourceMutex, const string& destPath, int pagesPerStep, int pauseMs,
+                    BackupStats& stats, string& error, const atomic<bool>* cancel); // sourceMutex is held for each step
+int runBackup(sqlite3* db, const char* destPath, int pagesPerStep, int pauseMs);
+int restoreBackup(sqlite3* db, const char* backupPath);       // Verified, after saving the current database
+int benchmarkBackup(const char* dbPath, int pagesPerStep);   // Sale latency with and without a backup running
+
+// Change log functions
+int tailChanges(const char* path, long long from, bool follow);   // Prints records after a byte offset as CSV
+
+// Write queue functions
+const char* durabilityName(Durability durability);
+bool parseDurability(const string& name, Durability& durability);
+void announceCommittedWrites();                   // Results of batched menu writes since the last menu
+
+// Grooming schedule functions
+bool loadGroomingSchedule(sqlite3* db, GroomingSchedule& schedule);
+sqlite3_int64 bookGroomingAppointment(sqlite3* db, GroomingSchedule& schedule, int clientId, int groomerId,
+                                      int date, int time, string& error);
+vector<FreeSlot> findFreeSlots(GroomingSchedule& schedule, int fromDate, int fromTime, int count);
+void groomingDeskMenu(sqlite3* db, GroomingSchedule& schedule);
+
+// Boarding occupancy functions
+void deferIndexUpdate(sqlite3* db, function<void()> apply, function<void()> discard);
+size_t pendingIndexUpdates(sqlite3* db);
+void finishIndexUpdates(sqlite3* db, size_t from, bool committed); // Applies or discards the updates from index from on
+bool syncBoardingOccupancy(sqlite3* db, BoardingOccupancy& occupancy, sqlite3_int64 beforeId = 0);
+int nightlyOccupancy(BoardingOccupancy& occupancy, int fromDate, int nightCount, vector<int>& counts);
+sqlite3_int64 bookBoardingReservation(sqlite3* db, BoardingOccupancy& occupancy, int clientId, int petId,
+                                      int checkIn, int checkOut, double amount, string& error);
+void boardingDeskMenu(sqlite3* db, BoardingOccupancy& occupancy);
+
+// Client profile functions
+bool fetchClientProfile(sqlite3* db, int clientId, shared_ptr<const ClientProfile>& profile); // Cached; null profile = no such client
+void writeClientProfile(const ClientProfile& profile, ostream& out, const char* linePrefix = "");
+void clientProfileMenu(sqlite3* db);
+
+// Search functions
+string ftsQuery(const string& text, bool prefix, size_t minLength);
+void searchRecords(sqlite3* db);                  // Ranked full-text search across clients, pets and medical records
+int writeSearchResults(sqlite3* db, const string& text, ostream& out);
 
 // Function for menu utility
 int promptForInt(const std::string& prompt);
  
- int main() {
+ int main(int argc, char* argv[]) {
+    // --metrics-file FILE, --durability MODE, --profile NAME and --backup-every MINUTES can go with any mode,
+    // so they are taken out of argv before the mode is picked
+    Durability durability = DURABILITY_FULL;
+    const TuningProfile* profile = nullptr;
+    int backupMinutes = 0;
+    for (int i = 1; i + 1 < argc;) {
+        string option = argv[i];
+        if (option == "--metrics-file") {
+            setMetricsFile(argv[i + 1]);
+        } else if (option == "--profile") {
+            profile = findTuningProfile(argv[i + 1]);
+            if (!profile) {
+                cerr << "❌ Unknown profile '" << argv[i + 1] << "' (expected interactive, reporting or bulk-load)" << endl;
+                return 1;
+            }
+        } else if (option == "--backup-every") {
+            backupMinutes = atoi(argv[i + 1]);
+            if (backupMinutes <= 0) {
+                cerr << "❌ --backup-every takes a number of minutes" << endl;
+                return 1;
+            }
+        } else if (option == "--durability") {
+            if (!parseDurability(argv[i + 1], durability)) {
+                cerr << "❌ Unknown durability '" << argv[i + 1] << "' (expected full, normal or batched)" << endl;
+                return 1;
+            }
+        } else {
+            i++;
+            continue;
+        }
+        for (int j = i; j + 2 <= argc; j++) argv[j] = argv[j + 2];
+        argc -= 2;
+    }
+    if (!profile) { // Loads get bulk-load, long reads get reporting, the rest interactive
+        string mode = argc >= 2 ? argv[1] : "";
+        if (mode == "--import" || mode == "--ingest-sales" || mode == "--backfill-rollups") profile = findTuningProfile("bulk-load");
+        else if (mode == "--export" || mode == "--check-plans" || mode == "--snapshot" || mode == "--bench-analytics" ||
+                 mode == "--bench-rows" || mode == "--locations") profile = findTuningProfile("reporting");
+        else profile = findTuningProfile("interactive");
+    }
+    activeTuningProfile = profile;
+
+    // Headless modes
+    if (argc >= 2 && string(argv[1]) == "--bench-sales") {
+        int saleCount = argc >= 3 ? atoi(argv[2]) : 2000;
+        return benchmarkSales("kennel_project.db", saleCount);
+    }
+    if (argc >= 3 && string(argv[1]) == "--generate") {
+        DatasetSize size;
+        for (int i = 3; i < argc; i++) {
+            if (!parseDatasetOption(argv[i], size)) {
+                cerr << "❌ Bad volume option: " << argv[i] << " (expected e.g. ledger=1000000)" << endl;
+                return 1;
+            }
+        }
+        return generateDataset("kennel_project.db", argv[2], size);
+    }
+    if (argc >= 3 && string(argv[1]) == "--bench") {
+        int iterations = argc >= 4 ? atoi(argv[3]) : 1000;
+        return runBenchmarkSuite(argv[2], max(1, iterations));
+    }
+    if (argc >= 3 && string(argv[1]) == "--bench-durability") {
+        int writes = argc >= 4 ? atoi(argv[3]) : 500;
+        int terminals = argc >= 5 ? atoi(argv[4]) : 8;
+        return runDurabilityBenchmark(argv[2], max(1, writes), max(1, terminals));
+    }
+    if (argc >= 2 && string(argv[1]) == "--serve") {
+        string address = argc >= 3 ? argv[2] : "unix:kennel.sock";
+        int workers = argc >= 4 ? atoi(argv[3]) : 4;
+        signal(SIGINT, requestServerStop);
+        signal(SIGTERM, requestServerStop);
+        return runServer("kennel_project.db", address, workers, serverStopRequested, durability, backupMinutes);
+    }
+    if (argc >= 3 && string(argv[1]) == "--bench-backup") {
+        int pages = argc >= 4 ? atoi(argv[3]) : BACKUP_STEP_PAGES;
+        return benchmarkBackup(argv[2], max(1, pages));
+    }
+    if (argc >= 3 && string(argv[1]) == "--tail-changes") {
+        long long from = argc >= 4 ? atoll(argv[3]) : 0;
+        bool follow = argc >= 5 && string(argv[4]) == "--follow";
+        return tailChanges(argv[2], from, follow);
+    }
+    if (argc >= 4 && string(argv[1]) == "--analytics") {
+        int fromDate = argc >= 5 ? atoi(argv[4]) : 0;
+        int toDate = argc >= 6 ? atoi(argv[5]) : 0;
+        return runAnalytics(argv[2], argv[3], fromDate, toDate);
+    }
+    if (argc >= 4 && string(argv[1]) == "--locations") {
+        vector<string> paths;
+        stringstream list(argv[3]);
+        for (string path; getline(list, path, ',');) {
+            if (!path.empty()) paths.push_back(path);
+        }
+        return locationReport(argv[2], paths, argc >= 5 ? argv[4] : "csv", argc >= 6 ? argv[5] : "-");
+    }
+    if (argc >= 2 && string(argv[1]) == "--load-test") {
+        int maxClients = argc >= 3 ? atoi(argv[2]) : 8;
+        double seconds = argc >= 4 ? atof(argv[3]) : 3.0;
+        return runLoadTest("kennel_project.db", max(1, maxClients), seconds, durability);
+    }
+
     sqlite3* db;
     if (sqlite3_open("kennel_project.db", &db) != SQLITE_OK) { // Attempting to open the database
         cerr << "Failed to open database: " << sqlite3_errmsg(db) << endl;
         return 1;
     }
-    cout << "Connected to kennel_project.db successfully.\n";
+    sqlite3_busy_timeout(db, 5000); // Waiting on other terminals' writes instead of failing with SQLITE_BUSY
+    enableProfiling(db);
+    applyTuningProfile(db);
+    if (!runMigrations(db)) { // Bringing the schema up to date before anything touches it
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return 1;
+    }
+    // WAL lets report connections read a snapshot while sales commit (the server does the same)
+    sqlite3_exec(db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, nullptr);
+    if (argc >= 2 && string(argv[1]) == "--check-plans") {
+        int status = checkQueryPlans(db);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 2 && string(argv[1]) == "--maintain") {
+        int sliceMs = argc >= 3 ? atoi(argv[2]) : 50;
+        int status;
+        { // The log's destructor unhooks the connection and writes out the last changes
+            ChangeLog changeLog(string("kennel_project.db") + CHANGE_LOG_SUFFIX);
+            changeLog.attach(db);
+            status = runMaintenance(db, max(1, sliceMs));
+        }
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 2 && string(argv[1]) == "--enable-incremental-vacuum") {
+        int status = enableIncrementalVacuum(db);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--backup") {
+        int pages = argc >= 4 ? atoi(argv[3]) : BACKUP_STEP_PAGES;
+        int pauseMs = argc >= 5 ? atoi(argv[4]) : BACKUP_PAUSE_MS;
+        int status = runBackup(db, argv[2], max(1, pages), max(0, pauseMs));
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--restore") {
+        int status = restoreBackup(db, argv[2]);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 4 && string(argv[1]) == "--purge") {
+        int chunkSize = argc >= 5 ? atoi(argv[4]) : CASCADE_CHUNK_SIZE;
+        int status;
+        { // The log's destructor unhooks the connection and writes out the last changes
+            ChangeLog changeLog(string("kennel_project.db") + CHANGE_LOG_SUFFIX);
+            changeLog.attach(db);
+            status = purgeRecords(db, argv[2], argv[3], chunkSize);
+        }
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--archive") {
+        int status;
+        { // The log's destructor unhooks the connection and writes out the last changes
+            ChangeLog changeLog(string("kennel_project.db") + CHANGE_LOG_SUFFIX);
+            changeLog.attach(db);
+            status = archiveHistory(db, atoi(argv[2]));
+        }
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--snapshot") {
+        int status = writeSalesSnapshot(db, argv[2]);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--bench-analytics") {
+        int status = benchmarkAnalytics(db, argv[2]);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-rows") {
+        int status = benchmarkRowDecoding(db, argc >= 3 ? atoi(argv[2]) : 5);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--ingest-sales") {
+        int batchSize = argc >= 4 ? atoi(argv[3]) : 1000;
+        int status;
+        { // The log's destructor unhooks the connection and writes out the last changes
+            ChangeLog changeLog(string("kennel_project.db") + CHANGE_LOG_SUFFIX);
+            changeLog.attach(db);
+            status = ingestSales(db, argv[2], batchSize);
+        }
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 2 && string(argv[1]) == "--backfill-rollups") {
+        int status = backfillRollups(db);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--export") {
+        string format = argc >= 4 ? argv[3] : "csv";
+        const char* path = argc >= 5 ? argv[4] : "-";
+        int clientId = argc >= 6 ? atoi(argv[5]) : 0;
+        int status = exportReport(db, argv[2], format, path, clientId);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    if (argc >= 3 && string(argv[1]) == "--import") {
+        int batchRows = argc >= 4 ? atoi(argv[3]) : 50000;
+        int status;
+        { // The log's destructor unhooks the connection and writes out the last changes
+            ChangeLog changeLog(string("kennel_project.db") + CHANGE_LOG_SUFFIX);
+            changeLog.attach(db);
+            status = importClientsAndPets(db, argv[2], batchRows);
+        }
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return status;
+    }
+    cout << "Connected to kennel_project.db successfully (" << activeTuningProfile->name << " profile).\n";
 
+    // Checkpoints come from a background thread instead of after this connection's commits
+    sqlite3_exec(db, "PRAGMA wal_autocheckpoint = 0;", nullptr, nullptr, nullptr);
+    WalCheckpointer checkpointer("kennel_project.db");
+    ChangeLog changeLog(string("kennel_project.db") + CHANGE_LOG_SUFFIX);
+    changeLog.attach(db);
+    // Batched writes are committed from another thread, so they get a connection of their own
+    sqlite3* writerDb = db;
+    if (durability == DURABILITY_BATCHED) {
+        if (sqlite3_open("kennel_project.db", &writerDb) != SQLITE_OK) {
+            cerr << "Failed to open database: " << sqlite3_errmsg(writerDb) << endl;
+            sqlite3_close(writerDb);
+            clearStatementCache(db);
+            sqlite3_close(db);
+            return 1;
+        }
+        sqlite3_busy_timeout(writerDb, 5000);
+        enableProfiling(writerDb);
+        applyTuningProfile(writerDb);
+        sqlite3_exec(writerDb, "PRAGMA wal_autocheckpoint = 0;", nullptr, nullptr, nullptr);
+        changeLog.attach(writerDb);
+    }
+    mutex writerMutex;
+    GroupCommitWriter writes(writerDb, writerMutex, durability);
+    unique_ptr<BackgroundBackup> backup; // From the connection the writes go through, so they never restart it
+    if (backupMinutes > 0) {
+        backup = make_unique<BackgroundBackup>(writerDb, writerMutex, string("kennel_project.db") + BACKUP_SUFFIX,
+                                               chrono::minutes(backupMinutes), nullptr);
+    }
+    BackgroundReport backgroundReport;
+    GroomingSchedule groomingSchedule; // Loaded on first use of the grooming desk
+    BoardingOccupancy boardingOccupancy; // Likewise for the boarding desk
     int choice;
     do { // Main loop for the menu
+        announceBackgroundReport(backgroundReport);
+        announceCommittedWrites();
         cout << "\n--- Kennel Management Menu ---" << endl;
         cout << "1. Add Record" << endl;
         cout << "2. Update Record" << endl;
@@ -51,7 +1551,15 @@ int promptForInt(const std::string& prompt);
         cout << "4. Process Transaction (Sale)" << endl;
         cout << "5. Report: Boarding History for Client" << endl;
         cout << "6. Report: Grooming Appointments" << endl;
-        cout << "7. Quit" << endl;
+        cout << "7. Search Clients, Pets & Medical Records" << endl;
+        cout << "8. Diagnostics" << endl;
+        cout << "9. Report: Revenue by Day/Week/Month" << endl;
+        cout << "10. Report: Top Items by Category" << endl;
+        cout << "11. Background Report Export" << endl;
+        cout << "12. Grooming Desk (Free Slots & Booking)" << endl;
+        cout << "13. Boarding Desk (Occupancy & Reservations)" << endl;
+        cout << "14. Client Profile (Check-In)" << endl;
+        cout << "15. Quit" << endl;
 
         choice = promptForInt("Enter choice: "); // Getting user input
         // Switch and case for handling the user choice
@@ -59,16 +1567,16 @@ int promptForInt(const std::string& prompt);
             case 1: { // Add menu choice
                 cout << "\nAdd Menu:\n1. Add Client\n2. Add Pet" << endl;
                 int sub = promptForInt("Enter choice: ");
-                if (sub == 1) addClient(db);
-                else if (sub == 2) addPet(db);
+                if (sub == 1) addClient(db, writes);
+                else if (sub == 2) addPet(db, writes);
                 else cout << "Invalid option." << endl;
                 break;
             }
             case 2: { // Update
                 cout << "\nUpdate Menu:\n1. Update Client\n2. Update Pet" << endl;
                 int sub = promptForInt("Enter choice: ");
-                if (sub == 1) updateClient(db);
-                else if (sub == 2) updatePet(db);
+                if (sub == 1) updateClient(db, writes);
+                else if (sub == 2) updatePet(db, writes);
                 else cout << "Invalid option." << endl;
                 break;
             }
@@ -81,7 +1589,7 @@ int promptForInt(const std::string& prompt);
                 break;
             }
             case 4: // Runs the transaction function for processing a sale
-                makeSaleTransaction(db);
+                makeSaleTransaction(db, writes);
                 break;
             case 5: // Displays a report for the boarding reservation
                 viewBoardingHistoryForClient(db);
@@ -89,15 +1597,56 @@ int promptForInt(const std::string& prompt);
             case 6: // Join for the grooming appointment
                 viewGroomingAppointments(db);
                 break;
-            case 7: // Exit the program
+            case 7: // Full-text search
+                searchRecords(db);
+                break;
+            case 8: // Latency histograms and per-statement profile
+                cout << endl;
+                writeDiagnostics(cout, 15);
+                printStatementCacheStats(db);
+                clientProfiles.printStats(cout);
+                changeLog.printStats(cout);
+                if (backup) backup->printStats(cout);
+                break;
+            case 9: // Revenue totals from the daily rollup
+                viewRevenueByPeriod(db);
+                break;
+            case 10: // Best sellers from the item rollup
+                viewTopItemsByCategory(db);
+                break;
+            case 11: // Export on a worker thread; the menu stays usable meanwhile
+                backgroundReportMenu(backgroundReport);
+                break;
+            case 12: // Availability from the in-memory slot index
+                groomingDeskMenu(db, groomingSchedule);
+                break;
+            case 13: // Nightly counts from the occupancy index
+                boardingDeskMenu(db, boardingOccupancy);
+                break;
+            case 14: // Everything about one client, from the profile cache when it was just looked up
+                clientProfileMenu(db);
+                break;
+            case 15: // Exit the program
                 cout << "Exiting..." << endl;
                 break;
             default:
                 cout << "Invalid choice." << endl;
         }
 
-    } while (choice != 7);
+    } while (choice != 15);
 
+    cancelBackgroundReport(backgroundReport); // A running export is stopped, not left half-written
+    writes.shutdown(); // Every queued write is committed before the program exits
+    backup.reset(); // A backup still copying is abandoned; the last complete one stays
+    announceCommittedWrites();
+    changeLog.detach(db); // Hooks must be gone before their connection closes
+    if (writerDb != db) {
+        changeLog.detach(writerDb);
+        clearStatementCache(writerDb);
+        sqlite3_close(writerDb);
+    }
+
+    clearStatementCache(db); // Cached statements must be finalized before closing
     sqlite3_close(db); // Closing the database
     return 0;
 }
@@ -119,263 +1668,778 @@ int promptForInt(const std::string& prompt);
     }
 }
 
-// Function for adding a new client to the table
- void addClient(sqlite3* db) {
-    string name, phone, email, address;
-    // Getting the client details
-    cout << "\n=== Add New Client ===" << endl;
-    cout << "Enter client name: ";
-    getline(cin, name);
-    cout << "Enter phone number: ";
-    getline(cin, phone);
-    cout << "Enter email: ";
-    getline(cin, email);
-    cout << "Enter address: ";
-    getline(cin, address);
-    // SQL insert statement using parameters 
-    const char* sql = "INSERT INTO client (client_name, phone, email, client_address) VALUES (?, ?, ?, ?);";
-    sqlite3_stmt* stmt;
-    // Preparing the SQL statement
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << endl;
-        return;
-    }
-    // Binding user input to the statement parameters
-    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, phone.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, email.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, address.c_str(), -1, SQLITE_TRANSIENT);
-    // Execute the statement and give a prompt if successful 
-    if (sqlite3_step(stmt) == SQLITE_DONE) {
-        cout << "✅ Client added successfully." << endl;
-    } else {
-        cerr << "❌ Failed to add client: " << sqlite3_errmsg(db) << endl;
-    }
-    // Finalize statement
-    sqlite3_finalize(stmt);
+// Registry of statement caches, one per open connection
+static map<sqlite3*, StatementCache> statementCaches;
+static mutex statementCachesMutex;
+
+// Getting (or creating) the statement cache for a connection
+StatementCache& statementCacheFor(sqlite3* db) {
+    lock_guard<mutex> lock(statementCachesMutex);
+    return statementCaches[db];
 }
 
-// Function for adding a pet to the table
-void addPet(sqlite3* db) {
-    string name, breed, medicalCondition, dietRestriction, emergencyContact;
-    int age, friendly, clientId;
-    // Getting the pet details
-    cout << "\n=== Add New Pet ===" << endl;
-    cout << "Enter pet name: ";
-    getline(cin, name);
-    cout << "Enter breed: ";
-    getline(cin, breed);
-    age = promptForInt("Enter age: ");
-    cout << "Enter medical condition (or leave blank): ";
-    getline(cin, medicalCondition);
-    cout << "Enter diet restriction (or leave blank): ";
-    getline(cin, dietRestriction);
-    // Validating the input for friendliness
-    while (true) {
-        friendly = promptForInt("Is the pet friendly? (1 = yes, 0 = no): ");
-        if (friendly == 0 || friendly == 1) break;
-        cout << "Please enter 1 (yes) or 0 (no)." << endl;
+// Finalizing all cached statements for a connection and dropping its cache
+void clearStatementCache(sqlite3* db) {
+    lock_guard<mutex> lock(statementCachesMutex);
+    auto it = statementCaches.find(db);
+    if (it == statementCaches.end()) return;
+    for (auto& item : it->second.entries) {
+        sqlite3_finalize(item.second.stmt);
     }
+    statementCaches.erase(it);
+}
 
-    cout << "Enter emergency contact: ";
-    getline(cin, emergencyContact);
-    clientId = promptForInt("Enter associated client ID: ");
-    // SQL insert statement with parameters ? is a placeholder
-    const char* sql = "INSERT INTO pet (pet_name, breed, age, medical_condition, diet_restriction, friendly, emergency_contact, client_id) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
-    
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) { // Preparing the SQL statement
-        cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << endl;
-        return;
-    }
-    // Binding values to the statement
-    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, breed.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 3, age);
-    sqlite3_bind_text(stmt, 4, medicalCondition.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, dietRestriction.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 6, friendly);
-    sqlite3_bind_text(stmt, 7, emergencyContact.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 8, clientId);
-    // Execute the statement and printing a message if successful
-    if (sqlite3_step(stmt) == SQLITE_DONE) {
-        cout << "✅ Pet added successfully." << endl;
-    } else {
-        cerr << "❌ Failed to add pet: " << sqlite3_errmsg(db) << endl;
-    }
-    // Finalizing the statement
-    sqlite3_finalize(stmt);
+// Printing the hit/miss counters for a connection's cache
+void printStatementCacheStats(sqlite3* db) {
+    StatementCache& cache = statementCacheFor(db);
+    long long total = cache.hits + cache.misses;
+    cout << "Statement cache: " << cache.entries.size() << " statements, "
+         << cache.hits << " hits, " << cache.misses << " misses";
+    if (total > 0) cout << " (" << (100.0 * cache.hits / total) << "% hit rate)";
+    cout << endl;
 }
 
-// Function for updating a client's information
-void updateClient(sqlite3* db) {
-    int clientId = promptForInt("\nEnter the client ID to update: "); // Getting the client ID to update it
-    // Preparing a SELECT query to fetch the current client information
-    const char* selectSQL = "SELECT client_name, phone, email, client_address FROM client WHERE client_id = ?;";
-    sqlite3_stmt* selectStmt;
-    // Compiling the SELECT statement
-    if (sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare SELECT statement: " << sqlite3_errmsg(db) << endl;
-        return;
+// Running a statement that takes no parameters and returns no rows (SAVEPOINT, RELEASE ...) from the cache
+bool runCachedStatement(sqlite3* db, const char* sql) {
+    CachedStatement stmt(db, sql);
+    return stmt && sqlite3_step(stmt) == SQLITE_DONE;
+}
+
+static Diagnostics diagnostics;
+static string metricsFilePath;
+
+// The calling thread's shard, picked up on its first record and given back when the thread ends
+static DiagnosticsShard& diagnosticsShard() {
+    struct Owner {
+        DiagnosticsShard* shard = nullptr;
+        ~Owner() {
+            if (!shard) return;
+            lock_guard<mutex> lock(diagnostics.lock);
+            diagnostics.idle.push_back(shard);
+        }
+    };
+    thread_local Owner owner;
+    if (!owner.shard) {
+        lock_guard<mutex> lock(diagnostics.lock);
+        if (!diagnostics.idle.empty()) {
+            owner.shard = diagnostics.idle.back();
+            diagnostics.idle.pop_back();
+        } else {
+            diagnostics.shards.push_back(make_unique<DiagnosticsShard>());
+            owner.shard = diagnostics.shards.back().get();
+        }
     }
-    // Binding the client ID to the SELECT statement
-    sqlite3_bind_int(selectStmt, 1, clientId);
-    if (sqlite3_step(selectStmt) != SQLITE_ROW) { // Executing the SELECT statement
-        cout << "❌ No client found with that ID." << endl;
-        sqlite3_finalize(selectStmt);
-        return;
+    return *owner.shard;
+}
+
+// trace_v2 callback: runs when a statement finishes. The stmt_status counters are read with reset,
+// so each run adds only its own full-scan steps, sorts and VM steps. SQLite's own clock is usually
+// millisecond-grained, so a single run's time is coarse but the totals and averages over many runs hold
+static int profileStatement(unsigned type, void*, void* p, void* x) {
+    if (type != SQLITE_TRACE_PROFILE) return 0;
+    sqlite3_stmt* stmt = static_cast<sqlite3_stmt*>(p);
+    double millis = *static_cast<sqlite3_int64*>(x) / 1e6;
+    int fullScanSteps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    int sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+    int autoIndexes = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+    int vmSteps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+    const char* sql = sqlite3_sql(stmt);
+    if (!sql) return 0;
+
+    DiagnosticsShard& shard = diagnosticsShard();
+    lock_guard<mutex> lock(shard.lock);
+    auto it = shard.queries.find(string_view(sql));
+    if (it == shard.queries.end()) {
+        shard.sqlText.emplace_back(sql);
+        it = shard.queries.emplace(string_view(shard.sqlText.back()), QueryProfile()).first;
     }
+    QueryProfile& profile = it->second;
+    profile.runs++;
+    profile.totalMillis += millis;
+    profile.maxMillis = max(profile.maxMillis, millis);
+    profile.fullScanSteps += fullScanSteps;
+    profile.sorts += sorts;
+    profile.autoIndexes += autoIndexes;
+    profile.vmSteps += vmSteps;
+    return 0;
+}
 
-    // Show current client information
-    cout << "\nCurrent values:" << endl;
-    cout << "Name: " << sqlite3_column_text(selectStmt, 0) << endl;
-    cout << "Phone: " << sqlite3_column_text(selectStmt, 1) << endl;
-    cout << "Email: " << sqlite3_column_text(selectStmt, 2) << endl;
-    cout << "Address: " << sqlite3_column_text(selectStmt, 3) << endl;
+// Installing the profile hook; it costs a clock read and a map update in the thread's own shard per statement run
+void enableProfiling(sqlite3* db) {
+    sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE, profileStatement, nullptr);
+}
 
-    sqlite3_finalize(selectStmt); // Cleaning up the SELECT statement before modification
+// Adding one sample to an operation's histogram
+void recordOperation(const char* name, double micros) {
+    int bucket = micros < 1 ? 0 : min(LATENCY_BUCKETS - 1, static_cast<int>(log2(micros) * 4));
+    DiagnosticsShard& shard = diagnosticsShard();
+    lock_guard<mutex> lock(shard.lock);
+    LatencyHistogram& histogram = shard.operations[string_view(name)];
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.totalMicros += micros;
+    histogram.maxMicros = max(histogram.maxMicros, micros);
+}
 
-    // Prompt for new values
-    string name, phone, email, address;
-    cout << "\nEnter new name: ";
-    getline(cin, name);
-    cout << "Enter new phone: ";
-    getline(cin, phone);
-    cout << "Enter new email: ";
-    getline(cin, email);
-    cout << "Enter new address: ";
-    getline(cin, address);
+OperationTimer::~OperationTimer() {
+    recordOperation(name, chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+}
 
-    const char* updateSQL = // Preparing the UPDATE SQL statement
-        "UPDATE client SET client_name = ?, phone = ?, email = ?, client_address = ? WHERE client_id = ?;";
-    
-    sqlite3_stmt* updateStmt; // Compiling the UPDATE statement
-    if (sqlite3_prepare_v2(db, updateSQL, -1, &updateStmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare UPDATE statement: " << sqlite3_errmsg(db) << endl;
-        return;
+// Upper edge of the bucket holding the p-th sample, in milliseconds (within 19% of the true value)
+static double histogramPercentile(const LatencyHistogram& histogram, double p) {
+    long long target = max(1LL, static_cast<long long>(ceil(p * histogram.count))), seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += histogram.buckets[bucket];
+        if (seen >= target) return min(histogram.maxMicros, exp2((bucket + 1) / 4.0)) / 1000.0;
     }
-    // Binding the new values and client ID to the statement
-    sqlite3_bind_text(updateStmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(updateStmt, 2, phone.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(updateStmt, 3, email.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(updateStmt, 4, address.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(updateStmt, 5, clientId);
+    return histogram.maxMicros / 1000.0;
+}
 
-    if (sqlite3_step(updateStmt) == SQLITE_DONE) { // Executing the UPDATE and printing a confirmation 
-        cout << "✅ Client updated successfully." << endl;
-    } else {
-        cerr << "❌ Failed to update client: " << sqlite3_errmsg(db) << endl;
+// Writing the operation histograms and the statement profiles, slowest statements (by total time) first
+void writeDiagnostics(ostream& out, size_t maxQueries) {
+    // Summing every thread's shard; the SQL keys stay valid because shards are never freed
+    unordered_map<string_view, LatencyHistogram> mergedOperations;
+    unordered_map<string_view, QueryProfile> mergedQueries;
+    {
+        lock_guard<mutex> lock(diagnostics.lock);
+        for (const auto& shard : diagnostics.shards) {
+            lock_guard<mutex> shardLock(shard->lock);
+            for (const auto& item : shard->operations) {
+                LatencyHistogram& histogram = mergedOperations[item.first];
+                for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) histogram.buckets[bucket] += item.second.buckets[bucket];
+                histogram.count += item.second.count;
+                histogram.totalMicros += item.second.totalMicros;
+                histogram.maxMicros = max(histogram.maxMicros, item.second.maxMicros);
+            }
+            for (const auto& item : shard->queries) {
+                QueryProfile& profile = mergedQueries[item.first];
+                profile.runs += item.second.runs;
+                profile.totalMillis += item.second.totalMillis;
+                profile.maxMillis = max(profile.maxMillis, item.second.maxMillis);
+                profile.fullScanSteps += item.second.fullScanSteps;
+                profile.sorts += item.second.sorts;
+                profile.autoIndexes += item.second.autoIndexes;
+                profile.vmSteps += item.second.vmSteps;
+            }
+        }
+    }
+
+    char line[256];
+    out << "=== Operation latency ===" << endl;
+    out << "Operation            |    Count |  Avg (ms) |  p50 (ms) |  p99 (ms) |  Max (ms)" << endl;
+    vector<pair<string_view, const LatencyHistogram*>> operations;
+    for (const auto& item : mergedOperations) operations.push_back({item.first, &item.second});
+    sort(operations.begin(), operations.end());
+    for (const auto& item : operations) {
+        const LatencyHistogram& histogram = *item.second;
+        snprintf(line, sizeof(line), "%-20.20s | %8lld | %9.3f | %9.3f | %9.3f | %9.3f",
+                 string(item.first).c_str(), histogram.count, histogram.totalMicros / histogram.count / 1000.0,
+                 histogramPercentile(histogram, 0.50), histogramPercentile(histogram, 0.99), histogram.maxMicros / 1000.0);
+        out << line << endl;
     }
 
-    sqlite3_finalize(updateStmt);
+    out << "\n=== Statements by total time ===" << endl;
+    out << "    Runs |  Total ms |   Avg ms |   Max ms | Scan steps |  Sorts | Auto idx |   VM steps | SQL" << endl;
+    vector<pair<string_view, const QueryProfile*>> queries;
+    for (const auto& item : mergedQueries) queries.push_back({item.first, &item.second});
+    sort(queries.begin(), queries.end(), [](const auto& a, const auto& b) { // VM steps break ties between sub-millisecond statements
+        if (a.second->totalMillis != b.second->totalMillis) return a.second->totalMillis > b.second->totalMillis;
+        return a.second->vmSteps > b.second->vmSteps;
+    });
+    if (maxQueries > 0 && queries.size() > maxQueries) queries.resize(maxQueries);
+    for (const auto& item : queries) {
+        const QueryProfile& profile = *item.second;
+        string sql; // SQL on one line, whitespace runs collapsed
+        for (char c : item.first) {
+            if (isspace(static_cast<unsigned char>(c))) {
+                if (!sql.empty() && sql.back() != ' ') sql += ' ';
+            } else {
+                sql += c;
+            }
+        }
+        if (maxQueries > 0 && sql.size() > 100) sql = sql.substr(0, 97) + "...";
+        snprintf(line, sizeof(line), "%8lld | %9.2f | %8.3f | %8.3f | %10lld | %6lld | %8lld | %10lld | ",
+                 profile.runs, profile.totalMillis, profile.totalMillis / profile.runs, profile.maxMillis,
+                 profile.fullScanSteps, profile.sorts, profile.autoIndexes, profile.vmSteps);
+        out << line << sql << endl;
+    }
 }
 
-// Function to update a pet's information
-void updatePet(sqlite3* db) {
-    int petId = promptForInt("\nEnter the pet ID to update: "); // Getting the pet ID to update
-    // Preparing a SELECT query to get the pet details
-    const char* selectSQL = "SELECT pet_name, breed, age, medical_condition, diet_restriction, friendly, emergency_contact, client_id FROM pet WHERE pet_id = ?;";
-    sqlite3_stmt* selectStmt;
-    // Compiling the SELECT statement
-    if (sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare SELECT statement: " << sqlite3_errmsg(db) << endl;
+static void writeMetricsFile() {
+    ofstream out(metricsFilePath);
+    if (!out) {
+        cerr << "❌ Could not write metrics to " << metricsFilePath << endl;
         return;
     }
-    // Binding the pet ID to the SELECT statement
-    sqlite3_bind_int(selectStmt, 1, petId);
-    if (sqlite3_step(selectStmt) != SQLITE_ROW) { // Checking if the pet exists
-        cout << "❌ No pet found with that ID." << endl;
-        sqlite3_finalize(selectStmt);
+    writeDiagnostics(out, 0);
+}
+
+void setMetricsFile(const char* path) {
+    metricsFilePath = path;
+    atexit(writeMetricsFile);
+}
+
+// Looking up a compiled statement, preparing and caching it on a miss
+CachedStatement::CachedStatement(sqlite3* db, const char* sql) {
+    StatementCache& cache = statementCacheFor(db);
+    if (cache.enabled) {
+        auto it = cache.entries.find(string_view(sql));
+        if (it != cache.entries.end() && !it->second.inUse) {
+            cache.hits++;
+            entry = &it->second;
+            entry->inUse = true;
+            stmt = entry->stmt;
+            return;
+        }
+        cache.misses++;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
+            return;
+        }
+        if (it == cache.entries.end()) { // Only cache the first copy; a nested borrow of the same SQL stays private
+            cache.sqlText.emplace_back(sql);
+            entry = &cache.entries.emplace(string_view(cache.sqlText.back()), StatementCache::Entry{stmt, true}).first->second;
+        }
         return;
     }
+    cache.misses++;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+    }
+}
 
-    // Showing current values
-    cout << "\nCurrent values:" << endl;
-    cout << "Name: " << sqlite3_column_text(selectStmt, 0) << endl;
-    cout << "Breed: " << sqlite3_column_text(selectStmt, 1) << endl;
-    cout << "Age: " << sqlite3_column_int(selectStmt, 2) << endl;
-    cout << "Medical Condition: " << sqlite3_column_text(selectStmt, 3) << endl;
-    cout << "Diet Restriction: " << sqlite3_column_text(selectStmt, 4) << endl;
-    cout << "Friendly: " << sqlite3_column_int(selectStmt, 5) << endl;
-    cout << "Emergency Contact: " << sqlite3_column_text(selectStmt, 6) << endl;
-    cout << "Client ID: " << sqlite3_column_int(selectStmt, 7) << endl;
+// Handing the statement back to the cache, or finalizing it if it was never cached
+void CachedStatement::release() {
+    if (!stmt) return;
+    if (entry) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        entry->inUse = false;
+    } else {
+        sqlite3_finalize(stmt);
+    }
+    entry = nullptr;
+    stmt = nullptr;
+}
 
-    sqlite3_finalize(selectStmt);
+// Applying every migration newer than the database's user_version, each in its own transaction
+bool runMigrations(sqlite3* db) {
+    int version = 0;
+    {
+        CachedStatement stmt(db, "PRAGMA user_version;");
+        if (stmt && sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
+    }
 
-    // Promptting for new values
-    string name, breed, medicalCondition, dietRestriction, emergencyContact;
-    int age, friendly, clientId;
+    for (const Migration& migration : MIGRATIONS) {
+        if (migration.version <= version) continue;
+        string sql = string("BEGIN TRANSACTION;") + migration.sql +
+                     "PRAGMA user_version = " + to_string(migration.version) + "; COMMIT;";
+        char* errMsg = nullptr;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK) {
+            cerr << "❌ Migration " << migration.version << " (" << migration.description << ") failed: " << errMsg << endl;
+            sqlite3_free(errMsg);
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            return false;
+        }
+        clog << "Applied migration " << migration.version << ": " << migration.description << endl;
+        if (migration.report) migration.report(db);
+        version = migration.version;
+    }
+    return true;
+}
 
-    cout << "\nEnter new name: ";
-    getline(cin, name);
-    cout << "Enter new breed: ";
-    getline(cin, breed);
-    age = promptForInt("Enter new age: ");
-    cout << "Enter new medical condition: ";
-    getline(cin, medicalCondition);
-    cout << "Enter new diet restriction: ";
-    getline(cin, dietRestriction);
-    
-    while (true) { // Friendliness field has to be a 0 or a 1
-        friendly = promptForInt("Is the pet friendly? (1 = yes, 0 = no): ");
-        if (friendly == 0 || friendly == 1) break;
+// Summing up what the foreign key check migration found. The rows stay in foreign_key_violation
+// until someone fixes or deletes them; until then updates that touch them fail with FOREIGN KEY errors
+void reportForeignKeyViolations(sqlite3* db) {
+    Query<tuple<>, tuple<string_view, string_view, sqlite3_int64>> stmt(db, R"(
+        SELECT table_name, parent, COUNT(*) FROM foreign_key_violation GROUP BY table_name, parent ORDER BY table_name, parent;
+    )");
+    if (!stmt) return;
+    long long total = 0;
+    stmt.run([&](string_view table, string_view parent, sqlite3_int64 rows) {
+        cerr << "⚠️  " << rows << " " << table << " rows point at missing " << parent << " rows" << endl;
+        total += rows;
+    });
+    if (total > 0) cerr << "⚠️  " << total << " foreign key violations listed in table foreign_key_violation" << endl;
+    else clog << "✅ No foreign key violations" << endl;
+}
+
+// Running EXPLAIN QUERY PLAN over each list/report page query and flagging table scans and temp sorts.
+// Only an unfiltered first page may scan, and only along the list's own key order (it stops after PAGE_SIZE
+// rows); cursor pages must seek. Name-filtered pages of a list without a scope must seek the prefix range on
+// the name index and sort just those matches, so their sort is reported but not failed; a scoped list's
+// filter only narrows its scope's ordered seek
+int checkQueryPlans(sqlite3* db) {
+    if (!attachArchives(db)) return 1; // The boarding list reads through the archive view
+    struct PlannedQuery { string name; string sql; const char* orderedScan; string prefixSeek; };
+    struct ListPlan { const PagedList* list; const char* orderedScan; };
+    const ListPlan lists[] = {
+        {&CLIENT_PICK_LIST, "SCAN client"},
+        {&PET_PICK_LIST, "SCAN pet"},
+        {&BOARDING_HISTORY_LIST, nullptr}, // Seeks the client's stays on idx_boarding_client_checkin
+        {&GROOMING_APPOINTMENTS_LIST, "SCAN g USING COVERING INDEX idx_grooming_date_time"},
+    };
+    vector<PlannedQuery> queries;
+    for (const ListPlan& plan : lists) {
+        const PagedList& list = *plan.list;
+        string column = list.filterColumn;
+        string prefixSeek = list.scope ? "" : "(" + column.substr(column.find('.') + 1) + ">? AND "; // As the plan shows it
+        queries.push_back({string(list.title) + " (first page)", pagedListSQL(list, false, false, false), plan.orderedScan, ""});
+        queries.push_back({string(list.title) + " (next page)", pagedListSQL(list, true, false, false), nullptr, ""});
+        queries.push_back({string(list.title) + " (previous page)", pagedListSQL(list, true, true, false), nullptr, ""});
+        queries.push_back({string(list.title) + " (filtered first page)", pagedListSQL(list, false, false, true), nullptr, prefixSeek});
+        queries.push_back({string(list.title) + " (filtered next page)", pagedListSQL(list, true, false, true), nullptr, prefixSeek});
+        queries.push_back({string(list.title) + " (filtered previous page)", pagedListSQL(list, true, true, true), nullptr, prefixSeek});
+    }
+
+    int failures = 0;
+    for (const PlannedQuery& query : queries) {
+        string sql = "EXPLAIN QUERY PLAN " + query.sql;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            cerr << "❌ " << query.name << ": " << sqlite3_errmsg(db) << endl;
+            failures++;
+            continue;
+        }
+        bool ok = true, seeksPrefix = false;
+        bool filtered = !query.prefixSeek.empty();
+        cout << query.name << ":" << endl;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            string detail = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+            bool fullScan = detail.compare(0, 5, "SCAN ") == 0 && !(query.orderedScan && detail == query.orderedScan);
+            bool tempSort = detail.find("USE TEMP B-TREE") != string::npos;
+            bool bad = fullScan || (tempSort && !filtered);
+            if (filtered && detail.compare(0, 7, "SEARCH ") == 0 && detail.find(query.prefixSeek) != string::npos) {
+                seeksPrefix = true;
+            }
+            if (bad) ok = false;
+            cout << "   " << (bad ? "❌ " : tempSort ? "⚠️  " : "   ") << detail << endl;
+        }
+        if (filtered && !seeksPrefix) { // Walking the keys and testing each name reads up to the whole table
+            cout << "   ❌ no seek on the name prefix range" << endl;
+            ok = false;
+        }
+        sqlite3_finalize(stmt);
+        if (!ok) failures++;
+    }
+
+    if (failures == 0) cout << "✅ All list and report queries use indexes." << endl;
+    else cerr << "❌ " << failures << " list or report queries still scan or sort." << endl;
+    return failures == 0 ? 0 : 1;
+}
+
+// Building the page query for a list. afterCursor adds the keyset condition on ?4.. (one per key);
+// backward walks the keys in reverse so the rows before the cursor come out nearest first
+string pagedListSQL(const PagedList& list, bool afterCursor, bool backward, bool filtered) {
+    string sql = string("SELECT ") + list.columns;
+    for (int k = 0; k < list.keyCount; k++) sql += string(", ") + list.keys[k];
+    sql += string(" FROM ") + list.from;
+
+    vector<string> conditions;
+    if (list.scope) conditions.push_back(list.scope);
+    if (filtered) { // Prefix range on the NOCASE name index: ?2 is the prefix, ?3 is the prefix plus the highest code point
+        conditions.push_back(string(list.filterColumn) + " >= ?2 COLLATE NOCASE AND " + list.filterColumn + " < ?3 COLLATE NOCASE");
+    }
+    if (afterCursor) {
+        // (k0, k1, ...) past the cursor, with a leading range on k0 so the index can seek to it
+        string nested;
+        for (int k = list.keyCount - 1; k >= 0; k--) {
+            string op = (list.descending[k] != backward) ? "<" : ">";
+            string param = "?" + to_string(4 + k);
+            string past = string(list.keys[k]) + " " + op + " " + param;
+            nested = nested.empty() ? past : past + " OR (" + list.keys[k] + " = " + param + " AND (" + nested + "))";
+        }
+        string leadingOp = (list.descending[0] != backward) ? "<=" : ">=";
+        conditions.push_back(string(list.keys[0]) + " " + leadingOp + " ?4 AND (" + nested + ")");
+    }
+    for (size_t i = 0; i < conditions.size(); i++) sql += (i ? " AND " : " WHERE ") + conditions[i];
+
+    sql += " ORDER BY ";
+    for (int k = 0; k < list.keyCount; k++) {
+        sql += string(k ? ", " : "") + list.keys[k] + ((list.descending[k] != backward) ? " DESC" : "");
+    }
+    return sql + " LIMIT " + to_string(PAGE_SIZE) + ";";
+}
+
+// Fetching one page of a list into memory, in display order. With a cursor the page starts just past it
+// (or, backward, ends just before it); without one it is the first page
+bool fetchPagedList(sqlite3* db, const PagedList& list, sqlite3_int64 scopeValue, const string& prefix,
+                    const vector<sqlite3_int64>* cursor, bool backward, vector<PageRow>& page) {
+    OperationTimer timer(list.title);
+    page.clear();
+    string sql = pagedListSQL(list, cursor != nullptr, backward && cursor, !prefix.empty());
+    CachedStatement stmt(db, sql.c_str());
+    if (!stmt) return false;
+    if (list.scope) sqlite3_bind_int64(stmt, 1, scopeValue);
+    string upper = prefix + "\xF4\x8F\xBF\xBF"; // U+10FFFF sorts after anything that starts with the prefix
+    if (!prefix.empty()) {
+        sqlite3_bind_text(stmt, 2, prefix.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, upper.c_str(), -1, SQLITE_STATIC);
+    }
+    for (int k = 0; cursor && k < list.keyCount; k++) sqlite3_bind_int64(stmt, 4 + k, (*cursor)[k]);
+
+    int keyOffset = sqlite3_column_count(stmt) - list.keyCount;
+    assert(keyOffset == list.formatColumns);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        ostringstream text;
+        list.formatRow(stmt, text);
+        PageRow row{text.str(), {}};
+        for (int k = 0; k < list.keyCount; k++) row.key.push_back(sqlite3_column_int64(stmt, keyOffset + k));
+        page.push_back(move(row));
+    }
+    if (rc != SQLITE_DONE) return false;
+    if (backward && cursor) reverse(page.begin(), page.end());
+    return true;
+}
+
+// Showing a list one page at a time: n = next page, p = previous page, /text = filter by name prefix,
+// "/" alone clears the filter and Enter leaves the list
+void browsePagedList(sqlite3* db, const PagedList& list, sqlite3_int64 scopeValue) {
+    vector<PageRow> rows;
+    vector<sqlite3_int64> cursor;
+    string prefix;
+    bool haveCursor = false, backward = false, atEnd = false;
+    int pageNumber = 1;
+
+    while (true) {
+        vector<PageRow> page;
+        if (!fetchPagedList(db, list, scopeValue, prefix, haveCursor ? &cursor : nullptr, backward, page)) {
+            cerr << "Query error: " << sqlite3_errmsg(db) << endl;
+            return;
+        }
+        if (backward && page.size() < static_cast<size_t>(PAGE_SIZE)) { // Ran into the start, just show the first page
+            haveCursor = backward = false;
+            pageNumber = 1;
+            continue;
+        }
+        if (page.empty() && haveCursor && !backward) {
+            cout << "(No more rows.)" << endl;
+            pageNumber--;
+            atEnd = true;
+        } else {
+            rows = move(page);
+            atEnd = rows.size() < static_cast<size_t>(PAGE_SIZE);
+        }
+
+        // Showing the page
+        cout << list.title << (prefix.empty() ? "" : " matching '" + prefix + "'") << " (page " << pageNumber << "):\n";
+        if (rows.empty()) cout << "(No rows.)\n";
+        for (const PageRow& row : rows) cout << row.text << '\n';
+        cout << "[n]ext, [p]revious, /name to filter, Enter to continue: " << flush;
+
+        // Reading the navigation command
+        string command;
+        while (true) {
+            if (!getline(cin, command) || command.empty()) return;
+            if (command == "n" && atEnd) cout << "Already at the last page. " << flush;
+            else if (command == "p" && !haveCursor) cout << "Already at the first page. " << flush;
+            else if (command == "n" || command == "p" || command[0] == '/') break;
+            else cout << "Unknown command. " << flush;
+        }
+        if (command[0] == '/') {
+            prefix = command.substr(1);
+            haveCursor = backward = false;
+            pageNumber = 1;
+        } else if (command == "n") {
+            cursor = rows.back().key;
+            haveCursor = true;
+            backward = false;
+            pageNumber++;
+        } else {
+            cursor = rows.front().key;
+            haveCursor = backward = true;
+            pageNumber--;
+        }
+    }
+}
+
+// "id: name" rows for the pick lists
+void formatIdNameRow(ostream& out, int id, optional<string_view> name) {
+    out << id << ": " << name.value_or("(Unnamed)");
+}
+
+// One boarding stay for the boarding history report
+void formatBoardingRow(ostream& out, optional<string_view> petName, int checkIn, int checkOut, double amount) {
+    out << "Pet: " << petName.value_or("(Unnamed)") << " | Check-In: " << checkIn << " | Check-Out: " << checkOut
+        << " | Amount: $" << static_cast<float>(amount); // Printed as the float it always was
+}
+
+// One appointment for the grooming appointments report
+void formatGroomingRow(ostream& out, int appointmentId, optional<string_view> clientName, optional<string_view> groomerName,
+                       int date, int time) {
+    out << "Appt ID: " << appointmentId << " | Client: " << clientName.value_or("(Unnamed)")
+        << " | Groomer: " << groomerName.value_or("(Unnamed)") << " | Date: " << date << " | Time: " << time;
+}
+
+// Results of batched menu writes, shown at the next menu prompt
+static mutex menuWriteMessagesMutex;
+static vector<string> menuWriteMessages;
+
+// Handing a menu write to the writer. apply sets the message to show: right away when the write is its
+// own transaction, or at the next menu prompt when it waits for a group commit
+static void submitMenuWrite(GroupCommitWriter& writes, function<bool(sqlite3*, string&)> apply) {
+    auto message = make_shared<string>();
+    bool batched = writes.durability() == DURABILITY_BATCHED;
+    writes.post([apply, message](sqlite3* db) { return apply(db, *message); }, [message, batched](bool committed) {
+        if (!committed && message->compare(0, strlen("✅"), "✅") == 0) *message = "❌ Not saved: the batch could not be committed.";
+        if (!batched) {
+            (message->compare(0, strlen("❌"), "❌") == 0 ? cerr : cout) << *message << endl;
+            return;
+        }
+        lock_guard<mutex> lock(menuWriteMessagesMutex);
+        menuWriteMessages.push_back(*message);
+    });
+    if (batched) cout << "Saving in the background; the result is shown at the next menu." << endl;
+}
+
+// Showing the results of batched writes committed since the last menu
+void announceCommittedWrites() {
+    lock_guard<mutex> lock(menuWriteMessagesMutex);
+    for (const string& message : menuWriteMessages) {
+        (message.compare(0, strlen("❌"), "❌") == 0 ? cerr : cout) << message << endl;
+    }
+    menuWriteMessages.clear();
+}
+
+// Inserting a client row, returns the new client_id or -1 on failure
+sqlite3_int64 insertClient(sqlite3* db, const ClientRecord& client) {
+    OperationTimer timer("add_client");
+    // SQL insert statement using parameters, the client details bound to them in order
+    Query<tuple<string_view, string_view, string_view, string_view>, tuple<>> stmt(
+        db, "INSERT INTO client (client_name, phone, email, client_address) VALUES (?, ?, ?, ?);");
+    if (!stmt || !stmt.exec(client.name, client.phone, client.email, client.address)) return -1;
+    return sqlite3_last_insert_rowid(db);
+}
+
+// Function for adding a new client to the table
+ void addClient(sqlite3*, GroupCommitWriter& writes) {
+    ClientRecord client;
+    // Getting the client details
+    cout << "\n=== Add New Client ===" << endl;
+    cout << "Enter client name: ";
+    getline(cin, client.name);
+    cout << "Enter phone number: ";
+    getline(cin, client.phone);
+    cout << "Enter email: ";
+    getline(cin, client.email);
+    cout << "Enter address: ";
+    getline(cin, client.address);
+    // Execute the insert and give a prompt if successful 
+    submitMenuWrite(writes, [client](sqlite3* db, string& message) {
+        if (insertClient(db, client) < 0) {
+            message = string("❌ Failed to add client: ") + sqlite3_errmsg(db);
+            return false;
+        }
+        message = "✅ Client added successfully.";
+        return true;
+    });
+}
+
+// The pet fields as parameters 1-8 (name through client ID), with the pet ID as 9 for updates
+using PetParams = tuple<string_view, string_view, int, string_view, string_view, int, string_view, int>;
+using PetUpdateParams = tuple<string_view, string_view, int, string_view, string_view, int, string_view, int, int>;
+
+// Inserting a pet row, returns the new pet_id or -1 on failure
+sqlite3_int64 insertPet(sqlite3* db, const PetRecord& pet) {
+    OperationTimer timer("add_pet");
+    // SQL insert statement with parameters ? is a placeholder
+    const char* sql = "INSERT INTO pet (pet_name, breed, age, medical_condition, diet_restriction, friendly, emergency_contact, client_id) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+    Query<PetParams, tuple<>> stmt(db, sql);
+    if (!stmt || !stmt.exec(pet.name, pet.breed, pet.age, pet.medicalCondition, pet.dietRestriction, pet.friendly,
+                            pet.emergencyContact, pet.clientId)) {
+        return -1;
+    }
+    clientProfiles.invalidateClient(pet.clientId);
+    return sqlite3_last_insert_rowid(db);
+}
+
+// Asking for the pet fields shared by add and update ("Enter " or "Enter new " prefixes the prompts)
+static void promptForPet(PetRecord& pet, const string& enter, bool adding) {
+    string hint = adding ? " (or leave blank)" : "";
+    cout << enter << (adding ? "pet name: " : "name: ");
+    getline(cin, pet.name);
+    cout << enter << "breed: ";
+    getline(cin, pet.breed);
+    pet.age = promptForInt(enter + "age: ");
+    cout << enter << "medical condition" << hint << ": ";
+    getline(cin, pet.medicalCondition);
+    cout << enter << "diet restriction" << hint << ": ";
+    getline(cin, pet.dietRestriction);
+    // Validating the input for friendliness
+    while (true) {
+        pet.friendly = promptForInt("Is the pet friendly? (1 = yes, 0 = no): ");
+        if (pet.friendly == 0 || pet.friendly == 1) break;
         cout << "Please enter 1 (yes) or 0 (no)." << endl;
     }
 
-    cout << "Enter new emergency contact: ";
-    getline(cin, emergencyContact);
-    clientId = promptForInt("Enter new associated client ID: ");
+    cout << enter << "emergency contact: ";
+    getline(cin, pet.emergencyContact);
+    pet.clientId = promptForInt(enter + "associated client ID: ");
+}
+
+// Function for adding a pet to the table
+void addPet(sqlite3*, GroupCommitWriter& writes) {
+    PetRecord pet;
+    // Getting the pet details
+    cout << "\n=== Add New Pet ===" << endl;
+    promptForPet(pet, "Enter ", true);
+    // Execute the insert and printing a message if successful
+    submitMenuWrite(writes, [pet](sqlite3* db, string& message) {
+        if (insertPet(db, pet) < 0) {
+            message = string("❌ Failed to add pet: ") + sqlite3_errmsg(db);
+            return false;
+        }
+        message = "✅ Pet added successfully.";
+        return true;
+    });
+}
+
+// Updating a client row, returns 1 if updated, 0 if there is no such client, -1 on failure
+int updateClientRecord(sqlite3* db, int clientId, const ClientRecord& client) {
+    OperationTimer timer("update_client");
+    const char* updateSQL = // Preparing the UPDATE SQL statement
+        "UPDATE client SET client_name = ?, phone = ?, email = ?, client_address = ? WHERE client_id = ?;";
+    // Getting the compiled UPDATE statement, the new values and client ID bound in order
+    Query<tuple<string_view, string_view, string_view, string_view, int>, tuple<>> updateStmt(db, updateSQL);
+    if (!updateStmt || !updateStmt.exec(client.name, client.phone, client.email, client.address, clientId)) return -1;
+    clientProfiles.invalidateClient(clientId);
+    return sqlite3_changes(db) > 0 ? 1 : 0;
+}
+
+// Function for updating a client's information
+void updateClient(sqlite3* db, GroupCommitWriter& writes) {
+    int clientId = promptForInt("\nEnter the client ID to update: "); // Getting the client ID to update it
+    // Preparing a SELECT query to fetch the current client information
+    const char* selectSQL = "SELECT client_name, phone, email, client_address FROM client WHERE client_id = ?;";
+    // Getting the compiled SELECT statement
+    Query<tuple<int>, tuple<string_view, string_view, string_view, string_view>> selectStmt(db, selectSQL);
+    if (!selectStmt) {
+        cerr << "Failed to prepare SELECT statement: " << sqlite3_errmsg(db) << endl;
+        return;
+    }
+    // Executing the SELECT statement and showing the current client information
+    bool found = false;
+    selectStmt.run(clientId, [&](string_view name, string_view phone, string_view email, string_view address) {
+        cout << "\nCurrent values:" << endl;
+        cout << "Name: " << name << endl;
+        cout << "Phone: " << phone << endl;
+        cout << "Email: " << email << endl;
+        cout << "Address: " << address << endl;
+        found = true;
+    });
+    if (!found) {
+        cout << "❌ No client found with that ID." << endl;
+        return;
+    }
+
+    selectStmt.release(); // Handing back the SELECT statement before waiting on input
+
+    // Prompt for new values
+    ClientRecord client;
+    cout << "\nEnter new name: ";
+    getline(cin, client.name);
+    cout << "Enter new phone: ";
+    getline(cin, client.phone);
+    cout << "Enter new email: ";
+    getline(cin, client.email);
+    cout << "Enter new address: ";
+    getline(cin, client.address);
+
+    submitMenuWrite(writes, [clientId, client](sqlite3* db, string& message) { // Executing the UPDATE and printing a confirmation
+        if (updateClientRecord(db, clientId, client) < 0) {
+            message = string("❌ Failed to update client: ") + sqlite3_errmsg(db);
+            return false;
+        }
+        message = "✅ Client updated successfully.";
+        return true;
+    });
+}
+
+// Updating a pet row, returns 1 if updated, 0 if there is no such pet, -1 on failure
+int updatePetRecord(sqlite3* db, int petId, const PetRecord& pet) {
+    OperationTimer timer("update_pet");
     // Preparing the UPDATE statement for pet
     const char* updateSQL =
         "UPDATE pet SET pet_name = ?, breed = ?, age = ?, medical_condition = ?, diet_restriction = ?, friendly = ?, emergency_contact = ?, client_id = ? "
         "WHERE pet_id = ?;";
-    // Compiling the UPDATE statement
-    sqlite3_stmt* updateStmt;
-    if (sqlite3_prepare_v2(db, updateSQL, -1, &updateStmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare UPDATE statement: " << sqlite3_errmsg(db) << endl;
+    // Getting the compiled UPDATE statement, the updated values bound in order
+    Query<PetUpdateParams, tuple<>> updateStmt(db, updateSQL);
+    if (!updateStmt || !updateStmt.exec(pet.name, pet.breed, pet.age, pet.medicalCondition, pet.dietRestriction, pet.friendly,
+                                        pet.emergencyContact, pet.clientId, petId)) {
+        return -1;
+    }
+    clientProfiles.invalidatePet(petId);          // The old owner's profile
+    clientProfiles.invalidateClient(pet.clientId); // And the new one's
+    return sqlite3_changes(db) > 0 ? 1 : 0;
+}
+
+// Function to update a pet's information
+void updatePet(sqlite3* db, GroupCommitWriter& writes) {
+    int petId = promptForInt("\nEnter the pet ID to update: "); // Getting the pet ID to update
+    // Preparing a SELECT query to get the pet details
+    const char* selectSQL = "SELECT pet_name, breed, age, medical_condition, diet_restriction, friendly, emergency_contact, client_id FROM pet WHERE pet_id = ?;";
+    // Getting the compiled SELECT statement
+    Query<tuple<int>, tuple<string_view, string_view, int, string_view, string_view, int, string_view, int>> selectStmt(db, selectSQL);
+    if (!selectStmt) {
+        cerr << "Failed to prepare SELECT statement: " << sqlite3_errmsg(db) << endl;
         return;
     }
-    // Binding the updated values to the UPDATE statement
-    sqlite3_bind_text(updateStmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(updateStmt, 2, breed.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(updateStmt, 3, age);
-    sqlite3_bind_text(updateStmt, 4, medicalCondition.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(updateStmt, 5, dietRestriction.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(updateStmt, 6, friendly);
-    sqlite3_bind_text(updateStmt, 7, emergencyContact.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(updateStmt, 8, clientId);
-    sqlite3_bind_int(updateStmt, 9, petId);
-
-    if (sqlite3_step(updateStmt) == SQLITE_DONE) { // Executing UPDATE
-        cout << "✅ Pet updated successfully." << endl;
-    } else {
-        cerr << "❌ Failed to update pet: " << sqlite3_errmsg(db) << endl;
+    // Checking if the pet exists and showing current values
+    bool found = false;
+    selectStmt.run(petId, [&](string_view name, string_view breed, int age, string_view condition, string_view diet, int friendly,
+                              string_view contact, int clientId) {
+        cout << "\nCurrent values:" << endl;
+        cout << "Name: " << name << endl;
+        cout << "Breed: " << breed << endl;
+        cout << "Age: " << age << endl;
+        cout << "Medical Condition: " << condition << endl;
+        cout << "Diet Restriction: " << diet << endl;
+        cout << "Friendly: " << friendly << endl;
+        cout << "Emergency Contact: " << contact << endl;
+        cout << "Client ID: " << clientId << endl;
+        found = true;
+    });
+    if (!found) {
+        cout << "❌ No pet found with that ID." << endl;
+        return;
     }
 
-    sqlite3_finalize(updateStmt); // Finalizing the statement
+    selectStmt.release();
+
+    // Promptting for new values
+    PetRecord pet;
+    cout << endl;
+    promptForPet(pet, "Enter new ", false);
+
+    submitMenuWrite(writes, [petId, pet](sqlite3* db, string& message) { // Executing UPDATE
+        if (updatePetRecord(db, petId, pet) < 0) {
+            message = string("❌ Failed to update pet: ") + sqlite3_errmsg(db);
+            return false;
+        }
+        message = "✅ Pet updated successfully.";
+        return true;
+    });
+}
+
+// Deleting a client row with its pets, bookings, medical records and sales.
+// Returns 1 if deleted, 0 if there is no such client, -1 on failure
+int deleteClientRecord(sqlite3* db, int clientId) {
+    OperationTimer timer("delete_client");
+    CascadeCounts counts;
+    if (!cascadeDelete(db, CASCADE_CLIENTS, "client_id = " + to_string(clientId), CASCADE_CHUNK_SIZE, counts)) return -1;
+    return counts.clients > 0 ? 1 : 0;
 }
 
 // Function to delete a client from the database
 void deleteClient(sqlite3* db) {
     cout << "\n==== Delete Client ====" << endl;
 
-    // Display all the clients for reference
-    const char* selectSQL = "SELECT client_id, client_name FROM client;";
-    sqlite3_stmt* selectStmt;
-
-    if (sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, nullptr) != SQLITE_OK) { // Preparing the SELECT statement
-        cerr << "Failed to prepare SELECT: " << sqlite3_errmsg(db) << endl;
-        return;
-    }
-    // Display the list of clients
-    cout << "Client List:\n";
-    while (sqlite3_step(selectStmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(selectStmt, 0);
-        const unsigned char* nameText = sqlite3_column_text(selectStmt, 1);
-        cout << id << ": " << (nameText ? reinterpret_cast<const char*>(nameText) : "(Unnamed)") << endl;
-    }
-    sqlite3_finalize(selectStmt);
+    // Display the clients a page at a time for reference
+    browsePagedList(db, CLIENT_PICK_LIST);
 
     // Prompt for ID to delete
     int clientId = promptForInt("Enter the client ID to delete: ");
@@ -389,46 +2453,135 @@ void deleteClient(sqlite3* db) {
         return;
     }
 
-    // Preparing the DELETE
-    const char* deleteSQL = "DELETE FROM client WHERE client_id = ?;";
-    sqlite3_stmt* deleteStmt;
-
-    if (sqlite3_prepare_v2(db, deleteSQL, -1, &deleteStmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare DELETE: " << sqlite3_errmsg(db) << endl;
-        return;
-    }
-
-    sqlite3_bind_int(deleteStmt, 1, clientId); // Bind the client ID to the DELETE statement
-
-    if (sqlite3_step(deleteStmt) == SQLITE_DONE) { // Execute the DELETE and print success
+    int deleted = deleteClientRecord(db, clientId); // Execute the DELETE and print the result
+    if (deleted > 0) {
         cout << "✅ Client deleted successfully." << endl;
+    } else if (deleted == 0) {
+        cout << "❌ No client found with ID " << clientId << endl;
     } else {
         cerr << "❌ Failed to delete client: " << sqlite3_errmsg(db) << endl;
     }
+}
+
+// Deleting a pet row with its medical records and boarding reservations.
+// Returns 1 if deleted, 0 if there is no such pet, -1 on failure
+int deletePetRecord(sqlite3* db, int petId) {
+    OperationTimer timer("delete_pet");
+    CascadeCounts counts;
+    if (!cascadeDelete(db, CASCADE_PETS, "pet_id = " + to_string(petId), CASCADE_CHUNK_SIZE, counts)) return -1;
+    return counts.pets > 0 ? 1 : 0;
+}
+
+// Sleeping as long as the last slice took, so other terminals get the database at least half the time
+static void yieldAfterSlice(chrono::steady_clock::time_point sliceStart) {
+    this_thread::sleep_for(chrono::steady_clock::now() - sliceStart);
+}
+
+// Running one step of a cascade and adding the rows it deleted to count
+static bool cascadeStep(sqlite3* db, const char* sql, long long& count) {
+    CachedStatement stmt(db, sql);
+    if (!stmt || sqlite3_step(stmt) != SQLITE_DONE) return false;
+    count += sqlite3_changes(db);
+    return true;
+}
+
+// Deleting the clients or pets matching where, and everything that refers to them, children first so
+// foreign keys hold at every step and ledger_item goes before general_ledger for the rollup triggers.
+// Each step is one set-based DELETE over a chunk of chunkSize parents, and each chunk is its own short
+// transaction with a pause after it, so a purge of thousands of clients never holds the write lock for
+// long. Inside a caller's transaction (a batched write) everything runs in one savepoint instead
+bool cascadeDelete(sqlite3* db, CascadeTarget target, const string& where, int chunkSize, CascadeCounts& counts) {
+    bool clients = target == CASCADE_CLIENTS;
+    bool ownTransactions = sqlite3_get_autocommit(db) != 0;
+    if (sqlite3_exec(db, R"(
+            CREATE TEMP TABLE IF NOT EXISTS cascade_targets (id INTEGER PRIMARY KEY);
+            CREATE TEMP TABLE IF NOT EXISTS cascade_chunk (id INTEGER PRIMARY KEY);
+            CREATE TEMP TABLE IF NOT EXISTS cascade_pets (id INTEGER PRIMARY KEY);
+            DELETE FROM temp.cascade_targets;
+        )", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    string selectSQL = clients ? "INSERT INTO temp.cascade_targets SELECT client_id FROM client WHERE " + where + ";"
+                               : "INSERT INTO temp.cascade_targets SELECT pet_id FROM pet WHERE " + where + ";";
+    if (sqlite3_exec(db, selectSQL.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) return false;
+    if (!ownTransactions) chunkSize = numeric_limits<int>::max();
+    // The targets were picked before the first chunk, so each chunk checks its rows against where again
+    // under its own write lock: a row another terminal changed in between no longer matches and is left alone
+    string recheckSQL = clients ? "DELETE FROM temp.cascade_chunk WHERE id NOT IN (SELECT client_id FROM client WHERE client_id IN (SELECT id FROM temp.cascade_chunk) AND (" + where + "));"
+                                : "DELETE FROM temp.cascade_chunk WHERE id NOT IN (SELECT pet_id FROM pet WHERE pet_id IN (SELECT id FROM temp.cascade_chunk) AND (" + where + "));";
 
-    sqlite3_finalize(deleteStmt); // Cleaning up
+    while (true) {
+        auto chunkStart = chrono::steady_clock::now();
+        size_t changes = ChangeLog::pendingChanges(db);
+        if (!runCachedStatement(db, ownTransactions ? "BEGIN IMMEDIATE;" : "SAVEPOINT cascade;")) return false;
+        bool ok;
+        long long taken = 0, parents = 0;
+        {
+            CachedStatement chunk(db, "INSERT INTO temp.cascade_chunk SELECT id FROM temp.cascade_targets ORDER BY id LIMIT ?;");
+            ok = runCachedStatement(db, "DELETE FROM temp.cascade_chunk;") && chunk;
+            if (ok) {
+                sqlite3_bind_int(chunk, 1, chunkSize);
+                ok = sqlite3_step(chunk) == SQLITE_DONE;
+                taken = sqlite3_changes(db);
+            }
+        }
+        long long ignored = 0;
+        if (ok && taken > 0) {
+            ok = cascadeStep(db, "DELETE FROM temp.cascade_targets WHERE id IN (SELECT id FROM temp.cascade_chunk);", ignored) &&
+                 sqlite3_exec(db, recheckSQL.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+            parents = taken - sqlite3_changes(db);
+        }
+        if (ok && parents > 0) { // Their profiles go now and again after the commit
+            CachedStatement chunkIds(db, "SELECT id FROM temp.cascade_chunk;");
+            ok = chunkIds;
+            while (ok && sqlite3_step(chunkIds) == SQLITE_ROW) {
+                if (clients) clientProfiles.invalidateClient(sqlite3_column_int(chunkIds, 0));
+                else clientProfiles.invalidatePet(sqlite3_column_int(chunkIds, 0));
+            }
+        }
+        if (ok && parents > 0) {
+            ok = runCachedStatement(db, "DELETE FROM temp.cascade_pets;") &&
+                 runCachedStatement(db, clients ? "INSERT INTO temp.cascade_pets SELECT pet_id FROM pet WHERE client_id IN (SELECT id FROM temp.cascade_chunk);"
+                                                : "INSERT INTO temp.cascade_pets SELECT id FROM temp.cascade_chunk;") &&
+                 cascadeStep(db, "DELETE FROM medical_record WHERE pet_id IN (SELECT id FROM temp.cascade_pets);", counts.medicalRecords) &&
+                 cascadeStep(db, "DELETE FROM boarding_reservation WHERE pet_id IN (SELECT id FROM temp.cascade_pets);", counts.boardingReservations);
+            if (ok && clients) {
+                ok = cascadeStep(db, "DELETE FROM boarding_reservation WHERE client_id IN (SELECT id FROM temp.cascade_chunk);", counts.boardingReservations) &&
+                     cascadeStep(db, "DELETE FROM grooming_appointment WHERE client_id IN (SELECT id FROM temp.cascade_chunk);", counts.groomingAppointments) &&
+                     cascadeStep(db, R"(
+                         DELETE FROM ledger_item WHERE ledger_id IN (
+                             SELECT general_ledger_id FROM general_ledger WHERE client_id IN (SELECT id FROM temp.cascade_chunk));
+                     )", counts.saleItems) &&
+                     cascadeStep(db, "DELETE FROM general_ledger WHERE client_id IN (SELECT id FROM temp.cascade_chunk);", counts.sales);
+            }
+            ok = ok && cascadeStep(db, "DELETE FROM pet WHERE pet_id IN (SELECT id FROM temp.cascade_pets);", counts.pets);
+            if (ok && clients) ok = cascadeStep(db, "DELETE FROM client WHERE client_id IN (SELECT id FROM temp.cascade_chunk);", counts.clients);
+        }
+        if (!ok) {
+            if (ownTransactions) sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            else {
+                sqlite3_exec(db, "ROLLBACK TO cascade;", nullptr, nullptr, nullptr);
+                ChangeLog::discardChanges(db, changes);
+                sqlite3_exec(db, "RELEASE cascade;", nullptr, nullptr, nullptr);
+            }
+            return false;
+        }
+        if (!runCachedStatement(db, ownTransactions ? "COMMIT;" : "RELEASE cascade;")) {
+            if (ownTransactions) sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            return false;
+        }
+        if (ownTransactions) clientProfiles.settle();
+        if (taken < chunkSize) return true;
+        yieldAfterSlice(chunkStart);
+    }
 }
 
 // Function to delete a pet
 void deletePet(sqlite3* db) {
     cout << "\n==== Delete Pet ====" << endl;
 
-    // Display all the pets for reference
-    const char* selectSQL = "SELECT pet_id, pet_name FROM pet;";
-    sqlite3_stmt* selectStmt;
-    // Preparing the SELECT statement
-    if (sqlite3_prepare_v2(db, selectSQL, -1, &selectStmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare SELECT: " << sqlite3_errmsg(db) << endl;
-        return;
-    }
-    // Displaying a list of the pets
-    cout << "Pet List:\n";
-    while (sqlite3_step(selectStmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(selectStmt, 0);
-        const unsigned char* nameText = sqlite3_column_text(selectStmt, 1);
-        cout << id << ": " << (nameText ? reinterpret_cast<const char*>(nameText) : "(Unnamed)") << endl;
-    }
-    sqlite3_finalize(selectStmt);
+    // Displaying the pets a page at a time
+    browsePagedList(db, PET_PICK_LIST);
 
     // Getting the ID to delete
     int petId = promptForInt("Enter the pet ID to delete: ");
@@ -442,227 +2595,5542 @@ void deletePet(sqlite3* db) {
         return;
     }
 
-    // Preparing the delete statement
-    const char* deleteSQL = "DELETE FROM pet WHERE pet_id = ?;";
-    sqlite3_stmt* deleteStmt;
-
-    if (sqlite3_prepare_v2(db, deleteSQL, -1, &deleteStmt, nullptr) != SQLITE_OK) {
-        cerr << "Failed to prepare DELETE: " << sqlite3_errmsg(db) << endl;
-        return;
-    }
-
-    sqlite3_bind_int(deleteStmt, 1, petId); // Binding the pet ID to the statement
-
-    if (sqlite3_step(deleteStmt) == SQLITE_DONE) { // Executing and reporting the result
+    int deleted = deletePetRecord(db, petId); // Executing and reporting the result
+    if (deleted > 0) {
         cout << "✅ Pet deleted successfully." << endl;
+    } else if (deleted == 0) {
+        cout << "❌ No pet found with ID " << petId << endl;
     } else {
         cerr << "❌ Failed to delete pet: " << sqlite3_errmsg(db) << endl;
     }
-
-    sqlite3_finalize(deleteStmt);
 }
 
-// Function to process a retail sale
-void makeSaleTransaction(sqlite3* db) {
-    cout << "\n==== New Sale Transaction ====" << endl;
-    // Getting all the transaction information
-    int clientId = promptForInt("Enter client ID: ");
-    int employeeId = promptForInt("Enter employee ID: ");
-    int date = promptForInt("Enter transaction date (e.g., 20230501): ");
-    int time = promptForInt("Enter transaction time (e.g., 1430 for 2:30 PM): ");
-    string paymentMethod;
-    cout << "Enter payment method: ";
-    getline(cin, paymentMethod);
-
-    // Beinning of a transaction below
-    char* errMsg = nullptr;
-    if (sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
-        cerr << "Failed to begin transaction: " << errMsg << endl;
-        sqlite3_free(errMsg);
-        return;
-    }
-
-    // Inserting blank transaction details for entry into the general_ledger table
+// Inserting the general_ledger row for a new sale, returns the ledger ID or -1 on failure
+int insertSaleLedger(sqlite3* db, const Sale& sale, float totalAmount) {
+    // The items are already reserved, so the row goes in with its final amount
     const char* insertLedgerSQL = R"(
         INSERT INTO general_ledger (ledger_date, ledger_time, item_or_service_purchase, amount, discount, payment_method, client_id, employee_id)
-        VALUES (?, ?, 'Retail Sale', 0.0, 0.0, ?, ?, ?);
+        VALUES (?, ?, 'Retail Sale', ?, 0.0, ?, ?, ?);
     )";
-    sqlite3_stmt* ledgerStmt;
-    if (sqlite3_prepare_v2(db, insertLedgerSQL, -1, &ledgerStmt, nullptr) != SQLITE_OK) {
+    Query<tuple<int, int, double, string_view, int, int>, tuple<>> ledgerStmt(db, insertLedgerSQL);
+    if (!ledgerStmt) {
         cerr << "Prepare failed: " << sqlite3_errmsg(db) << endl;
-        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-        return;
+        return -1;
     }
-    // Binding values into the statement for general_ledger
-    sqlite3_bind_int(ledgerStmt, 1, date);
-    sqlite3_bind_int(ledgerStmt, 2, time);
-    sqlite3_bind_text(ledgerStmt, 3, paymentMethod.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(ledgerStmt, 4, clientId);
-    sqlite3_bind_int(ledgerStmt, 5, employeeId);
-
-    if (sqlite3_step(ledgerStmt) != SQLITE_DONE) { // Executing the INSERT
+    // Executing the INSERT with the sale's values
+    if (!ledgerStmt.exec(sale.date, sale.time, totalAmount, sale.paymentMethod, sale.clientId, sale.employeeId)) {
         cerr << "Insert ledger failed: " << sqlite3_errmsg(db) << endl;
-        sqlite3_finalize(ledgerStmt);
-        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-        return;
+        return -1;
     }
-    sqlite3_finalize(ledgerStmt);
-
+    clientProfiles.invalidateClient(sale.clientId);
     // Getting the autogenerated ledger_id for reference
-    int ledgerId = sqlite3_last_insert_rowid(db);
+    return sqlite3_last_insert_rowid(db);
+}
 
-    float totalAmount = 0.0;
+// Taking quantity units of an item out of stock if there are enough, in one conditional UPDATE.
+// The check and the decrement are a single statement, so two terminals can never both sell the last unit.
+// The price is read afterwards under the same write lock; UPDATE ... RETURNING would do both in one
+// statement but SQLite buffers RETURNING rows in a temp table, which measured about twice as slow here
+SaleItemResult reserveSaleItem(sqlite3* db, int itemId, int quantity, float& totalAmount, int& available) {
+    const char* reserveSQL = "UPDATE retail_item SET stock_level = stock_level - ?1 WHERE item_id = ?2 AND stock_level >= ?1;";
+    Query<tuple<int, int>, tuple<>> reserveStmt(db, reserveSQL);
+    if (!reserveStmt) {
+        cerr << "Prepare stock update failed: " << sqlite3_errmsg(db) << endl;
+        return SALE_ITEM_ERROR;
+    }
+    if (!reserveStmt.exec(quantity, itemId)) {
+        cerr << "Stock update failed: " << sqlite3_errmsg(db) << endl;
+        return SALE_ITEM_ERROR;
+    }
+    if (sqlite3_changes(db) == 0) { // Nothing taken: only now look up why, so the normal path stays short
+        return checkSaleItem(db, itemId, quantity, available);
+    }
 
-    // Allowing the user to add one or more items into sale
-    while (true) {
-        int itemId = promptForInt("Enter item ID (0 to finish): ");
-        if (itemId == 0) break;
+    const char* priceSQL = "SELECT price FROM retail_item WHERE item_id = ?;";
+    Query<tuple<int>, tuple<double>> priceStmt(db, priceSQL);
+    if (!priceStmt) {
+        cerr << "Prepare price lookup failed: " << sqlite3_errmsg(db) << endl;
+        return SALE_ITEM_ERROR;
+    }
+    bool priced = false;
+    if (!priceStmt.run(itemId, [&](double price) { totalAmount += price * quantity; priced = true; }) || !priced) { // Update total
+        cerr << "Price lookup failed: " << sqlite3_errmsg(db) << endl;
+        return SALE_ITEM_ERROR;
+    }
+    return SALE_ITEM_OK;
+}
 
-        int quantity = promptForInt("Enter quantity: ");
+// Read-only stock check used for feedback while a sale is being entered, and to explain a failed reservation
+SaleItemResult checkSaleItem(sqlite3* db, int itemId, int quantity, int& available) {
+    const char* stockSQL = "SELECT stock_level FROM retail_item WHERE item_id = ?;";
+    Query<tuple<int>, tuple<int>> stockStmt(db, stockSQL);
+    if (!stockStmt) {
+        cerr << "Prepare stock check failed: " << sqlite3_errmsg(db) << endl;
+        return SALE_ITEM_ERROR;
+    }
+    bool found = false;
+    stockStmt.run(itemId, [&](int stock) { available = stock; found = true; });
+    if (!found) return SALE_ITEM_NOT_FOUND;
+    return quantity > available ? SALE_ITEM_NO_STOCK : SALE_ITEM_OK;
+}
 
-        // Checking stock to see if item is available and getting the item price
-        const char* stockSQL = "SELECT stock_level, price FROM retail_item WHERE item_id = ?;";
-        sqlite3_stmt* stockStmt;
-        if (sqlite3_prepare_v2(db, stockSQL, -1, &stockStmt, nullptr) != SQLITE_OK) {
-            cerr << "Prepare stock check failed: " << sqlite3_errmsg(db) << endl;
-            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-            return;
+// Writing all ledger_item rows of a sale with multi-row INSERTs
+bool insertLedgerItems(sqlite3* db, int ledgerId, const vector<SaleLine>& items) {
+    // The SQL for each row count is built once and reused by every sale
+    static const vector<string> insertSQL = [] {
+        vector<string> sql(IMPORT_ROWS_PER_INSERT + 1);
+        for (size_t rows = 1; rows <= IMPORT_ROWS_PER_INSERT; rows++) {
+            sql[rows] = multiRowInsertSQL("INSERT INTO ledger_item (ledger_id, item_id, quantity)", 3, static_cast<int>(rows));
         }
-        sqlite3_bind_int(stockStmt, 1, itemId);
-        if (sqlite3_step(stockStmt) != SQLITE_ROW) {
-            cerr << "Item not found." << endl;
-            sqlite3_finalize(stockStmt);
-            continue;
+        return sql;
+    }();
+    size_t done = 0;
+    while (done < items.size()) {
+        int rows = static_cast<int>(min<size_t>(IMPORT_ROWS_PER_INSERT, items.size() - done));
+        CachedStatement itemStmt(db, insertSQL[rows].c_str());
+        if (!itemStmt) {
+            cerr << "Prepare ledger item failed: " << sqlite3_errmsg(db) << endl;
+            return false;
         }
-
-        int currentStock = sqlite3_column_int(stockStmt, 0);
-        float price = sqlite3_column_double(stockStmt, 1);
-        sqlite3_finalize(stockStmt);
-
-        if (quantity > currentStock) { // Reject statement if there isn't enough 
-            cout << "Not enough stock. Available: " << currentStock << endl;
-            continue;
+        for (int r = 0; r < rows; r++) {
+            sqlite3_bind_int(itemStmt, r * 3 + 1, ledgerId);
+            sqlite3_bind_int(itemStmt, r * 3 + 2, items[done + r].itemId);
+            sqlite3_bind_int(itemStmt, r * 3 + 3, items[done + r].quantity);
         }
-
-        // Insert ledger_item entry for the item sold
-        const char* itemSQL = "INSERT INTO ledger_item (ledger_id, item_id, quantity) VALUES (?, ?, ?);";
-        sqlite3_stmt* itemStmt;
-        sqlite3_prepare_v2(db, itemSQL, -1, &itemStmt, nullptr);
-        sqlite3_bind_int(itemStmt, 1, ledgerId);
-        sqlite3_bind_int(itemStmt, 2, itemId);
-        sqlite3_bind_int(itemStmt, 3, quantity);
-
         if (sqlite3_step(itemStmt) != SQLITE_DONE) {
-            cerr << "Failed to insert ledger item: " << sqlite3_errmsg(db) << endl;
-            sqlite3_finalize(itemStmt);
-            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-            return;
+            cerr << "Failed to insert ledger items: " << sqlite3_errmsg(db) << endl;
+            return false;
         }
-        sqlite3_finalize(itemStmt);
+        done += rows;
+    }
+    return true;
+}
 
-        // Updating the stock levels
-        const char* updateStockSQL = "UPDATE retail_item SET stock_level = stock_level - ? WHERE item_id = ?;";
-        sqlite3_stmt* updateStmt;
-        sqlite3_prepare_v2(db, updateStockSQL, -1, &updateStmt, nullptr);
-        sqlite3_bind_int(updateStmt, 1, quantity);
-        sqlite3_bind_int(updateStmt, 2, itemId);
+// Function to process a retail sale
+void makeSaleTransaction(sqlite3* db, GroupCommitWriter& writes) {
+    cout << "\n==== New Sale Transaction ====" << endl;
+    // Getting all the transaction information
+    Sale sale;
+    sale.clientId = promptForInt("Enter client ID: ");
+    sale.employeeId = promptForInt("Enter employee ID: ");
+    sale.date = promptForInt("Enter transaction date (e.g., 20230501): ");
+    sale.time = promptForInt("Enter transaction time (e.g., 1430 for 2:30 PM): ");
+    cout << "Enter payment method: ";
+    getline(cin, sale.paymentMethod);
 
-        if (sqlite3_step(updateStmt) != SQLITE_DONE) {
-            cerr << "Stock update failed: " << sqlite3_errmsg(db) << endl;
-            sqlite3_finalize(updateStmt);
-            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-            return;
+    // Allowing the user to add one or more items into sale. Nothing is locked while typing;
+    // the stock is checked here for feedback and taken for real when the whole sale is submitted
+    while (true) {
+        int itemId = promptForInt("Enter item ID (0 to finish): ");
+        if (itemId == 0) break;
+
+        int quantity = promptForInt("Enter quantity: ");
+
+        int available = 0, alreadyInSale = 0;
+        for (const SaleLine& line : sale.items) {
+            if (line.itemId == itemId) alreadyInSale += line.quantity;
+        }
+        SaleItemResult result = checkSaleItem(db, itemId, quantity + alreadyInSale, available);
+        if (result == SALE_ITEM_NOT_FOUND) {
+            cerr << "Item not found." << endl;
+        } else if (result == SALE_ITEM_NO_STOCK) {
+            cout << "Not enough stock. Available: " << available - alreadyInSale << endl;
+        } else if (result == SALE_ITEM_OK) {
+            sale.items.push_back({itemId, quantity});
+        }
+    }
+
+    // Recording the whole sale in one short transaction
+    submitMenuWrite(writes, [sale](sqlite3* db, string& message) {
+        float totalAmount = 0.0;
+        string error;
+        if (!processSale(db, sale, totalAmount, error)) {
+            message = "❌ Sale not recorded: " + error;
+            return false;
+        }
+        ostringstream confirmation; // Confirmation for user
+        confirmation << "✅ Sale transaction completed successfully. Total charged: $" << totalAmount;
+        message = confirmation.str();
+        return true;
+    });
+}
+
+// Recording a complete sale without prompting, all items must succeed.
+// Runs under a savepoint: on its own it is a full transaction, inside a caller's batch a failed sale only undoes itself
+bool processSale(sqlite3* db, const Sale& sale, float& totalAmount, string& error) {
+    OperationTimer timer("sale");
+    totalAmount = 0.0;
+    size_t changes = ChangeLog::pendingChanges(db);
+    if (!runCachedStatement(db, "SAVEPOINT sale;")) {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+
+    // Taking every item out of stock first, which also prices the sale
+    for (const SaleLine& line : sale.items) {
+        int available = 0;
+        SaleItemResult result = reserveSaleItem(db, line.itemId, line.quantity, totalAmount, available);
+        if (result != SALE_ITEM_OK) {
+            if (result == SALE_ITEM_NOT_FOUND) error = "item " + to_string(line.itemId) + " not found";
+            else if (result == SALE_ITEM_NO_STOCK) error = "not enough stock for item " + to_string(line.itemId) + " (available " + to_string(available) + ")";
+            else error = sqlite3_errmsg(db);
+            sqlite3_exec(db, "ROLLBACK TO sale;", nullptr, nullptr, nullptr);
+            ChangeLog::discardChanges(db, changes);
+            sqlite3_exec(db, "RELEASE sale;", nullptr, nullptr, nullptr);
+            return false;
+        }
+    }
+
+    int ledgerId = insertSaleLedger(db, sale, totalAmount);
+    if (ledgerId < 0 || !insertLedgerItems(db, ledgerId, sale.items) || !runCachedStatement(db, "RELEASE sale;")) {
+        error = sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK TO sale;", nullptr, nullptr, nullptr);
+        ChangeLog::discardChanges(db, changes);
+        sqlite3_exec(db, "RELEASE sale;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    return true;
+}
+
+// Parsing one POS export line: client_id,employee_id,date,time,payment_method,item:qty[;item:qty...]
+bool parseSaleLine(const string& line, Sale& sale, string& error) {
+    vector<string> fields;
+    if (!splitCsvLine(line, fields)) {
+        error = "unterminated quote";
+        return false;
+    }
+    if (fields.size() != 6) {
+        error = "expected 6 fields, found " + to_string(fields.size());
+        return false;
+    }
+
+    char* end;
+    int* numbers[] = {&sale.clientId, &sale.employeeId, &sale.date, &sale.time};
+    for (int i = 0; i < 4; i++) {
+        long value = strtol(fields[i].c_str(), &end, 10);
+        if (fields[i].empty() || *end != '\0') {
+            error = "field " + to_string(i + 1) + " is not a number";
+            return false;
+        }
+        *numbers[i] = static_cast<int>(value);
+    }
+    sale.paymentMethod = fields[4];
+
+    // Items are item_id:quantity pairs separated by semicolons
+    sale.items.clear();
+    stringstream items(fields[5]);
+    string pair;
+    while (getline(items, pair, ';')) {
+        size_t colon = pair.find(':');
+        SaleLine item{0, 0};
+        if (colon != string::npos) {
+            item.itemId = static_cast<int>(strtol(pair.c_str(), &end, 10));
+            bool idOk = end == pair.c_str() + colon;
+            item.quantity = static_cast<int>(strtol(pair.c_str() + colon + 1, &end, 10));
+            if (!idOk || *end != '\0') colon = string::npos;
         }
-        sqlite3_finalize(updateStmt);
+        if (colon == string::npos || item.itemId <= 0 || item.quantity <= 0) {
+            error = "bad item entry '" + pair + "'";
+            return false;
+        }
+        sale.items.push_back(item);
+    }
+    if (sale.items.empty()) {
+        error = "sale has no items";
+        return false;
+    }
+    return true;
+}
 
-        totalAmount += price * quantity; // Update total 
+// Streaming a POS export into the ledger, committing every batchSize sales in one transaction.
+// Bad lines are reported and skipped without losing the rest of their batch
+int ingestSales(sqlite3* db, const char* csvPath, int batchSize) {
+    ifstream file(csvPath);
+    if (!file) {
+        cerr << "Failed to open " << csvPath << endl;
+        return 1;
     }
+    if (batchSize < 1) batchSize = 1;
+
+    long long lineNumber = 0, accepted = 0, rejected = 0, itemCount = 0, pending = 0;
+    string line, error;
+    Sale sale;
+    float total = 0.0;
+    auto start = chrono::steady_clock::now();
 
-    // Updating the total sale amount in the general_ledger
-    const char* updateLedgerTotal = "UPDATE general_ledger SET amount = ? WHERE general_ledger_id = ?;";
-    sqlite3_stmt* updateLedgerStmt;
-    sqlite3_prepare_v2(db, updateLedgerTotal, -1, &updateLedgerStmt, nullptr);
-    sqlite3_bind_double(updateLedgerStmt, 1, totalAmount);
-    sqlite3_bind_int(updateLedgerStmt, 2, ledgerId);
-    if (sqlite3_step(updateLedgerStmt) != SQLITE_DONE) {
-        cerr << "Failed to update ledger total: " << sqlite3_errmsg(db) << endl;
-        sqlite3_finalize(updateLedgerStmt);
+    while (getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back(); // Tolerating Windows line endings
+        if (line.empty()) continue;
+        if (lineNumber == 1 && !isdigit(static_cast<unsigned char>(line[0]))) continue; // Header row
+
+        if (pending == 0 && sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            cerr << "❌ Failed to begin transaction: " << sqlite3_errmsg(db) << endl;
+            return 1;
+        }
+
+        if (!parseSaleLine(line, sale, error) || !processSale(db, sale, total, error)) {
+            cerr << "Rejected line " << lineNumber << ": " << error << endl;
+            rejected++;
+        } else {
+            accepted++;
+            itemCount += sale.items.size();
+        }
+
+        if (++pending >= batchSize) {
+            if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+                cerr << "❌ Commit failed near line " << lineNumber << ": " << sqlite3_errmsg(db) << endl;
+                sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                return 1;
+            }
+            pending = 0;
+        }
+    }
+    if (pending > 0 && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "❌ Final commit failed: " << sqlite3_errmsg(db) << endl;
         sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-        return;
+        return 1;
     }
-    sqlite3_finalize(updateLedgerStmt);
 
-    // Committing the transaction assuming everything worked
-    if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, &errMsg) != SQLITE_OK) {
-        cerr << "Commit failed: " << errMsg << endl;
-        sqlite3_free(errMsg);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "✅ Ingested " << accepted << " sales (" << itemCount << " items), rejected " << rejected
+         << " lines in " << seconds << "s";
+    if (seconds > 0) cout << " — " << static_cast<long long>((accepted + rejected) / seconds) << " rows/sec";
+    cout << endl;
+    return rejected > 0 ? 2 : 0;
+}
+
+// Splitting one CSV line into fields, honouring double-quoted fields with "" escapes
+bool splitCsvLine(const string& line, vector<string>& fields) {
+    fields.clear();
+    string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') { field += '"'; i++; }
+            else if (c == '"') quoted = false;
+            else field += c;
+        } else if (c == '"' && field.empty()) {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return !quoted; // An unterminated quote means a broken line
+}
+
+// Appending a code point to a UTF-8 string
+static void appendUtf8(string& out, unsigned code) {
+    if (code < 0x80) out += static_cast<char>(code);
+    else if (code < 0x800) { out += static_cast<char>(0xC0 | (code >> 6)); out += static_cast<char>(0x80 | (code & 0x3F)); }
+    else if (code < 0x10000) { out += static_cast<char>(0xE0 | (code >> 12)); out += static_cast<char>(0x80 | ((code >> 6) & 0x3F)); out += static_cast<char>(0x80 | (code & 0x3F)); }
+    else {
+        out += static_cast<char>(0xF0 | (code >> 18)); out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F)); out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+// The four hex digits of a \u escape starting at line[at], or -1 when they are missing or not hex
+static int hexEscape(const string& line, size_t at) {
+    if (at + 4 > line.size()) return -1;
+    int code = 0;
+    for (size_t k = at; k < at + 4; k++) {
+        char c = line[k];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0) return -1;
+        code = code * 16 + digit;
+    }
+    return code;
+}
+
+// Parsing one flat JSON object ({"key": "text" | number | true | false | null, ...}); nulls are left out
+bool parseJsonObject(const string& line, map<string, string>& fields, string& error) {
+    fields.clear();
+    size_t i = 0;
+    auto skipSpace = [&]() { while (i < line.size() && isspace(static_cast<unsigned char>(line[i]))) i++; };
+    auto readString = [&](string& out) {
+        out.clear();
+        if (i >= line.size() || line[i] != '"') return false;
+        for (i++; i < line.size(); i++) {
+            char c = line[i];
+            if (c == '"') { i++; return true; }
+            if (c != '\\') { out += c; continue; }
+            if (++i >= line.size()) return false;
+            switch (line[i]) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': { // A surrogate pair (\uD83D\uDC36) is one code point
+                    int code = hexEscape(line, i + 1);
+                    if (code < 0 || (code >= 0xDC00 && code <= 0xDFFF)) return false;
+                    i += 4;
+                    if (code >= 0xD800 && code <= 0xDBFF) {
+                        int low = i + 2 < line.size() && line[i + 1] == '\\' && line[i + 2] == 'u' ? hexEscape(line, i + 3) : -1;
+                        if (low < 0xDC00 || low > 0xDFFF) return false;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                    appendUtf8(out, static_cast<unsigned>(code));
+                    break;
+                }
+                default: out += line[i]; // Covers \" \\ and \/
+            }
+        }
+        return false;
+    };
+
+    skipSpace();
+    if (i >= line.size() || line[i++] != '{') { error = "expected a JSON object"; return false; }
+    skipSpace();
+    if (i < line.size() && line[i] == '}') return true;
+    while (true) {
+        string key, value;
+        skipSpace();
+        if (!readString(key)) { error = "bad key"; return false; }
+        skipSpace();
+        if (i >= line.size() || line[i++] != ':') { error = "expected ':' after \"" + key + "\""; return false; }
+        skipSpace();
+        if (i < line.size() && line[i] == '"') {
+            if (!readString(value)) { error = "bad string for \"" + key + "\""; return false; }
+            fields[key] = value;
+        } else {
+            size_t start = i;
+            while (i < line.size() && line[i] != ',' && line[i] != '}' && !isspace(static_cast<unsigned char>(line[i]))) i++;
+            value = line.substr(start, i - start);
+            if (value.empty()) { error = "missing value for \"" + key + "\""; return false; }
+            if (value == "true") fields[key] = "1";
+            else if (value == "false") fields[key] = "0";
+            else if (value != "null") fields[key] = value;
+        }
+        skipSpace();
+        if (i < line.size() && line[i] == ',') { i++; continue; }
+        if (i < line.size() && line[i] == '}') return true;
+        error = "expected ',' or '}'";
+        return false;
+    }
+}
+
+// Building "INSERT ... VALUES (?,..),(?,..)" for the given number of rows
+string multiRowInsertSQL(const char* head, int columns, int rows) {
+    string row = "(";
+    for (int c = 0; c < columns; c++) row += c ? ",?" : "?";
+    row += ")";
+    string sql = head;
+    for (int r = 0; r < rows; r++) sql += (r ? "," : " VALUES ") + row;
+    return sql + ";";
+}
+
+// Binding text, or NULL for an empty optional field
+static void bindOptionalText(sqlite3_stmt* stmt, int index, const string& value) {
+    if (value.empty()) sqlite3_bind_null(stmt, index);
+    else sqlite3_bind_text(stmt, index, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
+}
+
+// Binding an integer, or NULL for an empty optional field
+static bool bindOptionalInt(sqlite3_stmt* stmt, int index, const string& value) {
+    if (value.empty()) { sqlite3_bind_null(stmt, index); return true; }
+    char* end;
+    long number = strtol(value.c_str(), &end, 10);
+    if (*end != '\0') return false;
+    sqlite3_bind_int(stmt, index, static_cast<int>(number));
+    return true;
+}
+
+// Writing the buffered clients with multi-row INSERTs and remembering the client_id each key received
+static bool flushImportClients(ClientImport& import) {
+    size_t done = 0;
+    while (done < import.clients.size()) {
+        int rows = static_cast<int>(min<size_t>(IMPORT_ROWS_PER_INSERT, import.clients.size() - done));
+        string sql = multiRowInsertSQL("INSERT INTO client (client_name, phone, email, client_address)", 4, rows);
+        CachedStatement stmt(import.db, sql.c_str());
+        if (!stmt) {
+            cerr << "❌ Failed to prepare client insert: " << sqlite3_errmsg(import.db) << endl;
+            return false;
+        }
+        for (int r = 0; r < rows; r++) {
+            const ImportClientRow& row = import.clients[done + r];
+            sqlite3_bind_text(stmt, r * 4 + 1, row.name.c_str(), static_cast<int>(row.name.size()), SQLITE_STATIC);
+            bindOptionalText(stmt, r * 4 + 2, row.phone);
+            bindOptionalText(stmt, r * 4 + 3, row.email);
+            bindOptionalText(stmt, r * 4 + 4, row.address);
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            cerr << "❌ Failed to insert clients: " << sqlite3_errmsg(import.db) << endl;
+            return false;
+        }
+        // AUTOINCREMENT hands out consecutive IDs within one statement, so the first row got last - rows + 1
+        sqlite3_int64 firstId = sqlite3_last_insert_rowid(import.db) - rows + 1;
+        for (int r = 0; r < rows; r++) {
+            const string& key = import.clients[done + r].key;
+            if (!key.empty()) import.clientIds[key] = firstId + r;
+        }
+        done += rows;
+    }
+    import.clientCount += import.clients.size();
+    import.clients.clear();
+    return true;
+}
+
+// Writing the buffered pets, resolving each owner key through the in-memory key map
+static bool flushImportPets(ClientImport& import) {
+    if (!flushImportClients(import)) return false; // Owners buffered earlier need their IDs first
+
+    // Dropping pets whose owner key never appeared
+    vector<sqlite3_int64> ownerIds;
+    size_t kept = 0;
+    for (ImportPetRow& row : import.pets) {
+        auto owner = import.clientIds.find(row.clientKey);
+        if (owner == import.clientIds.end()) {
+            cerr << "Rejected line " << row.lineNumber << ": unknown client key '" << row.clientKey << "'" << endl;
+            import.rejected++;
+            continue;
+        }
+        ownerIds.push_back(owner->second);
+        if (&import.pets[kept] != &row) import.pets[kept] = move(row);
+        kept++;
+    }
+    import.pets.resize(kept);
+
+    size_t done = 0;
+    while (done < import.pets.size()) {
+        int rows = static_cast<int>(min<size_t>(IMPORT_ROWS_PER_INSERT, import.pets.size() - done));
+        string sql = multiRowInsertSQL("INSERT INTO pet (pet_name, breed, age, medical_condition, diet_restriction, friendly, emergency_contact, client_id)", 8, rows);
+        CachedStatement stmt(import.db, sql.c_str());
+        if (!stmt) {
+            cerr << "❌ Failed to prepare pet insert: " << sqlite3_errmsg(import.db) << endl;
+            return false;
+        }
+        for (int r = 0; r < rows; r++) {
+            const ImportPetRow& row = import.pets[done + r];
+            int base = r * 8;
+            sqlite3_bind_text(stmt, base + 1, row.name.c_str(), static_cast<int>(row.name.size()), SQLITE_STATIC);
+            bindOptionalText(stmt, base + 2, row.breed);
+            bindOptionalInt(stmt, base + 3, row.age);
+            bindOptionalText(stmt, base + 4, row.medicalCondition);
+            bindOptionalText(stmt, base + 5, row.dietRestriction);
+            bindOptionalInt(stmt, base + 6, row.friendly);
+            bindOptionalText(stmt, base + 7, row.emergencyContact);
+            sqlite3_bind_int64(stmt, base + 8, ownerIds[done + r]);
+        }
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            cerr << "❌ Failed to insert pets: " << sqlite3_errmsg(import.db) << endl;
+            return false;
+        }
+        done += rows;
+    }
+    import.petCount += import.pets.size();
+    import.pets.clear();
+    return true;
+}
+
+// Turning one input line (CSV or JSONL) into a buffered client or pet row
+static bool parseImportLine(const string& line, bool json, long long lineNumber, ClientImport& import, string& error) {
+    vector<string> csv;
+    map<string, string> obj;
+    string type;
+    if (json) {
+        if (!parseJsonObject(line, obj, error)) return false;
+        type = obj["type"];
+    } else {
+        if (!splitCsvLine(line, csv)) { error = "unterminated quote"; return false; }
+        type = csv[0];
+    }
+
+    if (type == "client") {
+        ImportClientRow row;
+        if (json) {
+            row = {obj["key"], obj["name"], obj["phone"], obj["email"], obj["address"]};
+        } else {
+            if (csv.size() != 6) { error = "client lines need 6 fields, found " + to_string(csv.size()); return false; }
+            row = {csv[1], csv[2], csv[3], csv[4], csv[5]};
+        }
+        if (row.name.empty()) { error = "client name is required"; return false; }
+        import.clients.push_back(move(row));
+    } else if (type == "pet") {
+        ImportPetRow row;
+        if (json) {
+            row = {obj["client_key"], obj["name"], obj["breed"], obj["age"], obj["medical_condition"],
+                   obj["diet_restriction"], obj["friendly"], obj["emergency_contact"], lineNumber};
+        } else {
+            if (csv.size() != 9) { error = "pet lines need 9 fields, found " + to_string(csv.size()); return false; }
+            row = {csv[1], csv[2], csv[3], csv[4], csv[5], csv[6], csv[7], csv[8], lineNumber};
+        }
+        if (row.name.empty()) { error = "pet name is required"; return false; }
+        char* end;
+        if (!row.age.empty() && (strtol(row.age.c_str(), &end, 10), *end != '\0')) { error = "age is not a number"; return false; }
+        if (!row.friendly.empty() && row.friendly != "0" && row.friendly != "1") { error = "friendly must be 0 or 1"; return false; }
+        import.pets.push_back(move(row));
+    } else {
+        error = "unknown record type '" + type + "'";
+        return false;
+    }
+    return true;
+}
+
+// Reading one PRAGMA value as text
+static string readPragma(sqlite3* db, const char* pragma) {
+    string value;
+    CachedStatement stmt(db, pragma);
+    if (stmt && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+        value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    }
+    return value;
+}
+
+// Importing clients and pets from a .csv or .jsonl file in large batches.
+// Journaling and fsync are relaxed for the load and put back afterwards
+int importClientsAndPets(sqlite3* db, const char* path, int batchRows) {
+    ifstream file(path);
+    if (!file) {
+        cerr << "Failed to open " << path << endl;
+        return 1;
+    }
+    string pathText = path;
+    bool json = pathText.size() >= 6 && pathText.compare(pathText.size() - 6, 6, ".jsonl") == 0;
+    if (batchRows < 1) batchRows = 1;
+
+    // Relaxing durability for the load, the original settings are restored below
+    string journalMode = readPragma(db, "PRAGMA journal_mode;");
+    string synchronous = readPragma(db, "PRAGMA synchronous;");
+    sqlite3_exec(db, "PRAGMA journal_mode = MEMORY; PRAGMA synchronous = OFF;", nullptr, nullptr, nullptr);
+
+    ClientImport import;
+    import.db = db;
+    string line, error;
+    long long lineNumber = 0, pending = 0;
+    bool ok = sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    auto start = chrono::steady_clock::now();
+
+    while (ok && getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        if (!json && lineNumber == 1 && line.compare(0, 6, "client") != 0 && line.compare(0, 3, "pet") != 0) continue; // Header row
+
+        if (!parseImportLine(line, json, lineNumber, import, error)) {
+            cerr << "Rejected line " << lineNumber << ": " << error << endl;
+            import.rejected++;
+            continue;
+        }
+        if (import.clients.size() >= IMPORT_ROWS_PER_INSERT && !flushImportClients(import)) ok = false;
+        if (ok && import.pets.size() >= IMPORT_ROWS_PER_INSERT && !flushImportPets(import)) ok = false;
+
+        if (ok && ++pending >= batchRows) { // Closing out the batch
+            ok = flushImportPets(import) &&
+                 sqlite3_exec(db, "COMMIT; BEGIN TRANSACTION;", nullptr, nullptr, nullptr) == SQLITE_OK;
+            pending = 0;
+        }
+    }
+    if (ok) ok = flushImportPets(import) && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok) {
+        cerr << "❌ Import stopped near line " << lineNumber << ": " << sqlite3_errmsg(db) << endl;
         sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
-        return;
     }
 
-    cout << "✅ Sale transaction completed successfully. Total charged: $" << totalAmount << endl; // Confirmation for user
+    // Putting journaling and fsync back the way they were
+    string restore = "PRAGMA journal_mode = " + journalMode + "; PRAGMA synchronous = " + synchronous + ";";
+    sqlite3_exec(db, restore.c_str(), nullptr, nullptr, nullptr);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << (ok ? "✅" : "❌") << " Imported " << import.clientCount << " clients and " << import.petCount
+         << " pets, rejected " << import.rejected << " lines in " << seconds << "s";
+    if (seconds > 0) cout << " — " << static_cast<long long>((import.clientCount + import.petCount) / seconds) << " rows/sec";
+    cout << endl;
+    if (!ok) return 1;
+    return import.rejected > 0 ? 2 : 0;
 }
 
 // Function to display the boarding history for a client joining with pet table
 void viewBoardingHistoryForClient(sqlite3* db) {
     int clientId = promptForInt("\nEnter client ID to view their pet's boarding history: "); // Getting the client ID
-    // SQL query will join the boarding reservation and the pet table
-    const char* sql = R"(
-        SELECT pet.pet_name, boarding_reservation.check_in, boarding_reservation.check_out, boarding_reservation.amount
-        FROM boarding_reservation
-        JOIN pet ON boarding_reservation.pet_id = pet.pet_id
-        WHERE boarding_reservation.client_id = ?
-        ORDER BY boarding_reservation.check_in DESC;
-    )";
-    // Preparing the SQL query
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        cerr << "Query error: " << sqlite3_errmsg(db) << endl;
+    if (!attachArchives(db)) return; // Stays from archived years are part of the history
+    cout << "\n=== Boarding History ===\n";
+    browsePagedList(db, BOARDING_HISTORY_LIST, clientId); // Newest stays first, a page at a time
+}
+
+// Function to display all the grooming appointments with client and groomer info
+void viewGroomingAppointments(sqlite3* db) { 
+    cout << "\n=== Grooming Appointments ===\n";
+    browsePagedList(db, GROOMING_APPOINTMENTS_LIST); // Latest dates first, a page at a time
+}
+
+void ExportWriter::append(const char* data, size_t size) {
+    if (used + size > EXPORT_BUFFER_BYTES) {
+        flush();
+        if (size > EXPORT_BUFFER_BYTES) { // Too big to buffer, goes straight out
+            if (fwrite(data, 1, size, file) != size) writeFailed = true;
+            return;
+        }
+    }
+    memcpy(buffer.get() + used, data, size);
+    used += size;
+}
+
+void ExportWriter::appendInt(sqlite3_int64 value) {
+    char digits[24];
+    auto result = to_chars(digits, digits + sizeof(digits), value);
+    append(digits, result.ptr - digits);
+}
+
+void ExportWriter::appendCsvField(const char* text, size_t size) {
+    bool quote = false;
+    for (size_t i = 0; i < size && !quote; i++) {
+        quote = text[i] == ',' || text[i] == '"' || text[i] == '\n' || text[i] == '\r';
+    }
+    if (!quote) {
+        append(text, size);
         return;
     }
+    append('"');
+    size_t start = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] == '"') { // Doubling embedded quotes
+            append(text + start, i + 1 - start);
+            append('"');
+            start = i + 1;
+        }
+    }
+    append(text + start, size - start);
+    append('"');
+}
 
-    sqlite3_bind_int(stmt, 1, clientId); // Binding client ID to the statement
-    cout << "\n=== Boarding History ===\n";
-    while (sqlite3_step(stmt) == SQLITE_ROW) { // Step through rows and display
-        string petName = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        int checkIn = sqlite3_column_int(stmt, 1); // Check-In
-        int checkOut = sqlite3_column_int(stmt, 2); // Check-Out
-        float amount = sqlite3_column_double(stmt, 3); // Amount charged
+void ExportWriter::appendJsonString(const char* text, size_t size) {
+    static const char hex[] = "0123456789abcdef";
+    append('"');
+    size_t start = 0; // Runs of plain bytes are copied in one go; UTF-8 passes through unchanged
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        append(text + start, i - start);
+        start = i + 1;
+        if (c == '"' || c == '\\') {
+            append('\\');
+            append(static_cast<char>(c));
+        } else if (c == '\n') {
+            append("\\n", 2);
+        } else {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            append(escaped, sizeof(escaped));
+        }
+    }
+    append(text + start, size - start);
+    append('"');
+}
 
-        cout << "Pet: " << petName << " | Check-In: " << checkIn << " | Check-Out: " << checkOut << " | Amount: $" << amount << endl; // Outputting details 
+bool ExportWriter::flush() {
+    if (used > 0 && fwrite(buffer.get(), 1, used, file) != used) writeFailed = true;
+    used = 0;
+    return !writeFailed;
+}
+
+// Revenue per day, week (starting Monday) or month between two dates, from daily_revenue:
+// one row per day in the range is read, however many sales there were
+void viewRevenueByPeriod(sqlite3* db) {
+    cout << "\n=== Revenue by Period ===" << endl;
+    int fromDate = promptForInt("Enter start date (YYYYMMDD): ");
+    int toDate = promptForInt("Enter end date (YYYYMMDD): ");
+    int grouping = promptForInt("Group by 1. Day 2. Week 3. Month: ");
+    if (grouping < 1 || grouping > 3) {
+        cout << "Invalid option." << endl;
+        return;
+    }
+    const char* sql = R"(
+        SELECT CASE ?3
+                   WHEN 1 THEN ledger_date
+                   WHEN 2 THEN CAST(strftime('%Y%m%d', printf('%04d-%02d-%02d', ledger_date / 10000, ledger_date / 100 % 100, ledger_date % 100),
+                                             '-6 days', 'weekday 1') AS INTEGER)
+                   ELSE ledger_date / 100
+               END AS period,
+               SUM(sale_count), SUM(revenue)
+        FROM daily_revenue
+        WHERE ledger_date BETWEEN ?1 AND ?2
+        GROUP BY period ORDER BY period;
+    )";
+    Query<tuple<int, int, int>, tuple<int, sqlite3_int64, double>> stmt(db, sql);
+    if (!stmt) {
+        cerr << "Prepare failed: " << sqlite3_errmsg(db) << endl;
+        return;
     }
-    sqlite3_finalize(stmt);
+    const char* label = grouping == 1 ? "Date" : grouping == 2 ? "Week of" : "Month";
+    long long totalSales = 0;
+    double totalRevenue = 0;
+    char line[128];
+    bool ok = stmt.run(fromDate, toDate, grouping, [&](int period, sqlite3_int64 sales, double revenue) {
+        snprintf(line, sizeof(line), "%s: %d | Sales: %lld | Revenue: $%.2f", label, period, static_cast<long long>(sales), revenue);
+        cout << line << '\n';
+        totalSales += sales;
+        totalRevenue += revenue;
+    });
+    if (!ok) {
+        cerr << "❌ Report failed: " << sqlite3_errmsg(db) << endl;
+        return;
+    }
+    snprintf(line, sizeof(line), "Total: %lld sales | Revenue: $%.2f", totalSales, totalRevenue);
+    cout << line << endl;
 }
 
-// Function to display all the grooming appointments with client and groomer info
-void viewGroomingAppointments(sqlite3* db) { 
+// The five best-selling items (by units) in each category between two dates, from daily_item_sales
+void viewTopItemsByCategory(sqlite3* db) {
+    cout << "\n=== Top Items by Category ===" << endl;
+    int fromDate = promptForInt("Enter start date (YYYYMMDD): ");
+    int toDate = promptForInt("Enter end date (YYYYMMDD): ");
     const char* sql = R"(
-        SELECT g.appointment_id, c.client_name, gr.groomer_name, g.grooming_date, g.grooming_time
-        FROM grooming_appointment g
-        JOIN client c ON g.client_id = c.client_id
-        JOIN groomer gr ON g.groomer_id = gr.groomer_id
-        ORDER BY g.grooming_date DESC, g.grooming_time;
+        SELECT category, item_name, units FROM (
+            SELECT COALESCE(r.category, '(No category)') AS category,
+                   COALESCE(r.item_name, '(Item ' || d.item_id || ')') AS item_name,
+                   SUM(d.quantity) AS units,
+                   ROW_NUMBER() OVER (PARTITION BY COALESCE(r.category, '(No category)') ORDER BY SUM(d.quantity) DESC) AS place
+            FROM daily_item_sales d LEFT JOIN retail_item r ON r.item_id = d.item_id
+            WHERE d.ledger_date BETWEEN ?1 AND ?2
+            GROUP BY d.item_id
+        )
+        WHERE place <= 5 AND units > 0
+        ORDER BY category, units DESC;
     )";
-    // Preparing the SQL statement
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        cerr << "Query error: " << sqlite3_errmsg(db) << endl;
+    Query<tuple<int, int>, tuple<string_view, string_view, sqlite3_int64>> stmt(db, sql);
+    if (!stmt) {
+        cerr << "Prepare failed: " << sqlite3_errmsg(db) << endl;
+        return;
+    }
+    string category;
+    bool any = false;
+    bool ok = stmt.run(fromDate, toDate, [&](string_view rowCategory, string_view itemName, sqlite3_int64 units) {
+        if (!any || category != rowCategory) {
+            category = rowCategory;
+            cout << "\n" << category << ":" << '\n';
+        }
+        cout << "  " << itemName << " | Units: " << units << '\n';
+        any = true;
+    });
+    if (!ok) {
+        cerr << "❌ Report failed: " << sqlite3_errmsg(db) << endl;
         return;
     }
+    if (!any) cout << "No items sold in that range." << endl;
+    cout << flush;
+}
 
-    cout << "\n=== Grooming Appointments ===\n";
-    while (sqlite3_step(stmt) == SQLITE_ROW) { // Loop through the results and print details
-        int appointmentId = sqlite3_column_int(stmt, 0); // Appointment ID
-        string clientName = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)); // Client
-        string groomerName = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)); // Groomer
-        int date = sqlite3_column_int(stmt, 3); // Appointment date
-        int time = sqlite3_column_int(stmt, 4); // Appointment time
-        // Output information
-        cout << "Appt ID: " << appointmentId 
-             << " | Client: " << clientName 
-             << " | Groomer: " << groomerName 
-             << " | Date: " << date 
-             << " | Time: " << time << endl;
-    }
-    sqlite3_finalize(stmt);
+// An archive file's path: archives live next to the live database file
+static string archivePath(sqlite3* db, const string& file) {
+    string live = sqlite3_db_filename(db, "main");
+    size_t slash = live.rfind('/');
+    return slash == string::npos ? file : live.substr(0, slash + 1) + file;
+}
+
+// Recomputing daily_revenue and daily_item_sales from general_ledger and ledger_item, e.g. after rows were
+// loaded with the triggers bypassed. One transaction, so the reports never see a half-built rollup.
+// Archived years are summed first, each on its own connection and thread, so old years scan in parallel
+int backfillRollups(sqlite3* db) {
+    auto start = chrono::steady_clock::now();
+    struct ArchiveTotals {
+        string path;
+        vector<tuple<int, sqlite3_int64, double>> days;          // ledger_date, sale_count, revenue
+        vector<tuple<int, sqlite3_int64, sqlite3_int64>> items;  // ledger_date, item_id, quantity
+        string error;
+    };
+    vector<ArchiveTotals> archives;
+    {
+        Query<tuple<>, tuple<string_view>> stmt(db, "SELECT file FROM history_archive ORDER BY year;");
+        if (stmt) stmt.run([&](string_view file) { archives.push_back({archivePath(db, string(file)), {}, {}, ""}); });
+    }
+    vector<thread> scans;
+    for (ArchiveTotals& archive : archives) {
+        scans.emplace_back([&archive] {
+            sqlite3* reader;
+            if (sqlite3_open_v2(archive.path.c_str(), &reader, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+                archive.error = sqlite3_errmsg(reader);
+                sqlite3_close(reader);
+                return;
+            }
+            sqlite3_busy_timeout(reader, 5000);
+            applyTuningProfile(reader, findTuningProfile("reporting"));
+            {
+                Query<tuple<>, tuple<int, sqlite3_int64, double>> days(reader, "SELECT ledger_date, COUNT(*), TOTAL(amount) FROM general_ledger"
+                                                                               " WHERE ledger_date IS NOT NULL GROUP BY ledger_date;");
+                Query<tuple<>, tuple<int, sqlite3_int64, sqlite3_int64>> items(reader, R"(
+                    SELECT g.ledger_date, li.item_id, TOTAL(li.quantity)
+                    FROM ledger_item li JOIN general_ledger g ON g.general_ledger_id = li.ledger_id
+                    WHERE g.ledger_date IS NOT NULL
+                    GROUP BY g.ledger_date, li.item_id;)");
+                bool ok = days && items &&
+                          days.run([&](int date, sqlite3_int64 count, double revenue) { archive.days.emplace_back(date, count, revenue); }) &&
+                          items.run([&](int date, sqlite3_int64 itemId, sqlite3_int64 quantity) { archive.items.emplace_back(date, itemId, quantity); });
+                if (!ok) archive.error = sqlite3_errmsg(reader);
+            }
+            clearStatementCache(reader);
+            sqlite3_close(reader);
+        });
+    }
+    for (thread& scan : scans) scan.join();
+    for (const ArchiveTotals& archive : archives) {
+        if (archive.error.empty()) continue;
+        cerr << "❌ Backfill failed reading " << archive.path << ": " << archive.error << endl;
+        return 1;
+    }
+
+    char* errMsg = nullptr;
+    int rc = sqlite3_exec(db, R"(
+        BEGIN IMMEDIATE;
+        DELETE FROM daily_revenue;
+        DELETE FROM daily_item_sales;
+        INSERT INTO daily_revenue (ledger_date, sale_count, revenue)
+            SELECT ledger_date, COUNT(*), TOTAL(amount) FROM general_ledger WHERE ledger_date IS NOT NULL GROUP BY ledger_date;
+        INSERT INTO daily_item_sales (ledger_date, item_id, quantity)
+            SELECT g.ledger_date, li.item_id, TOTAL(li.quantity)
+            FROM ledger_item li JOIN general_ledger g ON g.general_ledger_id = li.ledger_id
+            WHERE g.ledger_date IS NOT NULL
+            GROUP BY g.ledger_date, li.item_id;
+    )", nullptr, nullptr, &errMsg);
+    // A month caught in both files by an interrupted --archive is counted once, from the live rows
+    bool ok = rc == SQLITE_OK;
+    {
+        Query<tuple<int, sqlite3_int64, double>, tuple<>> day(db, "INSERT OR IGNORE INTO daily_revenue (ledger_date, sale_count, revenue) VALUES (?1, ?2, ?3);");
+        Query<tuple<int, sqlite3_int64, sqlite3_int64>, tuple<>> item(db, "INSERT OR IGNORE INTO daily_item_sales (ledger_date, item_id, quantity) VALUES (?1, ?2, ?3);");
+        ok = ok && day && item;
+        for (size_t a = 0; ok && a < archives.size(); a++) {
+            for (size_t i = 0; ok && i < archives[a].days.size(); i++) {
+                ok = apply([&](auto... values) { return day.exec(values...); }, archives[a].days[i]);
+            }
+            for (size_t i = 0; ok && i < archives[a].items.size(); i++) {
+                ok = apply([&](auto... values) { return item.exec(values...); }, archives[a].items[i]);
+            }
+        }
+    }
+    ok = ok && runCachedStatement(db, "COMMIT;");
+    if (!ok) {
+        cerr << "❌ Backfill failed: " << (errMsg ? errMsg : sqlite3_errmsg(db)) << endl;
+        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long days = 0, itemDays = 0;
+    {
+        Query<tuple<>, tuple<sqlite3_int64, sqlite3_int64>> count(db, "SELECT (SELECT COUNT(*) FROM daily_revenue), (SELECT COUNT(*) FROM daily_item_sales);");
+        if (count) count.run([&](sqlite3_int64 dayRows, sqlite3_int64 itemRows) { days = dayRows, itemDays = itemRows; });
+    }
+    cout << "✅ Rebuilt rollups: " << days << " days, " << itemDays << " item-days in " << seconds << "s";
+    if (!archives.empty()) cout << " (" << archives.size() << " archive years scanned in parallel)";
+    cout << endl;
+    return 0;
+}
+
+const TuningProfile* findTuningProfile(const string& name) {
+    for (const TuningProfile& profile : TUNING_PROFILES) {
+        if (name == profile.name) return &profile;
+    }
+    return nullptr;
+}
+
+void applyTuningProfile(sqlite3* db, const TuningProfile* chosen) {
+    const TuningProfile& profile = chosen ? *chosen : *activeTuningProfile;
+    string pragmas = "PRAGMA cache_size = -" + to_string(profile.cacheKib) + ";"
+                     " PRAGMA mmap_size = " + to_string(profile.mmapBytes) + ";"
+                     " PRAGMA temp_store = MEMORY;"
+                     " PRAGMA foreign_keys = " + (profile.foreignKeys ? "ON" : "OFF") + ";"
+                     " PRAGMA threads = " + to_string(profile.sorterThreads) + ";";
+    sqlite3_exec(db, pragmas.c_str(), nullptr, nullptr, nullptr);
+}
+
+// Routine maintenance that can run while the kennel is open. Nothing holds the write lock for much
+// longer than sliceMs: statistics are gathered one table at a time with a sampling limit, and free
+// pages are handed back in incremental_vacuum steps sized to fit the slice
+int runMaintenance(sqlite3* db, int sliceMs) {
+    auto start = chrono::steady_clock::now();
+    sqlite3_exec(db, ("PRAGMA analysis_limit = " + to_string(MAINTENANCE_ANALYSIS_LIMIT) + ";").c_str(), nullptr, nullptr, nullptr);
+
+    // Planner statistics, table by table
+    vector<string> tables;
+    {
+        CachedStatement list(db, "SELECT name FROM sqlite_schema WHERE type = 'table' AND name NOT LIKE 'sqlite_%' AND sql NOT LIKE 'CREATE VIRTUAL%' ORDER BY name;");
+        if (!list) return 1;
+        while (sqlite3_step(list) == SQLITE_ROW) tables.push_back(reinterpret_cast<const char*>(sqlite3_column_text(list, 0)));
+    }
+    double longestSlice = 0;
+    for (const string& table : tables) {
+        auto sliceStart = chrono::steady_clock::now();
+        string analyzeSQL = "ANALYZE \"" + table + "\";";
+        if (sqlite3_exec(db, analyzeSQL.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+            cerr << "❌ ANALYZE " << table << " failed: " << sqlite3_errmsg(db) << endl;
+            return 1;
+        }
+        longestSlice = max(longestSlice, chrono::duration<double, milli>(chrono::steady_clock::now() - sliceStart).count());
+        yieldAfterSlice(sliceStart);
+    }
+    sqlite3_exec(db, "PRAGMA optimize;", nullptr, nullptr, nullptr);
+    cout << "✅ Statistics refreshed for " << tables.size() << " tables (longest slice " << longestSlice << " ms)" << endl;
+
+    // Free pages, a slice at a time
+    long long freePages = atoll(readPragma(db, "PRAGMA freelist_count;").c_str());
+    if (readPragma(db, "PRAGMA auto_vacuum;") != "2") {
+        if (freePages > 0) {
+            cout << "ℹ️  " << freePages << " free pages stay in the file: auto_vacuum is off. Run --enable-incremental-vacuum"
+                 << " once outside business hours so maintenance can return them." << endl;
+        }
+    } else {
+        long long pagesPerSlice = 64, released = 0;
+        int slices = 0;
+        longestSlice = 0;
+        while (freePages > 0) {
+            auto sliceStart = chrono::steady_clock::now();
+            string vacuumSQL = "BEGIN IMMEDIATE; PRAGMA incremental_vacuum(" + to_string(pagesPerSlice) + "); COMMIT;";
+            if (sqlite3_exec(db, vacuumSQL.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+                cerr << "❌ Incremental vacuum failed: " << sqlite3_errmsg(db) << endl;
+                sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                return 1;
+            }
+            double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - sliceStart).count();
+            longestSlice = max(longestSlice, elapsed);
+            long long remaining = atoll(readPragma(db, "PRAGMA freelist_count;").c_str());
+            slices++;
+            if (remaining >= freePages) { // Nothing came back (or others freed pages as fast): stop instead of spinning
+                cout << "⚠️  Incremental vacuum made no progress, " << remaining << " free pages left" << endl;
+                break;
+            }
+            released += freePages - remaining;
+            freePages = remaining;
+            // Sizing the next step so it takes about sliceMs
+            pagesPerSlice = clamp(static_cast<long long>(pagesPerSlice * sliceMs / max(elapsed, 0.1)), 16LL, 65536LL);
+            yieldAfterSlice(sliceStart);
+        }
+        cout << "✅ Released " << released << " free pages in " << slices << " slices (longest " << longestSlice << " ms)" << endl;
+    }
+
+    sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr); // Lets the file shrink
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "✅ Maintenance finished in " << seconds << "s" << endl;
+    return 0;
+}
+
+// Switching the database to incremental auto_vacuum. That needs a full VACUUM, which holds the
+// database for its whole run, so this is a one-time step for outside business hours
+int enableIncrementalVacuum(sqlite3* db) {
+    auto start = chrono::steady_clock::now();
+    if (sqlite3_exec(db, "PRAGMA auto_vacuum = INCREMENTAL; VACUUM;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "❌ VACUUM failed: " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "✅ Incremental vacuum enabled (auto_vacuum = " << readPragma(db, "PRAGMA auto_vacuum;") << ") in " << seconds << "s" << endl;
+    return 0;
+}
+
+WalCheckpointer::WalCheckpointer(const char* dbPath) {
+    string path = dbPath;
+    worker = thread([this, path] {
+        sqlite3* db;
+        if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+            cerr << "❌ Checkpoint connection failed: " << sqlite3_errmsg(db) << endl;
+            sqlite3_close(db);
+            return;
+        }
+        unique_lock<mutex> lock(stopMutex);
+        while (!stopRequested.wait_for(lock, chrono::seconds(1), [this] { return stopping; })) {
+            lock.unlock();
+            // PASSIVE never waits on readers or writers; it copies what no snapshot still needs
+            sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+            lock.lock();
+        }
+        lock.unlock();
+        sqlite3_close(db);
+    });
+}
+
+WalCheckpointer::~WalCheckpointer() {
+    {
+        lock_guard<mutex> lock(stopMutex);
+        stopping = true;
+    }
+    stopRequested.notify_all();
+    worker.join();
+}
+
+// Opening (or creating) the log. Under an exclusive flock, so two programs starting together agree: a torn
+// record at the end from a crash is cut off, and the shared sequence and slot are moved past the last record
+// in case the mapped header did not reach the disk
+ChangeLog::ChangeLog(const string& logPath) : path(logPath), ring(new Cell[CHANGE_RING_SIZE]) {
+    for (size_t i = 0; i < CHANGE_RING_SIZE; i++) ring[i].turn.store(i, memory_order_relaxed);
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644); // Not O_APPEND: records are written to their own slots
+    bool ok = fd >= 0 && flock(fd, LOCK_EX) == 0;
+    struct stat info;
+    ok = ok && fstat(fd, &info) == 0;
+    if (ok && info.st_size < static_cast<off_t>(sizeof(ChangeLogHeader))) {
+        ChangeLogHeader fresh = {};
+        memcpy(fresh.magic, CHANGE_LOG_MAGIC, sizeof(fresh.magic));
+        fresh.nextSequence = 1;
+        ok = ftruncate(fd, 0) == 0 && write(fd, &fresh, sizeof(fresh)) == static_cast<ssize_t>(sizeof(fresh));
+        info.st_size = sizeof(fresh);
+    }
+    if (ok) {
+        void* mapped = mmap(nullptr, sizeof(ChangeLogHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ok = mapped != MAP_FAILED;
+        if (ok) header = static_cast<ChangeLogHeader*>(mapped);
+    }
+    if (ok && memcmp(header->magic, CHANGE_LOG_MAGIC, sizeof(header->magic)) != 0) {
+        errno = EINVAL;
+        ok = false;
+    }
+    if (ok) {
+        off_t records = (info.st_size - sizeof(ChangeLogHeader)) / sizeof(ChangeRecord);
+        off_t end = sizeof(ChangeLogHeader) + records * sizeof(ChangeRecord);
+        ChangeRecord last;
+        if (end != info.st_size) ok = ftruncate(fd, end) == 0;
+        if (ok && records > 0 && pread(fd, &last, sizeof(last), end - sizeof(last)) == static_cast<ssize_t>(sizeof(last))) {
+            header->nextSequence = max(header->nextSequence, last.sequence + 1);
+        }
+        if (ok) header->nextSlot = max<uint64_t>(header->nextSlot, records);
+    }
+    if (fd >= 0) flock(fd, LOCK_UN);
+    if (!ok) {
+        cerr << "⚠️ Change log " << path << " unavailable (" << strerror(errno) << "), changes are not captured" << endl;
+        if (header) munmap(header, sizeof(ChangeLogHeader));
+        if (fd >= 0) close(fd);
+        header = nullptr;
+        fd = -1;
+        return;
+    }
+    drainThread = thread(&ChangeLog::drainLoop, this);
+}
+
+// The pending changes of every attached connection. Only the connection's own thread touches the list
+// itself (the hooks run inside its sqlite3_step), so the mutex only guards the map
+static map<sqlite3*, vector<ChangeRecord>*> capturedConnections;
+static mutex capturedConnectionsMutex;
+
+ChangeLog::~ChangeLog() {
+    {
+        lock_guard<mutex> lock(capturesMutex);
+        lock_guard<mutex> registryLock(capturedConnectionsMutex);
+        for (const unique_ptr<Capture>& capture : captures) {
+            capturedConnections.erase(capture->db);
+            unhook(*capture);
+        }
+    }
+    if (fd < 0) return;
+    stopping.store(true, memory_order_release);
+    drainThread.join();
+    munmap(header, sizeof(ChangeLogHeader));
+    close(fd);
+}
+
+void ChangeLog::attach(sqlite3* db) {
+    if (fd < 0) return;
+    lock_guard<mutex> lock(capturesMutex);
+    int autocheckpointPages = atoi(readPragma(db, "PRAGMA wal_autocheckpoint;").c_str());
+    captures.push_back(make_unique<Capture>(Capture{this, db, autocheckpointPages, {}, {}, 0}));
+    Capture* capture = captures.back().get();
+    {
+        lock_guard<mutex> registryLock(capturedConnectionsMutex);
+        capturedConnections[db] = &capture->pending;
+    }
+    sqlite3_update_hook(db, onUpdate, capture);
+    sqlite3_commit_hook(db, onCommit, capture);
+    sqlite3_rollback_hook(db, onRollback, capture);
+    sqlite3_wal_hook(db, onWalCommit, capture);
+}
+
+void ChangeLog::detach(sqlite3* db) {
+    lock_guard<mutex> lock(capturesMutex);
+    for (auto capture = captures.begin(); capture != captures.end(); ++capture) {
+        if ((*capture)->db != db) continue;
+        {
+            lock_guard<mutex> registryLock(capturedConnectionsMutex);
+            capturedConnections.erase(db);
+        }
+        unhook(**capture);
+        captures.erase(capture);
+        return;
+    }
+}
+
+// Settling a commit the hooks have not seen finish (outside WAL mode): it worked if the connection is back
+// in autocommit, since a failed COMMIT leaves the transaction open or calls the rollback hook. Then the hooks
+// come off and the connection's own automatic checkpoints are put back
+void ChangeLog::unhook(Capture& capture) {
+    if (!capture.committing.empty()) publish(capture, sqlite3_get_autocommit(capture.db) != 0);
+    sqlite3_update_hook(capture.db, nullptr, nullptr);
+    sqlite3_commit_hook(capture.db, nullptr, nullptr);
+    sqlite3_rollback_hook(capture.db, nullptr, nullptr);
+    sqlite3_wal_autocheckpoint(capture.db, capture.autocheckpointPages);
+}
+
+// Runs inside sqlite3_step for every row change, so it only compares the table name and notes the row. A
+// commit still held back here has worked: a new transaction is writing (outside WAL mode, where no WAL hook
+// said so; a COMMIT that fails is rolled back before anything else is written)
+void ChangeLog::onUpdate(void* data, int operation, const char* schema, const char* table, sqlite3_int64 rowid) {
+    if (strcmp(schema, "main") != 0) return; // Archive files and temp tables are not captured
+    uint8_t code = strcmp(table, "client") == 0 ? CHANGE_CLIENT : strcmp(table, "pet") == 0 ? CHANGE_PET :
+                   strcmp(table, "general_ledger") == 0 ? CHANGE_LEDGER : strcmp(table, "boarding_reservation") == 0 ? CHANGE_BOARDING : 0;
+    if (code == 0) return;
+    Capture* capture = static_cast<Capture*>(data);
+    if (!capture->committing.empty()) capture->log->publish(*capture, true);
+    ChangeRecord record = {};
+    record.rowid = rowid;
+    record.table = code;
+    record.operation = operation == SQLITE_INSERT ? CHANGE_INSERT : operation == SQLITE_DELETE ? CHANGE_DELETE : CHANGE_UPDATE;
+    capture->pending.push_back(record);
+}
+
+// Called while the connection still holds the write lock, so no other connection or process can take a
+// sequence number or slot in between: the numbers follow commit order and the slots follow the numbers.
+// Nothing is written out yet, as the commit can still fail. A COMMIT retried after SQLITE_BUSY finds
+// nothing pending and keeps the records it stamped the first time
+int ChangeLog::onCommit(void* data) {
+    Capture* capture = static_cast<Capture*>(data);
+    if (capture->pending.empty()) return 0;
+    ChangeLogHeader* header = capture->log->header;
+    uint64_t sequence = __atomic_fetch_add(&header->nextSequence, 1, __ATOMIC_SEQ_CST);
+    capture->firstSlot = __atomic_fetch_add(&header->nextSlot, capture->pending.size(), __ATOMIC_SEQ_CST);
+    uint32_t now = static_cast<uint32_t>(time(nullptr));
+    for (ChangeRecord& record : capture->pending) {
+        record.sequence = sequence;
+        record.commitTime = now;
+    }
+    capture->committing.swap(capture->pending);
+    capture->pending.clear();
+    return 0;
+}
+
+// A failed COMMIT lands here too (SQLite rolls the transaction back), after the commit hook took its slots
+void ChangeLog::onRollback(void* data) {
+    Capture* capture = static_cast<Capture*>(data);
+    capture->pending.clear();
+    if (!capture->committing.empty()) capture->log->publish(*capture, false);
+}
+
+// Called by SQLite after a commit in WAL mode has been written, so the held back records are committed.
+// This replaces the connection's automatic checkpoint hook, so it checkpoints the same way
+int ChangeLog::onWalCommit(void* data, sqlite3* db, const char* schema, int walPages) {
+    Capture* capture = static_cast<Capture*>(data);
+    if (!capture->committing.empty()) capture->log->publish(*capture, true);
+    if (capture->autocheckpointPages > 0 && walPages >= capture->autocheckpointPages) sqlite3_wal_checkpoint(db, schema);
+    return SQLITE_OK;
+}
+
+void ChangeLog::publish(Capture& capture, bool committed) {
+    for (size_t i = 0; i < capture.committing.size(); i++) {
+        ChangeRecord record = capture.committing[i];
+        if (!committed) { // Keeps the sequence, so the slot still reads in order
+            record.rowid = 0;
+            record.table = 0;
+            record.operation = CHANGE_VOID;
+        }
+        push(record, capture.firstSlot + i);
+    }
+    if (committed) {
+        captured += static_cast<long long>(capture.committing.size());
+        commits++;
+    } else {
+        voided += static_cast<long long>(capture.committing.size());
+    }
+    capture.committing.clear();
+}
+
+size_t ChangeLog::pendingChanges(sqlite3* db) {
+    lock_guard<mutex> lock(capturedConnectionsMutex);
+    auto it = capturedConnections.find(db);
+    return it == capturedConnections.end() ? 0 : it->second->size();
+}
+
+void ChangeLog::discardChanges(sqlite3* db, size_t from) {
+    lock_guard<mutex> lock(capturedConnectionsMutex);
+    auto it = capturedConnections.find(db);
+    if (it != capturedConnections.end() && it->second->size() > from) it->second->resize(from);
+}
+
+// With nothing else writing, the next sequence number and slot cannot be taken by a commit in between
+void ChangeLog::resync() {
+    if (fd < 0) return;
+    ChangeRecord record = {};
+    record.sequence = __atomic_fetch_add(&header->nextSequence, 1, __ATOMIC_SEQ_CST);
+    record.commitTime = static_cast<uint32_t>(time(nullptr));
+    record.operation = CHANGE_RESYNC;
+    push(record, __atomic_fetch_add(&header->nextSlot, 1, __ATOMIC_SEQ_CST));
+    commits++;
+}
+
+// Bounded multi-producer queue: each cell's turn says whether it is free for the producer at that position
+// or full for the drain thread. A full ring makes the committing thread wait for the drain thread
+void ChangeLog::push(const ChangeRecord& record, uint64_t slot) {
+    size_t position = tail.load(memory_order_relaxed);
+    while (true) {
+        Cell& cell = ring[position & (CHANGE_RING_SIZE - 1)];
+        size_t turn = cell.turn.load(memory_order_acquire);
+        if (turn == position) {
+            if (tail.compare_exchange_weak(position, position + 1, memory_order_relaxed)) {
+                cell.record = record;
+                cell.slot = slot;
+                cell.turn.store(position + 1, memory_order_release);
+                return;
+            }
+        } else if (turn < position) {
+            ringWaits++;
+            this_thread::yield();
+            position = tail.load(memory_order_relaxed);
+        } else {
+            position = tail.load(memory_order_relaxed);
+        }
+    }
+}
+
+bool ChangeLog::pop(ChangeRecord& record, uint64_t& slot) {
+    Cell& cell = ring[head & (CHANGE_RING_SIZE - 1)];
+    if (cell.turn.load(memory_order_acquire) != head + 1) return false;
+    record = cell.record;
+    slot = cell.slot;
+    cell.turn.store(head + CHANGE_RING_SIZE, memory_order_release);
+    head++;
+    return true;
+}
+
+// Writing each run of records with consecutive slots in one pwrite. Other processes fill the slots in
+// between, so the file can briefly have unwritten (all-zero) records before the last one
+void ChangeLog::drainLoop() {
+    vector<ChangeRecord> batch;
+    batch.reserve(1024);
+    uint64_t batchSlot = 0;
+    auto lastSync = chrono::steady_clock::now();
+    bool unsynced = false;
+    auto writeBatch = [&] {
+        size_t bytes = batch.size() * sizeof(ChangeRecord);
+        off_t offset = static_cast<off_t>(sizeof(ChangeLogHeader) + batchSlot * sizeof(ChangeRecord));
+        if (pwrite(fd, batch.data(), bytes, offset) == static_cast<ssize_t>(bytes)) {
+            written += static_cast<long long>(batch.size());
+            unsynced = true;
+        } else if (writeErrors++ == 0) {
+            cerr << "❌ Writing the change log failed: " << strerror(errno) << endl;
+        }
+        batch.clear();
+    };
+    while (true) {
+        bool stop = stopping.load(memory_order_acquire); // Read first: whatever was pushed before it is drained
+        ChangeRecord record;
+        uint64_t slot;
+        while (batch.size() < 1024 && pop(record, slot)) {
+            if (!batch.empty() && slot != batchSlot + batch.size()) writeBatch();
+            if (batch.empty()) batchSlot = slot;
+            batch.push_back(record);
+        }
+        if (!batch.empty()) {
+            writeBatch();
+        } else if (stop) {
+            break;
+        } else {
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+        if (unsynced && chrono::steady_clock::now() - lastSync >= chrono::seconds(1)) {
+            fsync(fd);
+            unsynced = false;
+            lastSync = chrono::steady_clock::now();
+        }
+    }
+    if (unsynced) fsync(fd);
+}
+
+void ChangeLog::printStats(ostream& out) {
+    if (fd < 0) {
+        out << "Change log: not capturing" << endl;
+        return;
+    }
+    out << "Change log " << path << ": " << captured << " changes in " << commits << " commits captured, " << voided
+        << " voided by failed commits, " << written << " written, " << ringWaits << " waits on a full ring, "
+        << writeErrors << " write errors" << endl;
+}
+
+// Prints the records of a change log after byte offset `from` as CSV, and with follow keeps polling for
+// new ones until Ctrl+C. The offset to resume from goes to stderr at the end. It stops at a record not yet
+// written, however many come after it, so output stays in sequence order; one left unwritten for
+// CHANGE_SLOT_WAIT_SECONDS belonged to a program that stopped before writing it and is skipped
+int tailChanges(const char* path, long long from, bool follow) {
+    static const char* tables[] = {"?", "client", "pet", "general_ledger", "boarding_reservation"};
+    static const char* operations[] = {"?", "insert", "update", "delete", "resync"};
+    int fd = open(path, O_RDONLY);
+    ChangeLogHeader header;
+    if (fd < 0 || read(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)) ||
+        memcmp(header.magic, CHANGE_LOG_MAGIC, sizeof(header.magic)) != 0) {
+        cerr << "❌ " << path << " is not a change log" << (fd < 0 ? string(": ") + strerror(errno) : "") << endl;
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    long long offset = max<long long>(from, sizeof(ChangeLogHeader));
+    if ((offset - sizeof(ChangeLogHeader)) % sizeof(ChangeRecord) != 0) {
+        cerr << "❌ Offset " << from << " is not at a record boundary" << endl;
+        close(fd);
+        return 1;
+    }
+    if (follow) {
+        signal(SIGINT, requestServerStop);
+        signal(SIGTERM, requestServerStop);
+    }
+    ChangeRecord records[512];
+    char line[128];
+    long long gapOffset = -1; // Unwritten record being waited on, and since when
+    auto gapSince = chrono::steady_clock::now();
+    bool gap;
+    do {
+        ssize_t got;
+        gap = false;
+        // Only whole records: one still being written is read on the next poll
+        while (!gap && (got = pread(fd, records, sizeof(records), offset)) >= static_cast<ssize_t>(sizeof(ChangeRecord))) {
+            size_t count = static_cast<size_t>(got) / sizeof(ChangeRecord);
+            for (size_t i = 0; i < count; i++) {
+                const ChangeRecord& record = records[i];
+                if (record.sequence == 0) {
+                    gap = true;
+                    break;
+                }
+                if (record.operation != CHANGE_VOID) {
+                    snprintf(line, sizeof(line), "%llu,%s,%s,%lld,%u\n", static_cast<unsigned long long>(record.sequence),
+                             record.operation == CHANGE_RESYNC ? "all" : tables[record.table <= CHANGE_BOARDING ? record.table : 0],
+                             operations[record.operation <= CHANGE_RESYNC ? record.operation : 0],
+                             static_cast<long long>(record.rowid), record.commitTime);
+                    cout << line;
+                }
+                offset += static_cast<long long>(sizeof(ChangeRecord));
+            }
+        }
+        if (gap && offset != gapOffset) {
+            gapOffset = offset;
+            gapSince = chrono::steady_clock::now();
+        } else if (gap && chrono::steady_clock::now() - gapSince >= chrono::seconds(CHANGE_SLOT_WAIT_SECONDS)) {
+            cerr << "⚠️  Skipping the record at offset " << offset << ", never written (its program stopped first)" << endl;
+            offset += static_cast<long long>(sizeof(ChangeRecord));
+        }
+        cout << flush;
+        if ((follow || gap) && !serverStopRequested) this_thread::sleep_for(chrono::milliseconds(gap ? 20 : 200));
+    } while ((follow || gap) && !serverStopRequested);
+    close(fd);
+    cerr << "Next offset: " << offset << endl;
+    return 0;
+}
+
+// Flushing a rename in path's directory to disk
+static bool syncDirectoryOf(const string& path) {
+    size_t slash = path.find_last_of('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY);
+    bool ok = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) close(fd);
+    return ok;
+}
+
+// Copying the main database of source into destPath with the online backup API, pagesPerStep pages at a
+// time with a pause between steps. Other connections keep reading and writing; a commit from another
+// connection restarts the copy, so after a few restarts the steps get bigger until it can finish. The copy
+// is written to a temporary file of its own beside destPath (two backups to one place at once, say --backup
+// and the server's background backup, never share it), checked with quick_check, synced, and only then
+// renamed over destPath; the directory is synced too, so the rename survives a power cut
+bool backupDatabase(sqlite3* source, mutex* sourceMutex, const string& destPath, int pagesPerStep, int pauseMs,
+                    BackupStats& stats, string& error, const atomic<bool>* cancel) {
+    stats = BackupStats();
+    string temporary = destPath + ".XXXXXX";
+    int fd = mkstemp(&temporary[0]);
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+    sqlite3* dest;
+    if (sqlite3_open(temporary.c_str(), &dest) != SQLITE_OK) {
+        error = sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        close(fd);
+        remove(temporary.c_str());
+        return false;
+    }
+    // The last step commits the copy; unsynced, so it does not fsync the whole file while holding the source.
+    // It is synced once below, before the rename
+    sqlite3_exec(dest, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;", nullptr, nullptr, nullptr);
+    auto start = chrono::steady_clock::now();
+    sqlite3_backup* backup = sqlite3_backup_init(dest, "main", source, "main");
+    if (!backup) {
+        error = sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        close(fd);
+        remove(temporary.c_str());
+        return false;
+    }
+    int rc = SQLITE_OK, remaining = -1, steps = max(1, pagesPerStep);
+    while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+        if (cancel && *cancel) break;
+        auto stepStart = chrono::steady_clock::now();
+        {
+            unique_lock<mutex> lock;
+            if (sourceMutex) lock = unique_lock<mutex>(*sourceMutex);
+            rc = sqlite3_backup_step(backup, steps);
+        }
+        stats.longestStepMs = max(stats.longestStepMs, chrono::duration<double, milli>(chrono::steady_clock::now() - stepStart).count());
+        stats.steps++;
+        if (remaining >= 0 && sqlite3_backup_remaining(backup) > remaining && ++stats.restarts % 3 == 0) steps *= 2;
+        remaining = sqlite3_backup_remaining(backup);
+        if (rc != SQLITE_DONE) this_thread::sleep_for(chrono::milliseconds(pauseMs));
+    }
+    stats.pages = sqlite3_backup_pagecount(backup);
+    sqlite3_backup_finish(backup);
+    if (rc != SQLITE_DONE) {
+        error = rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED ? "cancelled" : sqlite3_errstr(rc);
+    } else {
+        string check = readPragma(dest, "PRAGMA quick_check;");
+        if (check != "ok") error = "the copy failed quick_check: " + check;
+        stats.bytes = stats.pages * atoll(readPragma(dest, "PRAGMA page_size;").c_str());
+        // A copy of a WAL database is marked WAL too; a plain file is easier to move and open read-only
+        sqlite3_exec(dest, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
+    }
+    clearStatementCache(dest);
+    sqlite3_close(dest);
+    if (error.empty() && (fsync(fd) != 0 || rename(temporary.c_str(), destPath.c_str()) != 0)) error = strerror(errno);
+    close(fd);
+    if (error.empty() && !syncDirectoryOf(destPath)) error = string("syncing the directory failed: ") + strerror(errno);
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!error.empty()) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void printBackupStats(ostream& out, const BackupStats& stats) {
+    char line[160];
+    snprintf(line, sizeof(line), "%.1f MB in %.2fs (%.1f MB/sec), %d steps, longest step %.2f ms, %d restarts",
+             stats.bytes / 1e6, stats.seconds, stats.seconds > 0 ? stats.bytes / 1e6 / stats.seconds : 0.0, stats.steps,
+             stats.longestStepMs, stats.restarts);
+    out << line;
+}
+
+BackgroundBackup::BackgroundBackup(sqlite3* source, mutex& sourceMutex, const string& destPath, chrono::minutes interval, ostream* log) {
+    worker = thread([this, source, &sourceMutex, destPath, interval, log] {
+        unique_lock<mutex> lock(stopMutex);
+        while (!stopRequested.wait_for(lock, interval, [this] { return stopping; })) {
+            lock.unlock();
+            BackupStats stats;
+            string error;
+            bool ok = backupDatabase(source, &sourceMutex, destPath, BACKUP_STEP_PAGES, BACKUP_PAUSE_MS, stats, error, &cancel);
+            {
+                lock_guard<mutex> guard(statsMutex);
+                (ok ? completed : failed)++;
+                if (ok) last = stats;
+                else lastError = error;
+            }
+            if (log && ok) {
+                *log << "✅ Backed up to " << destPath << ": ";
+                printBackupStats(*log, stats);
+                *log << endl;
+            } else if (log && !cancel) {
+                *log << "❌ Backup to " << destPath << " failed: " << error << endl;
+            }
+            lock.lock();
+        }
+    });
+}
+
+BackgroundBackup::~BackgroundBackup() {
+    {
+        lock_guard<mutex> lock(stopMutex);
+        stopping = true;
+    }
+    cancel = true; // A backup in progress stops at its next step
+    stopRequested.notify_all();
+    worker.join();
+}
+
+void BackgroundBackup::printStats(ostream& out) {
+    lock_guard<mutex> guard(statsMutex);
+    out << "Background backup: " << completed << " completed, " << failed << " failed";
+    if (completed > 0) {
+        out << "; last ";
+        printBackupStats(out, last);
+    }
+    if (!lastError.empty()) out << "; last error: " << lastError;
+    out << endl;
+}
+
+// --backup DEST: an online backup of the open database that other terminals can keep working through
+int runBackup(sqlite3* db, const char* destPath, int pagesPerStep, int pauseMs) {
+    BackupStats stats;
+    string error;
+    if (!backupDatabase(db, nullptr, destPath, pagesPerStep, pauseMs, stats, error, nullptr)) {
+        cerr << "❌ Backup failed: " << error << endl;
+        return 1;
+    }
+    cout << "✅ Backed up to " << destPath << ": ";
+    printBackupStats(cout, stats);
+    cout << endl;
+    return 0;
+}
+
+// Row counts of the tables in a database, for comparing a restore with its backup
+static map<string, long long> tableRowCounts(sqlite3* db) {
+    map<string, long long> counts;
+    vector<string> tables;
+    {
+        CachedStatement list(db, "SELECT name FROM sqlite_schema WHERE type = 'table' AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\'"
+                                 " AND sql NOT LIKE 'CREATE VIRTUAL%';");
+        while (list && sqlite3_step(list) == SQLITE_ROW) tables.push_back(reinterpret_cast<const char*>(sqlite3_column_text(list, 0)));
+    }
+    for (const string& table : tables) {
+        sqlite3_stmt* count;
+        string sql = "SELECT COUNT(*) FROM \"" + table + "\";";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &count, nullptr) == SQLITE_OK && sqlite3_step(count) == SQLITE_ROW) {
+            counts[table] = sqlite3_column_int64(count, 0);
+        }
+        sqlite3_finalize(count);
+    }
+    return counts;
+}
+
+// --restore BACKUP: checks the backup (integrity_check, a schema this program knows), saves the current
+// database beside it, copies the backup over it in one step, and checks that the result has the backup's
+// row counts and passes integrity_check. It refuses to run while the server or another terminal has the
+// database open, since they would go on from what they cached of the old one, and locks them out until done
+int restoreBackup(sqlite3* db, const char* backupPath) {
+    auto start = chrono::steady_clock::now();
+    sqlite3* backup;
+    if (sqlite3_open_v2(backupPath, &backup, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        cerr << "❌ Cannot open " << backupPath << ": " << sqlite3_errmsg(backup) << endl;
+        sqlite3_close(backup);
+        return 1;
+    }
+    string check = readPragma(backup, "PRAGMA integrity_check;");
+    int version = atoi(readPragma(backup, "PRAGMA user_version;").c_str());
+    int known = MIGRATIONS[sizeof(MIGRATIONS) / sizeof(MIGRATIONS[0]) - 1].version;
+    map<string, long long> expected = tableRowCounts(backup);
+    string problem = check.empty() ? sqlite3_errmsg(backup) : check != "ok" ? "it failed integrity_check: " + check :
+                     version > known ? "it is from a newer version of the program (schema " + to_string(version) + ")" :
+                     expected.count("client") == 0 ? "it is not a kennel database" : "";
+    if (!problem.empty()) {
+        cerr << "❌ Not restoring " << backupPath << ": " << problem << endl;
+        clearStatementCache(backup);
+        sqlite3_close(backup);
+        return 1;
+    }
+
+    // In exclusive locking mode BEGIN EXCLUSIVE fails while any other connection has the database open, even
+    // idle in WAL mode; with no busy timeout it fails at once. Once it succeeds the lock is kept after COMMIT
+    sqlite3_busy_timeout(db, 0);
+    if (sqlite3_exec(db, "PRAGMA locking_mode = EXCLUSIVE; BEGIN EXCLUSIVE; COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "❌ Not restoring: the database is open in another terminal or the server (" << sqlite3_errmsg(db)
+             << "); stop them first" << endl;
+        sqlite3_exec(db, "ROLLBACK; PRAGMA locking_mode = NORMAL;", nullptr, nullptr, nullptr);
+        clearStatementCache(backup);
+        sqlite3_close(backup);
+        return 1;
+    }
+    // The booking indexes reload when these counters change, so they must not go back to the backup's values
+    vector<pair<string, sqlite3_int64>> bookingCounts;
+    {
+        Query<tuple<>, tuple<string_view, sqlite3_int64>> counts(db, "SELECT table_name, changes FROM booking_changes;");
+        if (counts) counts.run([&](string_view table, sqlite3_int64 changes) { bookingCounts.emplace_back(string(table), changes); });
+    }
+
+    string safety = string(sqlite3_db_filename(db, "main")) + "-before-restore";
+    BackupStats stats;
+    string error;
+    int status = 1;
+    if (!backupDatabase(db, nullptr, safety, BACKUP_STEP_PAGES, 0, stats, error, nullptr)) {
+        cerr << "❌ Not restoring: saving the current database to " << safety << " failed: " << error << endl;
+    } else {
+        clearStatementCache(db);
+        sqlite3_backup* copy = sqlite3_backup_init(db, "main", backup, "main");
+        int rc = copy ? sqlite3_backup_step(copy, -1) : SQLITE_ERROR;
+        if (copy) sqlite3_backup_finish(copy);
+        if (rc != SQLITE_DONE) {
+            cerr << "❌ Restore failed: " << sqlite3_errmsg(db) << " (the database is unchanged)" << endl;
+        } else {
+            check = readPragma(db, "PRAGMA integrity_check;");
+            map<string, long long> restored = tableRowCounts(db);
+            if (check != "ok" || restored != expected) {
+                cerr << "❌ Restored database does not match the backup (" << check << "); the previous one is in " << safety << endl;
+            } else if (runMigrations(db)) { // An older backup is brought up to this program's schema
+                Query<tuple<sqlite3_int64, string_view>, tuple<>> bump(db, "UPDATE booking_changes SET changes = MAX(changes, ?1) + 1 WHERE table_name = ?2;");
+                for (const auto& count : bookingCounts) {
+                    if (bump) bump.exec(count.second, count.first);
+                }
+                ChangeLog(string(sqlite3_db_filename(db, "main")) + CHANGE_LOG_SUFFIX).resync();
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                long long rows = 0;
+                for (const auto& table : restored) rows += table.second;
+                cout << "✅ Restored " << backupPath << " (" << restored.size() << " tables, " << rows << " rows, verified) in "
+                     << seconds << "s; the previous database is in " << safety << endl;
+                status = 0;
+            }
+        }
+    }
+    clearStatementCache(backup);
+    sqlite3_close(backup);
+    return status;
+}
+
+// --bench-backup FILE: sales keep going through a GroupCommitWriter while FILE is backed up from the same
+// connection, and their latency is compared with a run without the backup. FILE is changed (sales are added)
+int benchmarkBackup(const char* dbPath, int pagesPerStep) {
+    sqlite3* db;
+    if (sqlite3_open_v2(dbPath, &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        cerr << "Failed to open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    applyTuningProfile(db);
+    if (!runMigrations(db) || sqlite3_exec(db, "PRAGMA journal_mode = WAL; PRAGMA wal_autocheckpoint = 0;"
+                                               " UPDATE retail_item SET stock_level = 1000000000;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return 1;
+    }
+    WalCheckpointer checkpointer(dbPath); // As in the server, so commits never checkpoint
+    mutex dbMutex;
+    string destPath = string(dbPath) + BACKUP_SUFFIX;
+    BackupStats stats;
+    string error;
+    bool ok = true;
+    printf("%-16s | %9s | %8s | %8s | %8s\n", "Pass", "Sales/sec", "p50 ms", "p99 ms", "max ms");
+    for (bool withBackup : {false, true}) {
+        vector<double> micros;
+        atomic<bool> done(false);
+        auto started = chrono::steady_clock::now();
+        {
+            GroupCommitWriter writes(db, dbMutex, DURABILITY_NORMAL);
+            thread terminal([&] {
+                Sale sale{1, 1, 20250101, 1200, "Card", {{1, 1}}};
+                while (!done) {
+                    auto start = chrono::steady_clock::now();
+                    writes.run([&sale](sqlite3* db) {
+                        float total = 0;
+                        string error;
+                        return processSale(db, sale, total, error);
+                    });
+                    micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+                }
+            });
+            if (withBackup) ok = backupDatabase(db, &dbMutex, destPath, pagesPerStep, BACKUP_PAUSE_MS, stats, error, nullptr);
+            else this_thread::sleep_for(chrono::seconds(2));
+            done = true;
+            terminal.join();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        sort(micros.begin(), micros.end());
+        auto percentile = [&](double p) {
+            return micros.empty() ? 0.0 : micros[min(micros.size() - 1, static_cast<size_t>(p * micros.size()))] / 1000.0;
+        };
+        printf("%-16s | %9.0f | %8.3f | %8.3f | %8.3f\n", withBackup ? "during backup" : "no backup", micros.size() / seconds,
+               percentile(0.50), percentile(0.99), micros.empty() ? 0.0 : micros.back() / 1000.0);
+    }
+    if (ok) {
+        cout << "✅ Backed up to " << destPath << ": ";
+        printBackupStats(cout, stats);
+        cout << endl;
+    } else {
+        cerr << "❌ Backup failed: " << error << endl;
+    }
+    clearStatementCache(db);
+    sqlite3_close(db);
+    return ok ? 0 : 1;
+}
+
+const char* durabilityName(Durability durability) {
+    switch (durability) {
+        case DURABILITY_NORMAL: return "normal";
+        case DURABILITY_BATCHED: return "batched";
+        default: return "full";
+    }
+}
+
+bool parseDurability(const string& name, Durability& durability) {
+    for (Durability candidate : {DURABILITY_FULL, DURABILITY_NORMAL, DURABILITY_BATCHED}) {
+        if (name == durabilityName(candidate)) {
+            durability = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+GroupCommitWriter::GroupCommitWriter(sqlite3* db, mutex& dbMutex, Durability durability)
+    : db(db), dbMutex(dbMutex), mode(durability) {
+    // A batched group still fsyncs on commit, it just does it once for many writes
+    sqlite3_exec(db, mode == DURABILITY_NORMAL ? "PRAGMA synchronous = NORMAL;" : "PRAGMA synchronous = FULL;",
+                 nullptr, nullptr, nullptr);
+    clientProfiles.watchWriter(db, &dbMutex);
+    if (mode == DURABILITY_BATCHED) worker = thread([this] { commitLoop(); });
+}
+
+GroupCommitWriter::~GroupCommitWriter() {
+    shutdown();
+    clientProfiles.watchWriter(nullptr, nullptr);
+}
+
+bool GroupCommitWriter::run(WriteOperation apply) {
+    if (mode != DURABILITY_BATCHED) {
+        lock_guard<mutex> lock(dbMutex);
+        bool ok = apply(db);
+        clientProfiles.settle(); // The write was its own transaction, so it is committed
+        return ok;
+    }
+    mutex doneMutex;
+    condition_variable doneReady;
+    bool finished = false, committed = false;
+    post(move(apply), [&](bool ok) {
+        lock_guard<mutex> lock(doneMutex);
+        committed = ok;
+        finished = true;
+        doneReady.notify_one();
+    });
+    unique_lock<mutex> lock(doneMutex);
+    doneReady.wait(lock, [&] { return finished; });
+    return committed;
+}
+
+void GroupCommitWriter::post(WriteOperation apply, function<void(bool)> done) {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (mode == DURABILITY_BATCHED && !stopping) {
+            queue.push_back({move(apply), move(done)});
+            queueReady.notify_one();
+            return;
+        }
+    }
+    bool ok;
+    {
+        lock_guard<mutex> lock(dbMutex);
+        ok = apply(db);
+        clientProfiles.settle();
+    }
+    if (done) done(ok);
+}
+
+void GroupCommitWriter::flush() {
+    unique_lock<mutex> lock(queueMutex);
+    queueDrained.wait(lock, [this] { return queue.empty() && inFlight == 0; });
+}
+
+void GroupCommitWriter::shutdown() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    if (worker.joinable()) worker.join(); // The loop only exits once the queue is empty
+}
+
+// Taking writes off the queue as a group: writes are collected while they keep arriving, for up to
+// GROUP_COMMIT_MS after the first one and GROUP_COMMIT_WRITES in all, then one BEGIN ... COMMIT
+// covers all of them. Writes arriving during that commit make up the next group
+void GroupCommitWriter::commitLoop() {
+    vector<QueuedWrite> group;
+    vector<char> applied;
+    while (true) {
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) break; // Stopping with nothing left to commit
+            auto deadline = chrono::steady_clock::now() + chrono::milliseconds(GROUP_COMMIT_MS);
+            while (!stopping && queue.size() < GROUP_COMMIT_WRITES && chrono::steady_clock::now() < deadline) {
+                size_t waiting = queue.size();
+                auto idleUntil = min(deadline, chrono::steady_clock::now() + chrono::microseconds(GROUP_COMMIT_IDLE_US));
+                if (!queueReady.wait_until(lock, idleUntil, [&] { return stopping || queue.size() > waiting; })) break;
+            }
+            size_t take = min(queue.size(), GROUP_COMMIT_WRITES);
+            for (size_t i = 0; i < take; i++) {
+                group.push_back(move(queue.front()));
+                queue.pop_front();
+            }
+            inFlight = group.size();
+        }
+
+        applied.assign(group.size(), 0);
+        bool committed;
+        {
+            lock_guard<mutex> lock(dbMutex);
+            committed = runCachedStatement(db, "BEGIN IMMEDIATE;");
+            if (!committed) cerr << "❌ Group commit could not start: " << sqlite3_errmsg(db) << endl;
+            else clientProfiles.checkWriterVersion(db); // Lookups skip the check while the group holds the writer
+            for (size_t i = 0; committed && i < group.size(); i++) {
+                size_t indexUpdates = pendingIndexUpdates(db), changes = ChangeLog::pendingChanges(db);
+                runCachedStatement(db, "SAVEPOINT group_write;");
+                applied[i] = group[i].apply(db);
+                if (!applied[i]) {
+                    sqlite3_exec(db, "ROLLBACK TO group_write;", nullptr, nullptr, nullptr);
+                    finishIndexUpdates(db, indexUpdates, false);
+                    ChangeLog::discardChanges(db, changes);
+                }
+                runCachedStatement(db, "RELEASE group_write;");
+            }
+            if (committed && !runCachedStatement(db, "COMMIT;")) {
+                cerr << "❌ Group commit failed: " << sqlite3_errmsg(db) << endl;
+                sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                committed = false;
+            }
+            finishIndexUpdates(db, 0, committed); // Booking indexes change only with what actually committed
+            clientProfiles.settle();
+        }
+        for (size_t i = 0; i < group.size(); i++) {
+            if (group[i].done) group[i].done(committed && applied[i]);
+        }
+        group.clear();
+
+        lock_guard<mutex> lock(queueMutex);
+        inFlight = 0;
+        if (queue.empty()) queueDrained.notify_all();
+    }
+    lock_guard<mutex> lock(queueMutex);
+    queueDrained.notify_all();
+}
+
+// Dropping the calling thread to background priority
+static void lowerThreadPriority() {
+#if defined(__linux__)
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19); // Linux applies nice per thread
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#endif
+}
+
+// Starting an export on a new read-only connection and thread. The whole export runs in one
+// read transaction, so it sees a single consistent snapshot however long it takes
+static bool startBackgroundReport(BackgroundReport& job, const string& report, const string& format, const string& path, int clientId) {
+    if (job.worker.joinable()) job.worker.join(); // The previous job has finished, collect its thread
+    sqlite3* reader;
+    if (sqlite3_open_v2("kennel_project.db", &reader, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        cerr << "❌ Failed to open report connection: " << sqlite3_errmsg(reader) << endl;
+        sqlite3_close(reader);
+        return false;
+    }
+    sqlite3_busy_timeout(reader, 5000);
+    applyTuningProfile(reader, findTuningProfile("reporting")); // A whole-report read, whatever the menu uses
+    enableProfiling(reader);
+    job.reader = reader;
+    job.rows = 0;
+    job.log.str("");
+    job.description = report + " as " + format + " to " + path;
+    job.started = chrono::steady_clock::now();
+    job.announced = false;
+    job.running = true;
+    job.worker = thread([&job, report, format, path, clientId] {
+        lowerThreadPriority(); // Sales at the desk (and other terminals) get the CPU first
+        if (report == "boarding") attachArchives(job.reader); // ATTACH is not allowed once the snapshot is open
+        sqlite3_exec(job.reader, "BEGIN;", nullptr, nullptr, nullptr);
+        exportReport(job.reader, report, format, path.c_str(), clientId, job.log, &job.rows);
+        sqlite3_exec(job.reader, "COMMIT;", nullptr, nullptr, nullptr);
+        {
+            lock_guard<mutex> lock(job.readerMutex);
+            clearStatementCache(job.reader);
+            sqlite3_close(job.reader);
+            job.reader = nullptr;
+        }
+        job.running = false;
+    });
+    return true;
+}
+
+// Stopping the running export at its next row via sqlite3_interrupt and waiting for its thread.
+// Repeated until the job ends, because an interrupt is a no-op while no statement is running yet
+void cancelBackgroundReport(BackgroundReport& job) {
+    while (job.running) {
+        {
+            lock_guard<mutex> lock(job.readerMutex);
+            if (job.reader) sqlite3_interrupt(job.reader);
+        }
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    if (job.worker.joinable()) job.worker.join();
+}
+
+// Showing the result of a finished export once, before the menu is printed again
+void announceBackgroundReport(BackgroundReport& job) {
+    if (job.running || job.announced) return;
+    job.announced = true;
+    cout << "\nBackground report (" << job.description << ") finished:\n" << job.log.str() << flush;
+}
+
+// Submenu for the background export: start one, show its progress, or cancel it
+void backgroundReportMenu(BackgroundReport& job) {
+    cout << "\nBackground Report Menu:\n1. Start Export\n2. Show Progress\n3. Cancel Export" << endl;
+    int sub = promptForInt("Enter choice: ");
+    if (sub == 1) {
+        if (job.running) {
+            cout << "An export is already running; cancel it or wait for it to finish." << endl;
+            return;
+        }
+        cout << "Report (boarding or grooming): ";
+        string report;
+        getline(cin, report);
+        cout << "Format (csv or json): ";
+        string format;
+        getline(cin, format);
+        cout << "Output file: ";
+        string path;
+        getline(cin, path);
+        int clientId = report == "boarding" ? promptForInt("Client ID (0 for all clients): ") : 0;
+        if ((report != "boarding" && report != "grooming") || (format != "csv" && format != "json") || path.empty() || path == "-") {
+            cout << "Invalid report, format or file name." << endl;
+            return;
+        }
+        if (startBackgroundReport(job, report, format, path, clientId)) {
+            cout << "✅ Export started in the background; choose 11 again to check on it." << endl;
+        }
+    } else if (sub == 2) {
+        if (!job.running) {
+            cout << (job.announced ? "No export is running." : "The export has finished.") << endl;
+            return;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - job.started).count();
+        long long rows = job.rows;
+        cout << "Exporting " << job.description << ": " << rows << " rows in " << seconds << "s";
+        if (seconds > 0) cout << " (" << static_cast<long long>(rows / seconds) << " rows/sec)";
+        cout << endl;
+    } else if (sub == 3) {
+        if (!job.running) {
+            cout << "No export is running." << endl;
+            return;
+        }
+        cancelBackgroundReport(job);
+        announceBackgroundReport(job);
+    } else {
+        cout << "Invalid option." << endl;
+    }
+}
+
+// Full report joins for --export, in index order so rows stream without a sort step
+// (boarding_history sorts once archive years are attached)
+const char* BOARDING_EXPORT_SQL = R"(
+    SELECT b.reservation_id, b.client_id, c.client_name, b.pet_id, p.pet_name, b.check_in, b.check_out, b.amount
+    FROM boarding_history b LEFT JOIN pet p ON b.pet_id = p.pet_id LEFT JOIN client c ON c.client_id = b.client_id
+    ORDER BY b.client_id, b.check_in, b.reservation_id;
+)";
+const char* CLIENT_BOARDING_EXPORT_SQL = R"(
+    SELECT b.reservation_id, b.client_id, c.client_name, b.pet_id, p.pet_name, b.check_in, b.check_out, b.amount
+    FROM boarding_history b LEFT JOIN pet p ON b.pet_id = p.pet_id LEFT JOIN client c ON c.client_id = b.client_id
+    WHERE b.client_id = ?1
+    ORDER BY b.check_in, b.reservation_id;
+)";
+const char* GROOMING_EXPORT_SQL = R"(
+    SELECT g.appointment_id, g.grooming_date, g.grooming_time, g.client_id, c.client_name, g.groomer_id, gr.groomer_name
+    FROM grooming_appointment g LEFT JOIN client c ON g.client_id = c.client_id LEFT JOIN groomer gr ON g.groomer_id = gr.groomer_id
+    ORDER BY g.grooming_date DESC, g.grooming_time, g.appointment_id;
+)";
+
+// Streaming a report as CSV (with a header line) or JSON Lines to path ("-" for stdout).
+// Column values are read in place with sqlite3_column_text/bytes; NULLs become empty fields or null
+int exportReport(sqlite3* db, const string& report, const string& format, const char* path, int clientId,
+                 ostream& log, atomic<long long>* rowsDone) {
+    const char* sql = report == "grooming" ? GROOMING_EXPORT_SQL
+                    : report != "boarding" ? nullptr
+                    : clientId > 0 ? CLIENT_BOARDING_EXPORT_SQL : BOARDING_EXPORT_SQL;
+    if (!sql || (format != "csv" && format != "json")) {
+        log << "❌ Usage: --export boarding|grooming [csv|json] [FILE|-] [CLIENT_ID]" << endl;
+        return 1;
+    }
+    if (report == "boarding" && !attachArchives(db)) {
+        log << "❌ Could not attach the history archives: " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+    CachedStatement stmt(db, sql);
+    if (!stmt) {
+        log << "Prepare failed: " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+    if (clientId > 0) sqlite3_bind_int(stmt, 1, clientId);
+    bool toStdout = string(path) == "-";
+    FILE* file = toStdout ? stdout : fopen(path, "wb");
+    if (!file) {
+        log << "❌ Could not open " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    struct stat fileInfo;
+    bool regularFile = !toStdout && fstat(fileno(file), &fileInfo) == 0 && S_ISREG(fileInfo.st_mode); // Not a pipe or /dev/null
+
+    auto start = chrono::steady_clock::now();
+    long long rows = 0;
+    int rc;
+    {
+        ExportWriter out(file);
+        bool json = format == "json";
+        int columns = sqlite3_column_count(stmt);
+        vector<string> keys; // JSON keys ("name":) or the CSV header, built once
+        for (int i = 0; i < columns; i++) {
+            const char* name = sqlite3_column_name(stmt, i);
+            if (json) {
+                keys.push_back(string(i ? "," : "{") + "\"" + name + "\":");
+            } else {
+                out.append(i ? "," : "", i ? 1 : 0);
+                out.append(name, strlen(name));
+            }
+        }
+        if (!json) out.append('\n');
+
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            for (int i = 0; i < columns; i++) {
+                if (json) out.append(keys[i].data(), keys[i].size());
+                else if (i) out.append(',');
+                switch (sqlite3_column_type(stmt, i)) {
+                    case SQLITE_NULL:
+                        if (json) out.append("null", 4);
+                        break;
+                    case SQLITE_INTEGER:
+                        out.appendInt(sqlite3_column_int64(stmt, i));
+                        break;
+                    case SQLITE_FLOAT: { // SQLite's own shortest round-trip text for the value
+                        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+                        out.append(text, sqlite3_column_bytes(stmt, i));
+                        break;
+                    }
+                    default: {
+                        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+                        size_t size = sqlite3_column_bytes(stmt, i);
+                        if (json) out.appendJsonString(text, size);
+                        else out.appendCsvField(text, size);
+                    }
+                }
+            }
+            if (json) out.append("}\n", 2);
+            else out.append('\n');
+            rows++;
+            if (rowsDone) rowsDone->store(rows, memory_order_relaxed);
+        }
+        out.flush();
+        if (out.failed()) {
+            log << "❌ Writing " << path << " failed: " << strerror(errno) << endl;
+            rc = SQLITE_IOERR;
+        }
+    }
+    if (!toStdout && fclose(file) != 0) rc = SQLITE_IOERR;
+    if (toStdout) fflush(stdout);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (rc != SQLITE_DONE) {
+        if (rc == SQLITE_INTERRUPT) log << "❌ Export cancelled after " << rows << " rows" << endl;
+        else if (rc != SQLITE_IOERR) log << "❌ Export failed: " << sqlite3_errmsg(db) << endl;
+        if (regularFile) remove(path); // No half-written files left behind
+        return 1;
+    }
+    // Status goes to the log (stderr by default) so an export to stdout stays clean
+    log << "✅ Exported " << rows << " rows in " << seconds << "s";
+    if (seconds > 0) log << " — " << static_cast<long long>(rows / seconds) << " rows/sec";
+    log << endl;
+    return 0;
+}
+
+LocationStream::LocationStream(const string& path, const string& report) : dbPath(path) {
+    worker = thread([this, report] { read(report); });
+}
+
+LocationStream::~LocationStream() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void LocationStream::read(const string& report) {
+    string error;
+    bool readsLedger = false;
+    sqlite3* db;
+    if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+    } else {
+        sqlite3_busy_timeout(db, 5000);
+        applyTuningProfile(db);
+        vector<LocationRow> batch;
+        batch.reserve(LOCATION_BATCH_ROWS);
+        auto handOver = [&] { // False once the merge has stopped
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&] { return stopping || batches.size() < LOCATION_QUEUE_BATCHES; });
+            if (stopping) return false;
+            if (!batch.empty()) batches.push_back(move(batch));
+            batch.clear();
+            batch.reserve(LOCATION_BATCH_ROWS);
+            changed.notify_all();
+            return true;
+        };
+        auto add = [&](LocationRow&& row) {
+            batch.push_back(move(row));
+            rowsRead.fetch_add(1, memory_order_relaxed);
+            return batch.size() < LOCATION_BATCH_ROWS || handOver();
+        };
+        auto name = [](optional<string_view> text) { return text ? optional<string>(string(*text)) : nullopt; };
+        bool ok;
+        if (report == "grooming") {
+            Query<tuple<>, tuple<int, int, int, int, optional<string_view>, int, optional<string_view>>> stmt(db, GROOMING_EXPORT_SQL);
+            ok = stmt && stmt.run([&](int appointmentId, int date, int time, int clientId, optional<string_view> client, int groomerId,
+                                      optional<string_view> groomer) {
+                return add({date, time, appointmentId, clientId, groomerId, name(client), name(groomer), 0});
+            });
+        } else { // From the rollup, so each location reads one row per day however many sales it has
+            // A location this program has not opened since before the rollup (migration 4) is read read-only here,
+            // so nothing migrates it: its months are totalled from the ledger the way migration 4 fills the rollup
+            bool rollup = false;
+            {
+                Query<tuple<>, tuple<int>> exists(db, "SELECT 1 FROM sqlite_schema WHERE type = 'table' AND name = 'daily_revenue';");
+                ok = exists && exists.run([&](int) { rollup = true; });
+            }
+            readsLedger = ok && !rollup;
+            Query<tuple<>, tuple<int, sqlite3_int64, double>> stmt(db, rollup ? R"(
+                SELECT ledger_date / 100, SUM(sale_count), TOTAL(revenue) FROM daily_revenue
+                WHERE ledger_date IS NOT NULL GROUP BY ledger_date / 100 ORDER BY 1;
+            )" : R"(
+                SELECT ledger_date / 100, COUNT(*), TOTAL(amount) FROM general_ledger
+                WHERE ledger_date IS NOT NULL GROUP BY ledger_date / 100 ORDER BY 1;
+            )");
+            ok = ok && stmt && stmt.run([&](int month, sqlite3_int64 sales, double revenue) {
+                return add({month, 0, sales, 0, 0, nullopt, nullopt, revenue});
+            });
+        }
+        if (!ok) error = sqlite3_errmsg(db);
+        else handOver(); // The last, partly filled batch
+        clearStatementCache(db);
+    }
+    sqlite3_close(db);
+    timespec cpu{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    lock_guard<mutex> guard(lock);
+    failure = error;
+    busySeconds = cpu.tv_sec + cpu.tv_nsec / 1e9;
+    ledger = readsLedger;
+    done = true;
+    changed.notify_all();
+}
+
+bool LocationStream::next(LocationRow& row) {
+    if (position == current.size()) {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&] { return !batches.empty() || done; });
+        if (batches.empty()) return false;
+        current = move(batches.front());
+        batches.pop_front();
+        position = 0;
+        changed.notify_all();
+    }
+    row = move(current[position++]);
+    return true;
+}
+
+string LocationStream::error() {
+    lock_guard<mutex> guard(lock);
+    return failure;
+}
+
+double LocationStream::readSeconds() {
+    lock_guard<mutex> guard(lock);
+    return busySeconds;
+}
+
+bool LocationStream::readLedger() {
+    lock_guard<mutex> guard(lock);
+    return ledger;
+}
+
+// A report over several locations' databases, each read by its own LocationStream, merged as the rows
+// arrive and streamed to outPath ("-" for stdout) like --export. grooming is every appointment, newest
+// date first and then by time, with the location it came from; revenue is monthly sales and revenue
+// summed over the locations. Every location is read at once, so it takes about as long as the largest
+int locationReport(const string& report, const vector<string>& paths, const string& format, const char* outPath) {
+    if ((report != "grooming" && report != "revenue") || (format != "csv" && format != "json") || paths.empty()) {
+        cerr << "❌ Usage: --locations grooming|revenue FILE[,FILE...] [csv|json] [OUT|-]" << endl;
+        return 1;
+    }
+    bool toStdout = string(outPath) == "-";
+    FILE* file = toStdout ? stdout : fopen(outPath, "wb");
+    if (!file) {
+        cerr << "❌ Could not open " << outPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    struct stat fileInfo;
+    bool regularFile = !toStdout && fstat(fileno(file), &fileInfo) == 0 && S_ISREG(fileInfo.st_mode);
+
+    auto start = chrono::steady_clock::now();
+    vector<unique_ptr<LocationStream>> streams;
+    for (const string& path : paths) streams.push_back(make_unique<LocationStream>(path, report));
+
+    // Heads of the streams in a heap, the row that goes out next on top; ties keep the location order
+    bool grooming = report == "grooming";
+    vector<LocationRow> heads(streams.size());
+    auto after = [&](size_t a, size_t b) {
+        const LocationRow& x = heads[a];
+        const LocationRow& y = heads[b];
+        if (x.date != y.date) return grooming ? x.date < y.date : x.date > y.date;
+        if (x.time != y.time) return x.time > y.time;
+        return a > b;
+    };
+    priority_queue<size_t, vector<size_t>, decltype(after)> order(after);
+    string failed;
+    auto advance = [&](size_t i) {
+        if (streams[i]->next(heads[i])) order.push(i);
+        else if (failed.empty() && !streams[i]->error().empty()) failed = paths[i] + ": " + streams[i]->error();
+    };
+    for (size_t i = 0; i < streams.size(); i++) advance(i);
+
+    long long rows = 0;
+    bool writeFailed;
+    {
+        ExportWriter out(file);
+        bool json = format == "json";
+        vector<const char*> names = grooming ? vector<const char*>{"location", "appointment_id", "grooming_date", "grooming_time", "client_id",
+                                                                   "client_name", "groomer_id", "groomer_name"}
+                                             : vector<const char*>{"month", "sale_count", "revenue", "locations"};
+        vector<string> keys;
+        for (size_t i = 0; i < names.size(); i++) {
+            if (json) {
+                keys.push_back(string(i ? "," : "{") + "\"" + names[i] + "\":");
+            } else {
+                out.append(i ? "," : "", i ? 1 : 0);
+                out.append(names[i], strlen(names[i]));
+            }
+        }
+        if (!json) out.append('\n');
+        size_t field = 0;
+        auto key = [&] {
+            if (json) out.append(keys[field].data(), keys[field].size());
+            else if (field) out.append(',');
+            field++;
+        };
+        auto text = [&](const optional<string>& value) {
+            key();
+            if (!value) {
+                if (json) out.append("null", 4);
+            } else if (json) {
+                out.appendJsonString(value->data(), value->size());
+            } else {
+                out.appendCsvField(value->data(), value->size());
+            }
+        };
+        auto number = [&](sqlite3_int64 value) {
+            key();
+            out.appendInt(value);
+        };
+
+        while (!order.empty() && failed.empty() && !out.failed()) {
+            size_t i = order.top();
+            order.pop();
+            field = 0;
+            if (grooming) {
+                text(paths[i]);
+                number(heads[i].id);
+                number(heads[i].date);
+                number(heads[i].time);
+                number(heads[i].clientId);
+                text(heads[i].client);
+                number(heads[i].groomerId);
+                text(heads[i].groomer);
+                advance(i);
+            } else { // Every location's row for the month is at the top of the heap together
+                int month = heads[i].date;
+                sqlite3_int64 sales = heads[i].id;
+                double revenue = heads[i].revenue;
+                int locations = 1;
+                advance(i);
+                while (!order.empty() && heads[order.top()].date == month) {
+                    size_t j = order.top();
+                    order.pop();
+                    sales += heads[j].id;
+                    revenue += heads[j].revenue;
+                    locations++;
+                    advance(j);
+                }
+                char amount[32];
+                number(month);
+                number(sales);
+                key();
+                out.append(amount, snprintf(amount, sizeof(amount), "%.2f", revenue));
+                number(locations);
+            }
+            out.append(json ? "}\n" : "\n", json ? 2 : 1);
+            rows++;
+        }
+        out.flush();
+        writeFailed = out.failed();
+    }
+    if (!toStdout && fclose(file) != 0) writeFailed = true;
+    if (toStdout) fflush(stdout);
+    if (writeFailed && failed.empty()) failed = string("writing ") + outPath + " failed: " + strerror(errno);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Status goes to stderr so a report to stdout stays clean
+    double slowest = 0, total = 0;
+    for (size_t i = 0; i < streams.size(); i++) {
+        if (!failed.empty()) break;
+        double read = streams[i]->readSeconds();
+        slowest = max(slowest, read);
+        total += read;
+        cerr << "   " << paths[i] << ": " << streams[i]->rows() << " rows, " << read << "s of reading"
+             << (streams[i]->readLedger() ? " (no daily_revenue rollup yet, totalled from general_ledger)" : "") << endl;
+    }
+    streams.clear(); // Stops any reader still going after a failure
+    if (!failed.empty()) {
+        cerr << "❌ Location report failed: " << failed << endl;
+        if (regularFile) remove(outPath); // No half-written files left behind
+        return 1;
+    }
+    cerr << "✅ Merged " << rows << " rows from " << paths.size() << " locations in " << seconds << "s (largest location "
+         << slowest << "s, all locations " << total << "s of reading)" << endl;
+    return 0;
+}
+
+// Turning what the user typed into an FTS5 query: every word must match, quoted so punctuation is literal.
+// Words shorter than minLength are dropped (the trigram tokenizer needs at least 3 characters)
+string ftsQuery(const string& text, bool prefix, size_t minLength) {
+    stringstream words(text);
+    string word, query;
+    while (words >> word) {
+        if (word.size() < minLength) continue;
+        string quoted = "\"";
+        for (char c : word) quoted += (c == '"') ? string("\"\"") : string(1, c);
+        quoted += prefix ? "\"*" : "\"";
+        query += (query.empty() ? "" : " ") + quoted;
+    }
+    return query;
+}
+
+// Prompting for search text and showing the matches
+void searchRecords(sqlite3* db) {
+    string text;
+    cout << "\n=== Search ===" << endl;
+    cout << "Enter name, phone, email, address, breed or condition: ";
+    getline(cin, text);
+
+    auto start = chrono::steady_clock::now();
+    int matches = writeSearchResults(db, text, cout);
+    if (matches < 0) {
+        if (ftsQuery(text, true, 1).empty()) cout << "Nothing to search for." << endl;
+        else cerr << "Query error: " << sqlite3_errmsg(db) << endl;
+        return;
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "\n" << matches << " matches in " << ms << " ms" << endl;
+}
+
+// Ranked search over clients, pets and medical records through the FTS5 indexes.
+// Returns the number of matches written, or -1 if there was nothing to search for or a query failed
+int writeSearchResults(sqlite3* db, const string& text, ostream& out) {
+    OperationTimer timer("search");
+    string clientQuery = ftsQuery(text, false, 3); // Trigram index, so any 3+ character piece matches
+    string wordQuery = ftsQuery(text, true, 1);    // Word indexes, each word matches as a prefix
+    if (wordQuery.empty()) return -1;
+    int matches = 0;
+
+    // Clients by name, phone, email or address
+    const char* clientSQL = R"(
+        SELECT c.client_id, c.client_name, c.phone, c.email
+        FROM client_fts JOIN client c ON c.client_id = client_fts.rowid
+        WHERE client_fts MATCH ? ORDER BY rank LIMIT 20;
+    )";
+    if (!clientQuery.empty()) {
+        Query<tuple<string_view>, tuple<int, optional<string_view>, string_view, string_view>> stmt(db, clientSQL);
+        if (!stmt) return -1;
+        out << "\nClients:" << endl;
+        stmt.run(clientQuery, [&](int clientId, optional<string_view> name, string_view phone, string_view email) {
+            out << "  Client " << clientId << ": " << name.value_or("(Unnamed)") << " | Phone: " << phone << " | Email: " << email << endl;
+            matches++;
+        });
+    }
+
+    // Pets by name, breed or condition, with their owner
+    const char* petSQL = R"(
+        SELECT p.pet_id, p.pet_name, p.breed, p.medical_condition, c.client_id, c.client_name
+        FROM pet_fts JOIN pet p ON p.pet_id = pet_fts.rowid
+        LEFT JOIN client c ON c.client_id = p.client_id
+        WHERE pet_fts MATCH ? ORDER BY rank LIMIT 20;
+    )";
+    {
+        Query<tuple<string_view>, tuple<int, optional<string_view>, optional<string_view>, string_view, int, optional<string_view>>> stmt(db, petSQL);
+        if (!stmt) return -1;
+        out << "\nPets:" << endl;
+        stmt.run(wordQuery, [&](int petId, optional<string_view> name, optional<string_view> breed, string_view condition, int clientId,
+                                optional<string_view> owner) {
+            out << "  Pet " << petId << ": " << name.value_or("(Unnamed)") << " (" << breed.value_or("unknown breed") << ")"
+                << " | Owner: " << owner.value_or("(none)") << " (client " << clientId << ")";
+            if (!condition.empty()) out << " | Condition: " << condition;
+            out << endl;
+            matches++;
+        });
+    }
+
+    // Medical histories, showing the matching part
+    const char* medicalSQL = R"(
+        SELECT m.record_id, p.pet_id, p.pet_name, snippet(medical_fts, 0, '[', ']', '...', 12)
+        FROM medical_fts JOIN medical_record m ON m.record_id = medical_fts.rowid
+        LEFT JOIN pet p ON p.pet_id = m.pet_id
+        WHERE medical_fts MATCH ? ORDER BY rank LIMIT 20;
+    )";
+    {
+        Query<tuple<string_view>, tuple<int, int, optional<string_view>, string_view>> stmt(db, medicalSQL);
+        if (!stmt) return -1;
+        out << "\nMedical records:" << endl;
+        stmt.run(wordQuery, [&](int recordId, int petId, optional<string_view> name, string_view snippet) {
+            out << "  Record " << recordId << " for " << name.value_or("(unknown pet)") << " (pet " << petId << "): " << snippet << endl;
+            matches++;
+        });
+    }
+    return matches;
+}
+
+// Today as YYYYMMDD in local time
+static int todayDate() {
+    time_t now = time(nullptr);
+    tm local;
+    localtime_r(&now, &local);
+    return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+}
+
+// The calendar day after a YYYYMMDD date
+static int nextDate(int date) {
+    int year = date / 10000, month = date / 100 % 100, day = date % 100;
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int length = month == 2 && leap ? 29 : monthDays[(month + 11) % 12];
+    if (day < length) return date + 1;
+    return month == 12 ? (year + 1) * 10000 + 101 : year * 10000 + (month + 1) * 100 + 1;
+}
+
+static bool validDate(int date) {
+    int month = date / 100 % 100, day = date % 100;
+    if (date < 19000101 || date > 29991231 || month < 1 || month > 12 || day < 1 || day > 31) return false;
+    return day == 1 || nextDate(date - 1) == date; // The day before must not be the month's last
+}
+
+// Slots an appointment starting at time (HHMM) covers, as a bitmap; 0 when it lies outside the indexed day
+static uint64_t appointmentSlots(int time) {
+    int start = time / 100 * 60 + time % 100 - SLOT_DAY_START;
+    int end = start + APPOINTMENT_SLOTS * SLOT_MINUTES;
+    if (end <= 0 || start >= 64 * SLOT_MINUTES) return 0;
+    int first = max(0, start / SLOT_MINUTES), last = min(63, (end - 1) / SLOT_MINUTES);
+    uint64_t mask = last - first == 63 ? ~0ULL : ((1ULL << (last - first + 1)) - 1) << first;
+    return mask;
+}
+
+// Bitmap of the slots a booking may start in: on the quarter hour, from opening until an hour before closing
+static uint64_t bookableStarts() {
+    int first = (GROOMING_OPEN / 100 * 60 - SLOT_DAY_START) / SLOT_MINUTES;
+    int last = (GROOMING_CLOSE / 100 * 60 - SLOT_DAY_START) / SLOT_MINUTES - APPOINTMENT_SLOTS;
+    return ((1ULL << (last - first + 1)) - 1) << first;
+}
+
+static int slotTime(int slot) {
+    int minutes = SLOT_DAY_START + slot * SLOT_MINUTES;
+    return minutes / 60 * 100 + minutes % 60;
+}
+
+// Index updates waiting on each connection's open transaction
+static map<sqlite3*, vector<PendingIndexUpdate>> pendingIndexUpdateLists;
+static mutex pendingIndexUpdateMutex;
+
+// Applying an index update now when the booking has committed, or holding it until the caller's transaction ends
+void deferIndexUpdate(sqlite3* db, function<void()> apply, function<void()> discard) {
+    if (sqlite3_get_autocommit(db)) {
+        apply();
+        return;
+    }
+    lock_guard<mutex> lock(pendingIndexUpdateMutex);
+    pendingIndexUpdateLists[db].push_back({move(apply), move(discard)});
+}
+
+size_t pendingIndexUpdates(sqlite3* db) {
+    lock_guard<mutex> lock(pendingIndexUpdateMutex);
+    auto it = pendingIndexUpdateLists.find(db);
+    return it == pendingIndexUpdateLists.end() ? 0 : it->second.size();
+}
+
+void finishIndexUpdates(sqlite3* db, size_t from, bool committed) {
+    vector<PendingIndexUpdate> updates;
+    {
+        lock_guard<mutex> lock(pendingIndexUpdateMutex);
+        auto it = pendingIndexUpdateLists.find(db);
+        if (it == pendingIndexUpdateLists.end() || it->second.size() <= from) return;
+        updates.assign(make_move_iterator(it->second.begin() + from), make_move_iterator(it->second.end()));
+        it->second.resize(from);
+        if (it->second.empty()) pendingIndexUpdateLists.erase(it);
+    }
+    for (PendingIndexUpdate& update : updates) {
+        if (committed) update.apply();
+        else update.discard();
+    }
+}
+
+// How many times rows of table were deleted or moved to another time, from the booking_changes
+// counters; -1 on failure. In-memory booking indexes reload when this changes
+static long long bookingChanges(sqlite3* db, const char* table) {
+    Query<tuple<string_view>, tuple<sqlite3_int64>> stmt(db, "SELECT changes FROM booking_changes WHERE table_name = ?;");
+    long long changes = -1;
+    if (stmt) stmt.run(table, [&](sqlite3_int64 count) { changes = count; });
+    return changes;
+}
+
+// Reading every groomer and every appointment from today on into the slot index, then on each call
+// only the appointments added since (by this or another terminal), which get higher IDs. After
+// midnight the days that have passed are dropped; the index is read again in full only when
+// appointments were deleted or moved since
+bool loadGroomingSchedule(sqlite3* db, GroomingSchedule& schedule) {
+    lock_guard<mutex> lock(schedule.lock);
+    long long changes = bookingChanges(db, "grooming_appointment");
+    if (changes < 0) return false;
+    int today = todayDate();
+    auto addAppointment = [&](sqlite3_int64 appointmentId, int groomerId, int date, int time) {
+        schedule.lastAppointmentId = max(schedule.lastAppointmentId, appointmentId);
+        if (date < schedule.firstDate) return;
+        schedule.busy[groomerId][date] |= appointmentSlots(time);
+        if (find(schedule.groomerIds.begin(), schedule.groomerIds.end(), groomerId) == schedule.groomerIds.end()) {
+            schedule.groomerIds.push_back(groomerId);
+        }
+    };
+
+    if (schedule.loaded && changes == schedule.changesSeen) {
+        if (today != schedule.firstDate) { // Rolling forward to the new day
+            schedule.firstDate = today;
+            for (auto& groomer : schedule.busy) {
+                for (auto day = groomer.second.begin(); day != groomer.second.end();) {
+                    day = day->first < today ? groomer.second.erase(day) : next(day);
+                }
+            }
+        }
+        Query<tuple<sqlite3_int64>, tuple<sqlite3_int64, int, int, int>> added(db, "SELECT appointment_id, groomer_id, grooming_date, grooming_time FROM grooming_appointment WHERE appointment_id > ? ORDER BY appointment_id;");
+        if (!added) return false;
+        schedule.loaded = added.run(schedule.lastAppointmentId, addAppointment);
+        return schedule.loaded;
+    }
+    schedule.loaded = false;
+    schedule.changesSeen = changes;
+    schedule.firstDate = today;
+    schedule.lastAppointmentId = 0;
+    schedule.groomerIds.clear();
+    schedule.busy.clear();
+    Query<tuple<>, tuple<int>> groomers(db, "SELECT groomer_id FROM groomer ORDER BY groomer_id;");
+    if (!groomers) return false;
+    groomers.run([&](int groomerId) { schedule.groomerIds.push_back(groomerId); });
+    groomers.release();
+
+    // Newest dates first is the index order, so this is a range read of only the future appointments.
+    // Past appointments with higher IDs are read again by the next catch-up and skipped there
+    Query<tuple<int>, tuple<sqlite3_int64, int, int, int>> stmt(db, "SELECT appointment_id, groomer_id, grooming_date, grooming_time FROM grooming_appointment WHERE grooming_date >= ? ORDER BY grooming_date DESC;");
+    if (!stmt) return false;
+    schedule.loaded = stmt.run(schedule.firstDate, addAppointment);
+    return schedule.loaded;
+}
+
+// Booking with a conflict check. The row is inserted first, which takes the write lock, and the groomer's
+// day is then re-read from the table: the check sees bookings made by other terminals too, and a
+// conflicting booking is rolled back. Returns the new appointment_id, or -1 with error set
+sqlite3_int64 bookGroomingAppointment(sqlite3* db, GroomingSchedule& schedule, int clientId, int groomerId,
+                                      int date, int time, string& error) {
+    OperationTimer timer("book_grooming");
+    uint64_t slots = appointmentSlots(time);
+    if (!validDate(date)) {
+        error = "invalid date " + to_string(date);
+        return -1;
+    }
+    int minutes = time / 100 * 60 + time % 100 - SLOT_DAY_START;
+    if (time % 100 >= 60 || minutes < 0 || minutes % SLOT_MINUTES != 0 || minutes / SLOT_MINUTES >= 64 ||
+        !(bookableStarts() >> (minutes / SLOT_MINUTES) & 1)) {
+        error = "appointments start on the quarter hour between " + to_string(GROOMING_OPEN) + " and " +
+                to_string(slotTime(63 - __builtin_clzll(bookableStarts())));
+        return -1;
+    }
+    if (!loadGroomingSchedule(db, schedule)) {
+        error = sqlite3_errmsg(db);
+        return -1;
+    }
+    if (date < todayDate()) {
+        error = "that date has passed";
+        return -1;
+    }
+    size_t changes = ChangeLog::pendingChanges(db);
+    if (!runCachedStatement(db, "SAVEPOINT booking;")) {
+        error = sqlite3_errmsg(db);
+        return -1;
+    }
+    auto fail = [&](const string& message) -> sqlite3_int64 {
+        error = message;
+        sqlite3_exec(db, "ROLLBACK TO booking;", nullptr, nullptr, nullptr);
+        ChangeLog::discardChanges(db, changes);
+        sqlite3_exec(db, "RELEASE booking;", nullptr, nullptr, nullptr);
+        return -1;
+    };
+
+    sqlite3_int64 appointmentId;
+    {
+        Query<tuple<int, int, int, int>, tuple<>> insert(db, R"(
+            INSERT INTO grooming_appointment (grooming_date, grooming_time, client_id, groomer_id)
+            SELECT ?1, ?2, ?3, ?4 WHERE EXISTS (SELECT 1 FROM groomer WHERE groomer_id = ?4);
+        )");
+        if (!insert || !insert.exec(date, time, clientId, groomerId)) return fail(sqlite3_errmsg(db));
+        if (sqlite3_changes(db) == 0) return fail("no groomer with ID " + to_string(groomerId));
+        appointmentId = sqlite3_last_insert_rowid(db);
+        clientProfiles.invalidateClient(clientId);
+    }
+    uint64_t dayBusy = 0;
+    {
+        Query<tuple<int, int, sqlite3_int64>, tuple<int>> day(db, "SELECT grooming_time FROM grooming_appointment WHERE groomer_id = ? AND grooming_date = ? AND appointment_id <> ?;");
+        if (!day || !day.run(groomerId, date, appointmentId, [&](int booked) { dayBusy |= appointmentSlots(booked); })) {
+            return fail(sqlite3_errmsg(db));
+        }
+    }
+    {
+        lock_guard<mutex> lock(schedule.lock);
+        schedule.busy[groomerId][date] = dayBusy; // Fresh from the table, whoever booked it
+        if (find(schedule.groomerIds.begin(), schedule.groomerIds.end(), groomerId) == schedule.groomerIds.end()) {
+            schedule.groomerIds.push_back(groomerId);
+        }
+    }
+    if (dayBusy & slots) return fail("groomer " + to_string(groomerId) + " is already booked then");
+    if (!runCachedStatement(db, "RELEASE booking;")) return fail(sqlite3_errmsg(db));
+    GroomingSchedule* index = &schedule;
+    deferIndexUpdate(db, [index, groomerId, date, slots] {
+        lock_guard<mutex> lock(index->lock);
+        index->busy[groomerId][date] |= slots;
+    }, [index] {
+        lock_guard<mutex> lock(index->lock);
+        index->loaded = false; // The day maps may hold rows of the rolled back transaction
+    });
+    return appointmentId;
+}
+
+// The next count free start times from fromDate/fromTime on, earliest first, across all groomers.
+// Works only on the in-memory bitmaps: per groomer and day, the starts with an hour free are
+// free & free>>1 & free>>2 & free>>3 on the inverted busy map
+vector<FreeSlot> findFreeSlots(GroomingSchedule& schedule, int fromDate, int fromTime, int count) {
+    OperationTimer timer("free_slots");
+    vector<FreeSlot> slots;
+    lock_guard<mutex> lock(schedule.lock);
+    if (schedule.groomerIds.empty() || count <= 0) return slots;
+    int date = max(fromDate, schedule.firstDate);
+    vector<uint64_t> starts(schedule.groomerIds.size());
+    for (int day = 0; day < 366 && static_cast<int>(slots.size()) < count; day++, date = nextDate(date)) {
+        uint64_t allowed = bookableStarts();
+        if (date == fromDate) { // Nothing earlier than the requested time on the first day
+            int minutes = fromTime / 100 * 60 + fromTime % 100 - SLOT_DAY_START;
+            int firstSlot = minutes <= 0 ? 0 : (minutes + SLOT_MINUTES - 1) / SLOT_MINUTES;
+            allowed &= firstSlot >= 64 ? 0 : ~0ULL << firstSlot;
+        }
+        uint64_t anyFree = 0;
+        for (size_t g = 0; g < schedule.groomerIds.size(); g++) {
+            uint64_t free = ~0ULL;
+            auto groomer = schedule.busy.find(schedule.groomerIds[g]);
+            if (groomer != schedule.busy.end()) {
+                auto busyDay = groomer->second.find(date);
+                if (busyDay != groomer->second.end()) free = ~busyDay->second;
+            }
+            uint64_t run = free;
+            for (int k = 1; k < APPOINTMENT_SLOTS; k++) run &= free >> k;
+            starts[g] = run & allowed;
+            anyFree |= starts[g];
+        }
+        // Earliest time first, then groomer order
+        while (anyFree && static_cast<int>(slots.size()) < count) {
+            int slot = __builtin_ctzll(anyFree);
+            anyFree &= anyFree - 1;
+            for (size_t g = 0; g < starts.size() && static_cast<int>(slots.size()) < count; g++) {
+                if (starts[g] >> slot & 1) slots.push_back({schedule.groomerIds[g], date, slotTime(slot)});
+            }
+        }
+    }
+    return slots;
+}
+
+// Phone desk submenu: quote the next free times or book one
+void groomingDeskMenu(sqlite3* db, GroomingSchedule& schedule) {
+    cout << "\nGrooming Desk:\n1. Find Next Free Slots\n2. Book Appointment" << endl;
+    int sub = promptForInt("Enter choice: ");
+    if (sub == 1) {
+        int fromDate = promptForInt("From date (YYYYMMDD, 0 for today): ");
+        int fromTime = promptForInt("From time (HHMM, 0 for opening): ");
+        int count = promptForInt("How many slots: ");
+        if (fromDate == 0) fromDate = todayDate();
+        if (!validDate(fromDate)) {
+            cout << "Invalid date." << endl;
+            return;
+        }
+        if (!loadGroomingSchedule(db, schedule)) { // Catching up with bookings made while the customer was asked
+            cerr << "❌ Failed to load the grooming schedule: " << sqlite3_errmsg(db) << endl;
+            return;
+        }
+        auto start = chrono::steady_clock::now();
+        vector<FreeSlot> slots = findFreeSlots(schedule, fromDate, fromTime, min(count, 200));
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        for (const FreeSlot& slot : slots) {
+            cout << "Date: " << slot.date << " | Time: " << slot.time << " | Groomer ID: " << slot.groomerId << '\n';
+        }
+        cout << slots.size() << " free slots found in " << micros << " µs" << endl;
+    } else if (sub == 2) {
+        int clientId = promptForInt("Client ID: ");
+        int groomerId = promptForInt("Groomer ID: ");
+        int date = promptForInt("Date (YYYYMMDD): ");
+        int time = promptForInt("Time (HHMM, on the quarter hour): ");
+        string error;
+        sqlite3_int64 appointmentId = bookGroomingAppointment(db, schedule, clientId, groomerId, date, time, error);
+        if (appointmentId > 0) cout << "✅ Booked appointment " << appointmentId << "." << endl;
+        else cout << "❌ Not booked: " << error << endl;
+    } else {
+        cout << "Invalid option." << endl;
+    }
+}
+
+// YYYYMMDD to days since 1970-01-01 and back (proleptic Gregorian calendar)
+static int dayNumber(int date) {
+    int year = date / 10000, month = date / 100 % 100, day = date % 100;
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static int dateOfDay(int dayNum) {
+    dayNum += 719468;
+    int era = (dayNum >= 0 ? dayNum : dayNum - 146096) / 146097;
+    int dayOfEra = dayNum - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int monthIndex = (5 * dayOfYear + 2) / 153;
+    int day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int year = yearOfEra + era * 400 + (month <= 2);
+    return year * 10000 + month * 100 + day;
+}
+
+// Adding the stays [checkIn, checkOut) to the nightly counts with one sweep: +1 on the first night,
+// -1 on the morning after the last, then a running sum. Nights before firstDay are dropped
+static void addStays(BoardingOccupancy& occupancy, const vector<pair<int, int>>& stays, int delta) {
+    if (stays.empty()) return;
+    int lastDay = occupancy.firstDay;
+    for (const auto& stay : stays) lastDay = max(lastDay, stay.second);
+    vector<int> changes(lastDay - occupancy.firstDay + 1, 0);
+    for (const auto& stay : stays) {
+        int from = max(stay.first, occupancy.firstDay) - occupancy.firstDay;
+        int to = stay.second - occupancy.firstDay;
+        if (from >= to) continue;
+        changes[from] += delta;
+        changes[to] -= delta;
+    }
+    if (occupancy.nights.size() < changes.size() - 1) occupancy.nights.resize(changes.size() - 1, 0);
+    int running = 0;
+    for (size_t night = 0; night + 1 < changes.size(); night++) {
+        running += changes[night];
+        occupancy.nights[night] += running;
+    }
+}
+
+// Counting the reservations added since the last sync (all of them the first time) by reading only
+// IDs above the last one seen. beforeId, when set, stops short of a reservation being booked.
+// New reservations only ever get higher IDs, so this keeps up with other terminals too; when any
+// reservation was deleted or had its dates changed, the counts are rebuilt instead
+bool syncBoardingOccupancy(sqlite3* db, BoardingOccupancy& occupancy, sqlite3_int64 beforeId) {
+    lock_guard<mutex> lock(occupancy.lock);
+    long long changes = bookingChanges(db, "boarding_reservation");
+    if (changes < 0) return false;
+    if (changes != occupancy.changesSeen) occupancy.lastReservationId = -1;
+    occupancy.changesSeen = changes;
+    if (occupancy.lastReservationId < 0) {
+        occupancy.firstDay = dayNumber(todayDate());
+        occupancy.nights.assign(MAX_BOARDING_NIGHTS, 0);
+        occupancy.lastReservationId = 0;
+    }
+    Query<tuple<sqlite3_int64, sqlite3_int64>, tuple<sqlite3_int64, int, int>> stmt(db, "SELECT reservation_id, check_in, check_out FROM boarding_reservation WHERE reservation_id > ?1 AND (?2 = 0 OR reservation_id < ?2) ORDER BY reservation_id;");
+    if (!stmt) return false;
+    vector<pair<int, int>> stays;
+    sqlite3_int64 lastId = occupancy.lastReservationId;
+    bool ok = stmt.run(occupancy.lastReservationId, beforeId, [&](sqlite3_int64 reservationId, int checkIn, int checkOut) {
+        lastId = reservationId;
+        if (!validDate(checkIn) || !validDate(checkOut)) return; // Rows with missing dates take no nights
+        int last = dayNumber(checkOut);
+        if (last > occupancy.firstDay) stays.push_back({dayNumber(checkIn), min(last, dayNumber(checkIn) + MAX_BOARDING_NIGHTS)});
+    });
+    if (!ok) return false;
+    addStays(occupancy, stays, 1);
+    occupancy.lastReservationId = lastId;
+    return true;
+}
+
+// Pets on site for nightCount nights from fromDate into counts. Returns the first date covered,
+// which is later than fromDate when that is before the index starts
+int nightlyOccupancy(BoardingOccupancy& occupancy, int fromDate, int nightCount, vector<int>& counts) {
+    OperationTimer timer("occupancy");
+    lock_guard<mutex> lock(occupancy.lock);
+    int first = max(dayNumber(fromDate), occupancy.firstDay);
+    counts.assign(max(nightCount, 0), 0);
+    for (int night = 0; night < nightCount; night++) {
+        size_t index = first + night - occupancy.firstDay;
+        if (index < occupancy.nights.size()) counts[night] = occupancy.nights[index];
+    }
+    return dateOfDay(first);
+}
+
+// Booking a stay if the kennel has room on every night of it. The row is inserted first, which takes
+// the write lock, then the counts are caught up with every earlier reservation and checked; a stay
+// that would go over BOARDING_CAPACITY is rolled back. Returns the new reservation_id, or -1 with error set
+sqlite3_int64 bookBoardingReservation(sqlite3* db, BoardingOccupancy& occupancy, int clientId, int petId,
+                                      int checkIn, int checkOut, double amount, string& error) {
+    OperationTimer timer("book_boarding");
+    if (!validDate(checkIn) || !validDate(checkOut) || checkOut <= checkIn) {
+        error = "check-out must be a valid date after check-in";
+        return -1;
+    }
+    int firstNight = dayNumber(checkIn), lastNight = dayNumber(checkOut);
+    if (lastNight - firstNight > MAX_BOARDING_NIGHTS) {
+        error = "stays are limited to " + to_string(MAX_BOARDING_NIGHTS) + " nights";
+        return -1;
+    }
+    if (firstNight < dayNumber(todayDate())) {
+        error = "check-in has passed";
+        return -1;
+    }
+    size_t changes = ChangeLog::pendingChanges(db);
+    if (!runCachedStatement(db, "SAVEPOINT boarding;")) {
+        error = sqlite3_errmsg(db);
+        return -1;
+    }
+    auto fail = [&](const string& message) -> sqlite3_int64 {
+        error = message;
+        sqlite3_exec(db, "ROLLBACK TO boarding;", nullptr, nullptr, nullptr);
+        ChangeLog::discardChanges(db, changes);
+        sqlite3_exec(db, "RELEASE boarding;", nullptr, nullptr, nullptr);
+        return -1;
+    };
+
+    sqlite3_int64 reservationId;
+    {
+        Query<tuple<int, int, int, int, double>, tuple<>> insert(db, R"(
+            INSERT INTO boarding_reservation (check_in, check_out, client_id, pet_id, amount)
+            SELECT ?1, ?2, client_id, pet_id, ?5 FROM pet WHERE pet_id = ?4 AND client_id = ?3;
+        )");
+        if (!insert || !insert.exec(checkIn, checkOut, clientId, petId, amount)) return fail(sqlite3_errmsg(db));
+        if (sqlite3_changes(db) == 0) return fail("client " + to_string(clientId) + " has no pet with ID " + to_string(petId));
+        reservationId = sqlite3_last_insert_rowid(db);
+        clientProfiles.invalidateClient(clientId);
+    }
+    if (!syncBoardingOccupancy(db, occupancy, reservationId)) return fail(sqlite3_errmsg(db));
+    {
+        lock_guard<mutex> lock(occupancy.lock);
+        for (int night = firstNight; night < lastNight; night++) {
+            size_t index = night - occupancy.firstDay;
+            if (index < occupancy.nights.size() && occupancy.nights[index] >= BOARDING_CAPACITY) {
+                return fail("the kennel is full on the night of " + to_string(dateOfDay(night)));
+            }
+        }
+    }
+    if (!runCachedStatement(db, "RELEASE boarding;")) return fail(sqlite3_errmsg(db));
+    BoardingOccupancy* index = &occupancy;
+    deferIndexUpdate(db, [index, reservationId, firstNight, lastNight] {
+        lock_guard<mutex> lock(index->lock);
+        if (index->lastReservationId < 0 || reservationId <= index->lastReservationId) return; // Already counted by a sync
+        addStays(*index, {{firstNight, lastNight}}, 1);
+        index->lastReservationId = reservationId;
+    }, [index] {
+        lock_guard<mutex> lock(index->lock);
+        index->lastReservationId = -1; // A sync may have counted rows of the rolled back transaction
+    });
+    return reservationId;
+}
+
+// Boarding desk submenu: nightly occupancy ahead, or a new reservation
+void boardingDeskMenu(sqlite3* db, BoardingOccupancy& occupancy) {
+    cout << "\nBoarding Desk:\n1. Occupancy for the Next 90 Nights\n2. New Reservation" << endl;
+    int sub = promptForInt("Enter choice: ");
+    if (!syncBoardingOccupancy(db, occupancy)) {
+        cerr << "❌ Failed to load boarding reservations: " << sqlite3_errmsg(db) << endl;
+        return;
+    }
+    if (sub == 1) {
+        vector<int> counts;
+        int first = nightlyOccupancy(occupancy, todayDate(), 90, counts);
+        int day = dayNumber(first);
+        for (size_t night = 0; night < counts.size(); night++) {
+            cout << "Night of " << dateOfDay(day + static_cast<int>(night)) << " | Pets: " << counts[night]
+                 << " | Free runs: " << max(0, BOARDING_CAPACITY - counts[night]) << '\n';
+        }
+        cout << flush;
+    } else if (sub == 2) {
+        int clientId = promptForInt("Client ID: ");
+        int petId = promptForInt("Pet ID: ");
+        int checkIn = promptForInt("Check-in date (YYYYMMDD): ");
+        int checkOut = promptForInt("Check-out date (YYYYMMDD): ");
+        double amount;
+        cout << "Amount: ";
+        cin >> amount;
+        if (cin.fail()) {
+            cin.clear();
+            amount = 0;
+        }
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        string error;
+        sqlite3_int64 reservationId = bookBoardingReservation(db, occupancy, clientId, petId, checkIn, checkOut, amount, error);
+        if (reservationId > 0) cout << "✅ Reserved, reservation " << reservationId << "." << endl;
+        else cout << "❌ Not reserved: " << error << endl;
+    } else {
+        cout << "Invalid option." << endl;
+    }
+}
+
+shared_ptr<const ClientProfile> ClientProfileCache::find(int clientId) {
+    {
+        // Only when the writer is idle; a busy writer checks at its next BEGIN, before anyone else can commit
+        unique_lock<mutex> guard(lock);
+        sqlite3* watched = writer;
+        mutex* watchedMutex = writerMutex;
+        guard.unlock();
+        if (watched) {
+            unique_lock<mutex> writerLock(*watchedMutex, try_to_lock);
+            if (writerLock.owns_lock()) checkWriterVersion(watched);
+        }
+    }
+    lock_guard<mutex> guard(lock);
+    auto entry = byClient.find(clientId);
+    if (entry == byClient.end() || chrono::steady_clock::now() - (*entry->second)->loaded > PROFILE_MAX_AGE) {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    recent.splice(recent.begin(), recent, entry->second);
+    return *entry->second;
+}
+
+uint64_t ClientProfileCache::generation(int clientId) {
+    lock_guard<mutex> guard(lock);
+    return clientChanges[static_cast<unsigned>(clientId) % PROFILE_GENERATION_SLOTS] + sharedChanges;
+}
+
+void ClientProfileCache::store(shared_ptr<const ClientProfile> profile, uint64_t fetchGeneration) {
+    lock_guard<mutex> guard(lock);
+    // A write to this client (or one that could be to any client) was invalidated while it was read
+    if (fetchGeneration != clientChanges[static_cast<unsigned>(profile->clientId) % PROFILE_GENERATION_SLOTS] + sharedChanges) return;
+    erase(profile->clientId);
+    for (const auto& pet : profile->pets) petOwners[pet.first] = profile->clientId;
+    recent.push_front(move(profile));
+    byClient[recent.front()->clientId] = recent.begin();
+    while (recent.size() > capacity) {
+        evictions++;
+        erase(recent.back()->clientId);
+    }
+}
+
+void ClientProfileCache::erase(int clientId) {
+    auto entry = byClient.find(clientId);
+    if (entry == byClient.end()) return;
+    for (const auto& pet : (*entry->second)->pets) petOwners.erase(pet.first);
+    recent.erase(entry->second);
+    byClient.erase(entry);
+}
+
+void ClientProfileCache::bumpClient(int clientId) {
+    clientChanges[static_cast<unsigned>(clientId) % PROFILE_GENERATION_SLOTS]++;
+}
+
+void ClientProfileCache::dropAll() {
+    sharedChanges++;
+    recent.clear();
+    byClient.clear();
+    petOwners.clear();
+}
+
+void ClientProfileCache::invalidateClient(int clientId) {
+    lock_guard<mutex> guard(lock);
+    bumpClient(clientId);
+    invalidations++;
+    erase(clientId);
+    if (!pendingAll) pendingClients.push_back(clientId);
+    // Loads without a settle (--ingest-sales, --import) would grow the lists without end
+    if (pendingClients.size() + pendingPets.size() > capacity) {
+        pendingAll = true;
+        pendingClients.clear();
+        pendingPets.clear();
+    }
+}
+
+void ClientProfileCache::invalidatePet(int petId) {
+    lock_guard<mutex> guard(lock);
+    invalidations++;
+    auto owner = petOwners.find(petId);
+    if (owner != petOwners.end()) {
+        bumpClient(owner->second);
+        erase(owner->second);
+    } else {
+        sharedChanges++; // The owner may be being fetched right now
+    }
+    if (!pendingAll) pendingPets.push_back(petId);
+    if (pendingClients.size() + pendingPets.size() > capacity) {
+        pendingAll = true;
+        pendingClients.clear();
+        pendingPets.clear();
+    }
+}
+
+// Dropping again what the just-committed writes invalidated: a fetch may have cached the snapshot
+// from before the commit in between (its generation check only catches invalidations after it began)
+void ClientProfileCache::settle() {
+    lock_guard<mutex> guard(lock);
+    if (!pendingAll && pendingClients.empty() && pendingPets.empty()) return;
+    if (pendingAll) dropAll();
+    for (int clientId : pendingClients) {
+        bumpClient(clientId);
+        erase(clientId);
+    }
+    for (int petId : pendingPets) {
+        auto owner = petOwners.find(petId);
+        if (owner != petOwners.end()) {
+            bumpClient(owner->second);
+            erase(owner->second);
+        } else {
+            sharedChanges++;
+        }
+    }
+    pendingClients.clear();
+    pendingPets.clear();
+    pendingAll = false;
+}
+
+void ClientProfileCache::watchWriter(sqlite3* db, mutex* dbMutex) {
+    lock_guard<mutex> guard(lock);
+    writer = db;
+    writerMutex = dbMutex;
+    writerVersion = -1;
+}
+
+// PRAGMA data_version changes only when another connection commits. In this process every write goes
+// through the watched connection, so a change means another process wrote. The first reading only sets
+// the baseline: profiles cached before it was taken are bounded by PROFILE_MAX_AGE, as without a writer
+void ClientProfileCache::checkWriterVersion(sqlite3* db) {
+    long long version = -1;
+    {
+        CachedStatement stmt(db, "PRAGMA data_version;");
+        if (stmt && sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int64(stmt, 0);
+    }
+    if (version < 0) return;
+    lock_guard<mutex> guard(lock);
+    if (db != writer) return;
+    if (writerVersion >= 0 && version != writerVersion) {
+        foreignCommits++;
+        dropAll();
+    }
+    writerVersion = version;
+}
+
+void ClientProfileCache::printStats(ostream& out) {
+    lock_guard<mutex> guard(lock);
+    long long lookups = hits + misses;
+    out << "Client profile cache: " << recent.size() << "/" << capacity << " profiles, " << hits << " hits, "
+        << misses << " misses";
+    if (lookups > 0) out << " (" << (100 * hits / lookups) << "% hit rate)";
+    out << ", " << invalidations << " invalidations, " << evictions << " evictions, "
+        << foreignCommits << " drops for other processes' writes" << endl;
+}
+
+// Text of a column, or fallback for NULL
+static string columnText(sqlite3_stmt* stmt, int column, const char* fallback = "") {
+    const unsigned char* text = sqlite3_column_text(stmt, column);
+    return text ? reinterpret_cast<const char*>(text) : fallback;
+}
+
+// The six parts of a profile. All on one connection inside one read transaction, so they agree
+static bool readClientProfile(sqlite3* db, int clientId, ClientProfile& profile, bool& found) {
+    using Text = string_view;
+    using Name = optional<string_view>;
+    found = false;
+    Query<tuple<int>, tuple<Text, Text, Text, Text>> client(db, "SELECT client_name, phone, email, client_address FROM client WHERE client_id = ?1;");
+    if (!client) return false;
+    bool ok = client.run(clientId, [&](Text name, Text phone, Text email, Text address) {
+        profile.client = {string(name), string(phone), string(email), string(address)};
+        found = true;
+    });
+    client.release();
+    if (!ok || !found) return ok;
+
+    Query<tuple<int>, tuple<int, Text, Text, int, Text, Text, int, Text>> pets(db, R"(
+        SELECT pet_id, pet_name, breed, age, medical_condition, diet_restriction, friendly, emergency_contact
+        FROM pet WHERE client_id = ?1 ORDER BY pet_id;
+    )");
+    if (!pets || !pets.run(clientId, [&](int petId, Text name, Text breed, int age, Text condition, Text diet, int friendly, Text contact) {
+            PetRecord pet{string(name), string(breed), age, string(condition), string(diet), friendly, string(contact), clientId};
+            profile.pets.push_back({petId, move(pet)});
+        })) {
+        return false;
+    }
+    pets.release();
+
+    Query<tuple<int>, tuple<Name, Text, Text, Text>> medical(db, R"(
+        SELECT p.pet_name, m.date_of_last_update, m.vaccine_record, m.medical_history
+        FROM pet p JOIN medical_record m ON m.pet_id = p.pet_id
+        WHERE p.client_id = ?1 ORDER BY m.date_of_last_update DESC, m.record_id DESC;
+    )");
+    if (!medical || !medical.run(clientId, [&](Name pet, Text updated, Text vaccines, Text history) {
+            string line = "Pet: ";
+            line.append(pet.value_or("(Unnamed)")).append(" | Updated: ").append(updated).append(" | Vaccines: ").append(vaccines);
+            profile.medicalRecords.push_back(line.append(" | History: ").append(history));
+        })) {
+        return false;
+    }
+    medical.release();
+
+    // Stays share formatBoardingRow with the paged boarding list
+    Query<tuple<int, int>, tuple<Name, int, int, double>> stays(db, R"(
+        SELECT p.pet_name, b.check_in, b.check_out, b.amount
+        FROM boarding_reservation b LEFT JOIN pet p ON p.pet_id = b.pet_id
+        WHERE b.client_id = ?1 ORDER BY b.check_in DESC, b.reservation_id DESC LIMIT ?2;
+    )");
+    if (!stays || !stays.run(clientId, PROFILE_RECENT_ROWS, [&](Name pet, int checkIn, int checkOut, double amount) {
+            ostringstream line;
+            formatBoardingRow(line, pet, checkIn, checkOut, amount);
+            profile.stays.push_back(line.str());
+        })) {
+        return false;
+    }
+    stays.release();
+
+    Query<tuple<int, int>, tuple<Text, Text, Name>> appointments(db, R"(
+        SELECT g.grooming_date, g.grooming_time, gr.groomer_name
+        FROM grooming_appointment g LEFT JOIN groomer gr ON gr.groomer_id = g.groomer_id
+        WHERE g.client_id = ?1 ORDER BY g.grooming_date DESC, g.grooming_time DESC LIMIT ?2;
+    )");
+    if (!appointments || !appointments.run(clientId, PROFILE_RECENT_ROWS, [&](Text date, Text time, Name groomer) {
+            string line = "Date: ";
+            line.append(date).append(" | Time: ").append(time).append(" | Groomer: ").append(groomer.value_or("(Unnamed)"));
+            profile.appointments.push_back(move(line));
+        })) {
+        return false;
+    }
+    appointments.release();
+
+    Query<tuple<int, int>, tuple<Text, Text, Text, double, Text>> sales(db, R"(
+        SELECT ledger_date, ledger_time, item_or_service_purchase, amount, payment_method
+        FROM general_ledger WHERE client_id = ?1 ORDER BY ledger_date DESC, ledger_time DESC LIMIT ?2;
+    )");
+    return sales && sales.run(clientId, PROFILE_RECENT_ROWS, [&](Text date, Text time, Text item, double amount, Text method) {
+        char price[32];
+        snprintf(price, sizeof(price), "$%.2f", amount);
+        string line = "Date: ";
+        line.append(date).append(" | Time: ").append(time).append(" | ").append(item).append(" | ").append(price);
+        profile.sales.push_back(line.append(" | ").append(method));
+    });
+}
+
+// A client's profile from the cache, or read in one snapshot and cached. Returns false when the read
+// failed; profile is left null when there is no such client
+bool fetchClientProfile(sqlite3* db, int clientId, shared_ptr<const ClientProfile>& profile) {
+    OperationTimer timer("client_profile");
+    profile = clientProfiles.find(clientId);
+    if (profile) return true;
+    uint64_t generation = clientProfiles.generation(clientId);
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !runCachedStatement(db, "BEGIN;")) return false;
+    auto fetched = make_shared<ClientProfile>();
+    fetched->clientId = clientId;
+    fetched->loaded = chrono::steady_clock::now();
+    bool found;
+    bool ok = readClientProfile(db, clientId, *fetched, found);
+    if (ownTransaction) runCachedStatement(db, ok ? "COMMIT;" : "ROLLBACK;");
+    if (!ok || !found) return ok;
+    clientProfiles.store(fetched, generation);
+    profile = move(fetched);
+    return true;
+}
+
+void writeClientProfile(const ClientProfile& profile, ostream& out, const char* linePrefix) {
+    const ClientRecord& client = profile.client;
+    out << linePrefix << "Client " << profile.clientId << ": " << client.name << " | Phone: " << client.phone
+        << " | Email: " << client.email << " | Address: " << client.address << '\n';
+    for (const auto& [petId, pet] : profile.pets) {
+        out << linePrefix << "Pet " << petId << ": " << pet.name << " | Breed: " << pet.breed << " | Age: " << pet.age
+            << " | Condition: " << pet.medicalCondition << " | Diet: " << pet.dietRestriction
+            << " | Friendly: " << (pet.friendly ? "Yes" : "No") << " | Emergency: " << pet.emergencyContact << '\n';
+    }
+    for (const string& line : profile.medicalRecords) out << linePrefix << "Medical: " << line << '\n';
+    for (const string& line : profile.stays) out << linePrefix << "Stay: " << line << '\n';
+    for (const string& line : profile.appointments) out << linePrefix << "Grooming: " << line << '\n';
+    for (const string& line : profile.sales) out << linePrefix << "Sale: " << line << '\n';
+}
+
+// Check-in lookup: the client, pets, medical records and recent stays, grooming and sales on one screen
+void clientProfileMenu(sqlite3* db) {
+    int clientId = promptForInt("\nEnter client ID: ");
+    shared_ptr<const ClientProfile> profile;
+    if (!fetchClientProfile(db, clientId, profile)) {
+        cerr << "❌ Failed to read the client profile: " << sqlite3_errmsg(db) << endl;
+        return;
+    }
+    if (!profile) {
+        cout << "❌ No client found with ID " << clientId << endl;
+        return;
+    }
+    cout << "\n=== Client Profile ===" << endl;
+    writeClientProfile(*profile, cout);
+    cout << flush;
+}
+
+// Bulk purge for --purge. selection is inactive:YYYYMMDD (no sale, stay or grooming on or after that
+// date; for pets, no stay), ids:FILE (one ID per line) or where:CONDITION (SQL on the client/pet row)
+int purgeRecords(sqlite3* db, const string& what, const string& selection, int chunkSize) {
+    if (what != "clients" && what != "pets") {
+        cerr << "❌ Usage: --purge clients|pets inactive:YYYYMMDD|ids:FILE|where:CONDITION [CHUNK]" << endl;
+        return 1;
+    }
+    bool clients = what == "clients";
+    size_t colon = selection.find(':');
+    string kind = selection.substr(0, colon), value = colon == string::npos ? "" : selection.substr(colon + 1);
+    string where;
+    if (kind == "inactive") {
+        int date = atoi(value.c_str());
+        if (!validDate(date)) {
+            cerr << "❌ inactive: needs a YYYYMMDD date" << endl;
+            return 1;
+        }
+        string since = to_string(date);
+        where = clients ? "NOT EXISTS (SELECT 1 FROM general_ledger g WHERE g.client_id = client.client_id AND g.ledger_date >= " + since + ")"
+                          " AND NOT EXISTS (SELECT 1 FROM boarding_reservation b WHERE b.client_id = client.client_id AND b.check_out >= " + since + ")"
+                          " AND NOT EXISTS (SELECT 1 FROM grooming_appointment a WHERE a.client_id = client.client_id AND a.grooming_date >= " + since + ")"
+                        : "NOT EXISTS (SELECT 1 FROM boarding_reservation b WHERE b.pet_id = pet.pet_id AND b.check_out >= " + since + ")";
+    } else if (kind == "ids") {
+        ifstream file(value);
+        if (!file) {
+            cerr << "Failed to open " << value << endl;
+            return 1;
+        }
+        string line, ids;
+        int id;
+        while (getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            char* end;
+            id = static_cast<int>(strtol(line.c_str(), &end, 10));
+            if (*end != '\0') {
+                cerr << "❌ Not an ID: " << line << endl;
+                return 1;
+            }
+            ids += (ids.empty() ? "" : ",") + to_string(id);
+        }
+        where = string(clients ? "client_id" : "pet_id") + " IN (" + ids + ")";
+    } else if (kind == "where" && !value.empty()) {
+        where = value;
+    } else {
+        cerr << "❌ Unknown selection '" << selection << "' (expected inactive:YYYYMMDD, ids:FILE or where:CONDITION)" << endl;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    CascadeCounts counts;
+    bool ok = cascadeDelete(db, clients ? CASCADE_CLIENTS : CASCADE_PETS, where, max(1, chunkSize), counts);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!ok) cerr << "❌ Purge stopped: " << sqlite3_errmsg(db) << " (the chunks before this one stay deleted)" << endl;
+    cout << (ok ? "✅" : "❌") << " Deleted " << counts.clients << " clients, " << counts.pets << " pets, "
+         << counts.medicalRecords << " medical records, " << counts.boardingReservations << " boarding reservations, "
+         << counts.groomingAppointments << " grooming appointments, " << counts.sales << " sales (" << counts.saleItems
+         << " items) in " << seconds << "s" << endl;
+    return ok ? 0 : 1;
+}
+
+// Attaching the archive years listed in history_archive as archive_YYYY and pointing the temp view
+// boarding_history at the live stays plus every attached year. With no archives the view is the live
+// table alone, so the list plans do not change. Reports call this before they run; it only re-attaches
+// when the registry has changed, and that needs the connection to be outside a transaction
+bool attachArchives(sqlite3* db) {
+    vector<pair<int, string>> wanted; // Newest year first, so the newest are kept when there are too many
+    vector<string> missing;
+    {
+        CachedStatement stmt(db, "SELECT year, file FROM main.history_archive ORDER BY year DESC;");
+        if (!stmt) return false;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            string file = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            if (access(archivePath(db, file).c_str(), R_OK) == 0) wanted.push_back({sqlite3_column_int(stmt, 0), file});
+            else missing.push_back(file);
+        }
+    }
+    size_t slots = static_cast<size_t>(sqlite3_limit(db, SQLITE_LIMIT_ATTACHED, -1));
+    size_t skipped = wanted.size() > slots ? wanted.size() - slots : 0;
+    wanted.resize(wanted.size() - skipped);
+
+    vector<string> attached;
+    bool haveView = false;
+    {
+        CachedStatement list(db, "SELECT name FROM pragma_database_list WHERE name LIKE 'archive\\_%' ESCAPE '\\';");
+        if (!list) return false;
+        while (sqlite3_step(list) == SQLITE_ROW) attached.push_back(reinterpret_cast<const char*>(sqlite3_column_text(list, 0)));
+        CachedStatement view(db, "SELECT 1 FROM temp.sqlite_schema WHERE name = 'boarding_history';");
+        haveView = view && sqlite3_step(view) == SQLITE_ROW;
+    }
+    vector<string> names;
+    for (const auto& year : wanted) names.push_back("archive_" + to_string(year.first));
+    sort(attached.begin(), attached.end());
+    vector<string> sortedNames = names;
+    sort(sortedNames.begin(), sortedNames.end());
+    if (haveView && attached == sortedNames) return true;
+
+    for (const string& file : missing) cerr << "⚠️ Archive " << file << " is missing, its years are left out" << endl;
+    if (skipped > 0) cerr << "⚠️ Only the newest " << slots << " archive years can be attached, " << skipped << " left out" << endl;
+    const char* columns = "reservation_id, check_in, check_out, client_id, pet_id, amount";
+    string view = string("DROP VIEW IF EXISTS temp.boarding_history; CREATE TEMP VIEW boarding_history AS SELECT ") +
+                  columns + " FROM main.boarding_reservation";
+    for (const string& name : attached) {
+        if (find(names.begin(), names.end(), name) != names.end()) continue;
+        if (!runCachedStatement(db, ("DETACH DATABASE " + name + ";").c_str())) return false;
+    }
+    for (size_t i = 0; i < wanted.size(); i++) {
+        if (find(attached.begin(), attached.end(), names[i]) == attached.end()) {
+            CachedStatement attach(db, ("ATTACH DATABASE ?1 AS " + names[i] + ";").c_str());
+            if (!attach) return false;
+            string path = archivePath(db, wanted[i].second);
+            sqlite3_bind_text(attach, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(attach) != SQLITE_DONE) return false;
+        }
+        // A stay can be in both files for a moment while --archive moves it; the live copy wins
+        view += string(" UNION ALL SELECT ") + columns + " FROM " + names[i] + ".boarding_reservation a" +
+                " WHERE NOT EXISTS (SELECT 1 FROM main.boarding_reservation m WHERE m.reservation_id = a.reservation_id)";
+    }
+    view += ";";
+    return sqlite3_exec(db, view.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+// Running one step of an archive move over the dates ?1..?2, adding the rows it changed to count
+static bool archiveStep(sqlite3* db, const char* sql, int fromDate, int toDate, long long* count = nullptr) {
+    CachedStatement stmt(db, sql);
+    if (!stmt) return false;
+    sqlite3_bind_int(stmt, 1, fromDate);
+    sqlite3_bind_int(stmt, 2, toDate);
+    if (sqlite3_step(stmt) != SQLITE_DONE) return false;
+    if (count) *count += sqlite3_changes(db);
+    return true;
+}
+
+// Moving sales (with their items) dated before cutoff and stays that ended before it out of the live file,
+// into one archive file per year, a month per step. Each month is first copied into the archive and
+// committed there, then deleted from the live file in a second short transaction: a crash in between
+// leaves the month in both files (the copy is skipped on the re-run) and never in neither. The delete
+// only takes rows whose copy is in the archive, so a sale or stay written into the month between the
+// two transactions stays live until the next run. The daily rollups keep the archived days, so the
+// revenue and top item reports still cover every year
+int archiveHistory(sqlite3* db, int cutoff) {
+    if (!validDate(cutoff) || cutoff > todayDate()) {
+        cerr << "❌ Usage: --archive YYYYMMDD (a date no later than today; older sales and stays are archived)" << endl;
+        return 1;
+    }
+    int firstYear = 0;
+    {
+        // Multi-argument MIN is NULL when either table is empty, so each side falls back to the other
+        CachedStatement stmt(db, R"(
+            WITH firsts (sale, stay) AS (
+                SELECT (SELECT MIN(ledger_date) FROM general_ledger WHERE ledger_date IS NOT NULL),
+                       (SELECT MIN(check_out) FROM boarding_reservation WHERE check_out IS NOT NULL))
+            SELECT MIN(COALESCE(sale, stay), COALESCE(stay, sale)) / 10000 FROM firsts;
+        )");
+        if (!stmt || sqlite3_step(stmt) != SQLITE_ROW) {
+            cerr << "❌ " << sqlite3_errmsg(db) << endl;
+            return 1;
+        }
+        firstYear = sqlite3_column_int(stmt, 0);
+    }
+    if (!runCachedStatement(db, "CREATE TEMP TABLE IF NOT EXISTS kept_revenue AS SELECT * FROM daily_revenue WHERE 0;") ||
+        !runCachedStatement(db, "CREATE TEMP TABLE IF NOT EXISTS kept_item_sales AS SELECT * FROM daily_item_sales WHERE 0;")) {
+        cerr << "❌ " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    long long sales = 0, saleItems = 0, stays = 0;
+    int years = 0;
+    bool ok = true;
+    for (int year = firstYear; ok && firstYear > 0 && year * 10000 + 101 < cutoff; year++) {
+        char file[64];
+        snprintf(file, sizeof(file), "kennel_archive_%d.db", year);
+        string path = archivePath(db, file);
+        {
+            CachedStatement attach(db, "ATTACH DATABASE ?1 AS archive;");
+            ok = attach && sqlite3_bind_text(attach, 1, path.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK &&
+                 sqlite3_step(attach) == SQLITE_DONE;
+        }
+        // Registered before any row leaves the live file, so reports find the year from the start
+        ok = ok && sqlite3_exec(db, ARCHIVE_SCHEMA, nullptr, nullptr, nullptr) == SQLITE_OK;
+        if (ok) {
+            CachedStatement registry(db, "INSERT OR IGNORE INTO history_archive (year, file) VALUES (?1, ?2);");
+            ok = registry && sqlite3_bind_int(registry, 1, year) == SQLITE_OK &&
+                 sqlite3_bind_text(registry, 2, file, -1, SQLITE_TRANSIENT) == SQLITE_OK && sqlite3_step(registry) == SQLITE_DONE;
+        }
+        long long movedBefore = sales + stays;
+        for (int month = 1; ok && month <= 12; month++) {
+            int fromDate = year * 10000 + month * 100, toDate = min(fromDate + 99, cutoff - 1);
+            if (fromDate > toDate) break;
+            auto sliceStart = chrono::steady_clock::now();
+            // Copy: writes only the archive file
+            ok = runCachedStatement(db, "BEGIN;") &&
+                 archiveStep(db, R"(
+                     INSERT OR IGNORE INTO archive.general_ledger (general_ledger_id, ledger_date, ledger_time, item_or_service_purchase,
+                                                                   amount, discount, payment_method, client_id, employee_id)
+                     SELECT general_ledger_id, ledger_date, ledger_time, item_or_service_purchase, amount, discount, payment_method,
+                            client_id, employee_id
+                     FROM main.general_ledger WHERE ledger_date BETWEEN ?1 AND ?2;)", fromDate, toDate) &&
+                 archiveStep(db, R"(
+                     INSERT OR IGNORE INTO archive.ledger_item (ledger_item_id, ledger_id, item_id, quantity)
+                     SELECT li.ledger_item_id, li.ledger_id, li.item_id, li.quantity
+                     FROM main.general_ledger g JOIN main.ledger_item li ON li.ledger_id = g.general_ledger_id
+                     WHERE g.ledger_date BETWEEN ?1 AND ?2;)", fromDate, toDate) &&
+                 archiveStep(db, R"(
+                     INSERT OR IGNORE INTO archive.boarding_reservation (reservation_id, check_in, check_out, client_id, pet_id, amount)
+                     SELECT reservation_id, check_in, check_out, client_id, pet_id, amount
+                     FROM main.boarding_reservation WHERE check_out BETWEEN ?1 AND ?2;)", fromDate, toDate) &&
+                 runCachedStatement(db, "COMMIT;");
+            // Delete: items before their sales, and the month's rollup rows put back as they were
+            ok = ok && runCachedStatement(db, "BEGIN IMMEDIATE;") &&
+                 runCachedStatement(db, "DELETE FROM temp.kept_revenue;") &&
+                 runCachedStatement(db, "DELETE FROM temp.kept_item_sales;") &&
+                 archiveStep(db, "INSERT INTO temp.kept_revenue SELECT * FROM main.daily_revenue WHERE ledger_date BETWEEN ?1 AND ?2;",
+                             fromDate, toDate) &&
+                 archiveStep(db, "INSERT INTO temp.kept_item_sales SELECT * FROM main.daily_item_sales WHERE ledger_date BETWEEN ?1 AND ?2;",
+                             fromDate, toDate) &&
+                 archiveStep(db, R"(
+                     DELETE FROM main.ledger_item WHERE ledger_id IN (
+                         SELECT g.general_ledger_id FROM main.general_ledger g
+                         WHERE g.ledger_date BETWEEN ?1 AND ?2
+                           AND EXISTS (SELECT 1 FROM archive.general_ledger a WHERE a.general_ledger_id = g.general_ledger_id)
+                           AND NOT EXISTS (SELECT 1 FROM main.ledger_item li WHERE li.ledger_id = g.general_ledger_id
+                                           AND NOT EXISTS (SELECT 1 FROM archive.ledger_item a WHERE a.ledger_item_id = li.ledger_item_id)));)",
+                             fromDate, toDate, &saleItems) &&
+                 archiveStep(db, R"(
+                     DELETE FROM main.general_ledger WHERE ledger_date BETWEEN ?1 AND ?2
+                         AND EXISTS (SELECT 1 FROM archive.general_ledger a WHERE a.general_ledger_id = main.general_ledger.general_ledger_id)
+                         AND NOT EXISTS (SELECT 1 FROM main.ledger_item li WHERE li.ledger_id = main.general_ledger.general_ledger_id);)",
+                             fromDate, toDate, &sales) &&
+                 archiveStep(db, R"(
+                     DELETE FROM main.boarding_reservation WHERE check_out BETWEEN ?1 AND ?2
+                         AND EXISTS (SELECT 1 FROM archive.boarding_reservation a WHERE a.reservation_id = main.boarding_reservation.reservation_id);)",
+                             fromDate, toDate, &stays) &&
+                 runCachedStatement(db, "INSERT OR REPLACE INTO main.daily_revenue SELECT * FROM temp.kept_revenue;") &&
+                 runCachedStatement(db, "INSERT OR REPLACE INTO main.daily_item_sales SELECT * FROM temp.kept_item_sales;") &&
+                 runCachedStatement(db, "COMMIT;");
+            if (!ok) {
+                cerr << "❌ Archiving " << fromDate / 100 << " failed: " << sqlite3_errmsg(db) << endl;
+                sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                break;
+            }
+            yieldAfterSlice(sliceStart);
+        }
+        if (ok && sales + stays > movedBefore) {
+            years++;
+            clog << "Archived " << year << " to " << file << endl;
+        }
+        runCachedStatement(db, "DETACH DATABASE archive;");
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << (ok ? "✅" : "❌") << " Moved " << sales << " sales (" << saleItems << " items) and " << stays
+         << " boarding stays dated before " << cutoff << " into " << years << " archive years in " << seconds << "s" << endl;
+    return ok ? 0 : 1;
+}
+
+// The sales in the live file and in every attached archive year as one subquery, with money already in
+// whole cents. A sale caught in both files by an interrupted --archive is taken from the live file.
+// Lines: ledger_date, quantity, cents, category. Sales: ledger_date, cents, employee_id, employee, payment
+static string allSalesSQL(sqlite3* db, bool lines) {
+    vector<string> schemas = {"main"};
+    {
+        CachedStatement list(db, "SELECT name FROM pragma_database_list WHERE name LIKE 'archive\\_%' ESCAPE '\\' ORDER BY name;");
+        while (list && sqlite3_step(list) == SQLITE_ROW) schemas.push_back(reinterpret_cast<const char*>(sqlite3_column_text(list, 0)));
+    }
+    string sql;
+    for (const string& schema : schemas) {
+        if (!sql.empty()) sql += " UNION ALL ";
+        if (lines) {
+            sql += "SELECT g.ledger_date, COALESCE(li.quantity, 0) AS quantity,"
+                   " COALESCE(li.quantity * CAST(round(r.price * 100) AS INTEGER), 0) AS cents,"
+                   " COALESCE(r.category, '(No category)') AS category"
+                   " FROM " + schema + ".ledger_item li JOIN " + schema + ".general_ledger g ON g.general_ledger_id = li.ledger_id"
+                   " LEFT JOIN main.retail_item r ON r.item_id = li.item_id WHERE g.ledger_date IS NOT NULL";
+        } else {
+            sql += "SELECT g.ledger_date, COALESCE(CAST(round(g.amount * 100) AS INTEGER), 0) AS cents, g.employee_id,"
+                   " COALESCE(e.employee_name, '(Employee ' || g.employee_id || ')', '(No employee)') AS employee,"
+                   " COALESCE(g.payment_method, '(No payment method)') AS payment"
+                   " FROM " + schema + ".general_ledger g LEFT JOIN main.employee e ON e.employee_id = g.employee_id"
+                   " WHERE g.ledger_date IS NOT NULL";
+        }
+        if (schema != "main") {
+            sql += " AND NOT EXISTS (SELECT 1 FROM main.general_ledger m WHERE m.general_ledger_id = g.general_ledger_id)";
+        }
+    }
+    return "(" + sql + ")";
+}
+
+// Code of a dictionary entry, adding it the first time it is seen
+template <typename Key>
+static bool dictionaryCode(map<Key, uint16_t>& codes, vector<string>& labels, const Key& key, const string& label, uint16_t& code) {
+    auto found = codes.find(key);
+    if (found != codes.end()) {
+        code = found->second;
+        return true;
+    }
+    if (labels.size() > UINT16_MAX) return false;
+    code = static_cast<uint16_t>(labels.size());
+    codes[key] = code;
+    labels.push_back(label);
+    return true;
+}
+
+// Writing the whole sales history (archives included) to a columnar snapshot file for --analytics.
+// Both queries run in one read transaction, so sales and lines agree; the file is written beside the
+// target and renamed over it, so a reader never maps a half-written snapshot
+int writeSalesSnapshot(sqlite3* db, const char* path) {
+    auto start = chrono::steady_clock::now();
+    if (!attachArchives(db)) {
+        cerr << "❌ Attaching the archives failed: " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+    vector<int32_t> saleDay, saleCents, lineDay, lineCents, lineQuantity;
+    vector<uint16_t> saleEmployee, salePayment, lineCategory;
+    vector<string> dictionaries[SNAPSHOT_DICTIONARIES];
+    map<long long, uint16_t> employeeCodes;
+    map<string, uint16_t> paymentCodes, categoryCodes;
+    long long badDates = 0;
+    string error;
+    if (!runCachedStatement(db, "BEGIN;")) {
+        cerr << "❌ " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+    {
+        CachedStatement sales(db, ("SELECT * FROM " + allSalesSQL(db, false) + " ORDER BY ledger_date;").c_str());
+        int rc = SQLITE_ERROR;
+        while (sales && error.empty() && (rc = sqlite3_step(sales)) == SQLITE_ROW) {
+            int date = sqlite3_column_int(sales, 0);
+            sqlite3_int64 cents = sqlite3_column_int64(sales, 1);
+            long long employeeId = sqlite3_column_type(sales, 2) == SQLITE_NULL ? -1 : sqlite3_column_int64(sales, 2);
+            uint16_t employee = 0, payment = 0;
+            if (!validDate(date)) {
+                badDates++;
+                continue;
+            }
+            if (cents < INT32_MIN || cents > INT32_MAX) error = "a sale of " + to_string(cents) + " cents is too large";
+            else if (!dictionaryCode(employeeCodes, dictionaries[DICT_EMPLOYEE], employeeId, columnText(sales, 3), employee) ||
+                     !dictionaryCode(paymentCodes, dictionaries[DICT_PAYMENT], columnText(sales, 4), columnText(sales, 4), payment))
+                error = "more than 65536 employees or payment methods";
+            saleDay.push_back(dayNumber(date));
+            saleCents.push_back(static_cast<int32_t>(cents));
+            saleEmployee.push_back(employee);
+            salePayment.push_back(payment);
+        }
+        if (error.empty() && (!sales || rc != SQLITE_DONE)) error = sqlite3_errmsg(db);
+        CachedStatement lines(db, ("SELECT * FROM " + allSalesSQL(db, true) + " ORDER BY ledger_date;").c_str());
+        rc = SQLITE_ERROR;
+        while (lines && error.empty() && (rc = sqlite3_step(lines)) == SQLITE_ROW) {
+            int date = sqlite3_column_int(lines, 0);
+            sqlite3_int64 quantity = sqlite3_column_int64(lines, 1), cents = sqlite3_column_int64(lines, 2);
+            uint16_t category = 0;
+            if (!validDate(date)) continue; // Counted with their sale
+            if (cents < INT32_MIN || cents > INT32_MAX || quantity < INT32_MIN || quantity > INT32_MAX)
+                error = "a sale line of " + to_string(quantity) + " units, " + to_string(cents) + " cents is too large";
+            else if (!dictionaryCode(categoryCodes, dictionaries[DICT_CATEGORY], columnText(lines, 3), columnText(lines, 3), category))
+                error = "more than 65536 categories";
+            lineDay.push_back(dayNumber(date));
+            lineCents.push_back(static_cast<int32_t>(cents));
+            lineQuantity.push_back(static_cast<int32_t>(quantity));
+            lineCategory.push_back(category);
+        }
+        if (error.empty() && (!lines || rc != SQLITE_DONE)) error = sqlite3_errmsg(db);
+    }
+    runCachedStatement(db, "COMMIT;");
+    if (!error.empty()) {
+        cerr << "❌ Snapshot failed: " << error << endl;
+        return 1;
+    }
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.saleRows = saleDay.size();
+    header.lineRows = lineDay.size();
+    header.firstDay = saleDay.empty() ? 0 : saleDay.front();
+    header.lastDay = saleDay.empty() ? -1 : saleDay.back();
+    const void* data[SNAPSHOT_COLUMNS] = {saleDay.data(), saleCents.data(), saleEmployee.data(), salePayment.data(),
+                                          lineDay.data(), lineCents.data(), lineQuantity.data(), lineCategory.data()};
+    size_t bytes[SNAPSHOT_COLUMNS] = {saleDay.size() * 4, saleCents.size() * 4, saleEmployee.size() * 2, salePayment.size() * 2,
+                                      lineDay.size() * 4, lineCents.size() * 4, lineQuantity.size() * 4, lineCategory.size() * 2};
+    uint64_t offset = sizeof(SnapshotHeader);
+    for (int c = 0; c < SNAPSHOT_COLUMNS; c++) {
+        offset = (offset + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+        header.columnOffset[c] = offset;
+        offset += bytes[c];
+    }
+    string dictionaryBytes;
+    for (const vector<string>& labels : dictionaries) {
+        uint32_t count = static_cast<uint32_t>(labels.size());
+        dictionaryBytes.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const string& label : labels) {
+            uint32_t length = static_cast<uint32_t>(label.size());
+            dictionaryBytes.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            dictionaryBytes += label;
+        }
+    }
+    header.dictionaryOffset = offset;
+    header.dictionaryBytes = dictionaryBytes.size();
+
+    string temporary = string(path) + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        cerr << "❌ Cannot write " << temporary << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    static const char padding[SNAPSHOT_ALIGN] = {};
+    uint64_t written = sizeof(header);
+    for (int c = 0; ok && c < SNAPSHOT_COLUMNS; c++) {
+        ok = fwrite(padding, 1, header.columnOffset[c] - written, file) == header.columnOffset[c] - written &&
+             fwrite(data[c], 1, bytes[c], file) == bytes[c];
+        written = header.columnOffset[c] + bytes[c];
+    }
+    ok = ok && fwrite(dictionaryBytes.data(), 1, dictionaryBytes.size(), file) == dictionaryBytes.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), path) != 0) {
+        cerr << "❌ Writing " << path << " failed: " << strerror(errno) << endl;
+        remove(temporary.c_str());
+        return 1;
+    }
+    if (badDates > 0) cerr << "⚠️ Left out " << badDates << " sales with an invalid date" << endl;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "✅ Wrote " << header.saleRows << " sales and " << header.lineRows << " sale lines ("
+         << dictionaries[DICT_CATEGORY].size() << " categories, " << dictionaries[DICT_PAYMENT].size() << " payment methods, "
+         << dictionaries[DICT_EMPLOYEE].size() << " employees) to " << path << " in " << seconds << "s" << endl;
+    return 0;
+}
+
+SalesSnapshot::~SalesSnapshot() {
+    if (base) munmap(base, size);
+}
+
+bool SalesSnapshot::open(const char* path, string& error) {
+    int fd = ::open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        error = strerror(errno);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size < sizeof(SnapshotHeader)) {
+        close(fd);
+        error = "not a sales snapshot";
+        return false;
+    }
+    base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        error = strerror(errno);
+        return false;
+    }
+    const SnapshotHeader& head = header();
+    static const size_t widths[SNAPSHOT_COLUMNS] = {4, 4, 2, 2, 4, 4, 4, 2};
+    bool valid = memcmp(head.magic, SNAPSHOT_MAGIC, sizeof(head.magic)) == 0 && head.dictionaryOffset <= size &&
+                 head.dictionaryBytes <= size - head.dictionaryOffset;
+    for (int c = 0; valid && c < SNAPSHOT_COLUMNS; c++) {
+        uint64_t rows = c < LINE_DAY ? head.saleRows : head.lineRows;
+        valid = head.columnOffset[c] % SNAPSHOT_ALIGN == 0 && rows <= size / widths[c] && head.columnOffset[c] <= size - rows * widths[c];
+    }
+    // Dictionaries are small, so they are copied out; every code in the columns must have an entry
+    const char* at = static_cast<const char*>(base) + head.dictionaryOffset;
+    const char* end = at + head.dictionaryBytes;
+    for (int d = 0; valid && d < SNAPSHOT_DICTIONARIES; d++) {
+        uint32_t count, length;
+        valid = end - at >= 4;
+        if (valid) memcpy(&count, at, 4), at += 4;
+        for (uint32_t i = 0; valid && i < count; i++) {
+            valid = end - at >= 4;
+            if (valid) memcpy(&length, at, 4), at += 4;
+            valid = valid && static_cast<uint64_t>(end - at) >= length;
+            if (valid) dictionaries[d].emplace_back(at, length), at += length;
+        }
+    }
+    static const SnapshotColumn coded[SNAPSHOT_DICTIONARIES] = {SALE_EMPLOYEE, SALE_PAYMENT, LINE_CATEGORY};
+    for (int d = 0; valid && d < SNAPSHOT_DICTIONARIES; d++) {
+        const uint16_t* codes = column<uint16_t>(coded[d]);
+        uint64_t rows = coded[d] < LINE_DAY ? head.saleRows : head.lineRows;
+        uint16_t highest = 0;
+        for (uint64_t i = 0; i < rows; i++) highest = max(highest, codes[i]);
+        valid = rows == 0 || highest < dictionaries[d].size();
+    }
+    if (!valid) error = "not a sales snapshot, or damaged";
+    return valid;
+}
+
+bool parseAnalyticsGroup(const string& name, AnalyticsGroup& group) {
+    static const char* names[] = {"category", "employee", "payment", "day", "week", "month", "year"};
+    for (int g = BY_CATEGORY; g <= BY_YEAR; g++) {
+        if (name == names[g]) {
+            group = static_cast<AnalyticsGroup>(g);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rows per block of the analytics loops: the keys of a block stay in L1 between the two passes
+const size_t ANALYTICS_BLOCK = 2048;
+const size_t ANALYTICS_LANES = 4;            // Interleaved accumulators per group, so equal keys in a row do not stall
+const size_t ANALYTICS_MIN_ROWS = 1 << 16;   // Fewer rows per thread than this is not worth a thread
+
+// Keys of n rows from a code column: code * ANALYTICS_LANES + the row's position mod ANALYTICS_LANES.
+// SSE2 (x86-64) and NEON (Apple silicon) widen eight 16-bit codes per step; the tail and other targets
+// take the scalar loop
+static void analyticsCodeKeys(const uint16_t* code, size_t n, uint32_t* keys) {
+    static_assert(ANALYTICS_LANES == 4 && ANALYTICS_BLOCK % 8 == 0, "the vector loops assume 4 lanes, 8 rows a step");
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3), zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        __m128i codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(code + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i), _mm_add_epi32(_mm_slli_epi32(_mm_unpacklo_epi16(codes, zero), 2), lanes));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i + 4), _mm_add_epi32(_mm_slli_epi32(_mm_unpackhi_epi16(codes, zero), 2), lanes));
+    }
+#elif defined(__ARM_NEON)
+    static const uint32_t laneIndex[4] = {0, 1, 2, 3};
+    const uint32x4_t lanes = vld1q_u32(laneIndex);
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t codes = vld1q_u16(code + i);
+        vst1q_u32(keys + i, vaddq_u32(vshll_n_u16(vget_low_u16(codes), 2), lanes));
+        vst1q_u32(keys + i + 4, vaddq_u32(vshll_n_u16(vget_high_u16(codes), 2), lanes));
+    }
+#endif
+    for (; i < n; i++) keys[i] = static_cast<uint32_t>(code[i]) * ANALYTICS_LANES + i % ANALYTICS_LANES;
+}
+
+// Keys of n rows from a day column through bucketOfDay. The days are sorted, so when the first and last of
+// eight rows fall on the same day all eight share one bucket and the keys are stored as one broadcast;
+// otherwise, and without SSE2 or NEON, each row looks its bucket up
+static void analyticsDayKeys(const int32_t* day, const uint32_t* bucketOfDay, int32_t baseDay, size_t n, uint32_t* keys) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    for (; i + 8 <= n; i += 8) {
+        if (day[i] == day[i + 7]) {
+            __m128i key = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(bucketOfDay[day[i] - baseDay] * ANALYTICS_LANES)), lanes);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i), key);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i + 4), key);
+        } else {
+            for (size_t j = i; j < i + 8; j++) keys[j] = bucketOfDay[day[j] - baseDay] * ANALYTICS_LANES + j % ANALYTICS_LANES;
+        }
+    }
+#elif defined(__ARM_NEON)
+    static const uint32_t laneIndex[4] = {0, 1, 2, 3};
+    const uint32x4_t lanes = vld1q_u32(laneIndex);
+    for (; i + 8 <= n; i += 8) {
+        if (day[i] == day[i + 7]) {
+            uint32x4_t key = vaddq_u32(vdupq_n_u32(bucketOfDay[day[i] - baseDay] * ANALYTICS_LANES), lanes);
+            vst1q_u32(keys + i, key);
+            vst1q_u32(keys + i + 4, key);
+        } else {
+            for (size_t j = i; j < i + 8; j++) keys[j] = bucketOfDay[day[j] - baseDay] * ANALYTICS_LANES + j % ANALYTICS_LANES;
+        }
+    }
+#endif
+    for (; i < n; i++) keys[i] = bucketOfDay[day[i] - baseDay] * ANALYTICS_LANES + i % ANALYTICS_LANES;
+}
+
+// Totals rows [begin, end) into counts/cents, indexed by key * ANALYTICS_LANES + lane. The keys of a block
+// come from a code column, or from a day column through bucketOfDay, in a vector pass; the scatter pass
+// then only does loads and adds
+template <bool weighted>
+static void analyticsKernel(const uint16_t* code, const int32_t* day, const uint32_t* bucketOfDay, int32_t baseDay,
+                            const int32_t* cents, const int32_t* weight, size_t begin, size_t end,
+                            long long* counts, long long* totals) {
+    uint32_t keys[ANALYTICS_BLOCK];
+    for (size_t at = begin; at < end; at += ANALYTICS_BLOCK) {
+        size_t n = min(ANALYTICS_BLOCK, end - at);
+        if (code) analyticsCodeKeys(code + at, n, keys);
+        else analyticsDayKeys(day + at, bucketOfDay, baseDay, n, keys);
+        for (size_t i = 0; i < n; i++) {
+            counts[keys[i]] += weighted ? weight[at + i] : 1;
+            totals[keys[i]] += cents[at + i];
+        }
+    }
+}
+
+// Totals by group for the sales (lines, for categories) dated fromDate..toDate. The rows are in date order,
+// so the range is two binary searches; it is then split evenly across the cores, each with its own
+// accumulators, which are added up at the end. Date groups are listed in date order, the others by revenue
+vector<AnalyticsRow> snapshotAnalytics(const SalesSnapshot& snapshot, AnalyticsGroup group, int fromDate, int toDate) {
+    const SnapshotHeader& head = snapshot.header();
+    bool lines = group == BY_CATEGORY;
+    size_t rows = lines ? head.lineRows : head.saleRows;
+    const int32_t* day = snapshot.column<int32_t>(lines ? LINE_DAY : SALE_DAY);
+    int32_t fromDay = max(dayNumber(fromDate), head.firstDay), toDay = min(dayNumber(toDate), head.lastDay);
+    vector<AnalyticsRow> result;
+    if (rows == 0 || fromDay > toDay) return result;
+    size_t begin = lower_bound(day, day + rows, fromDay) - day;
+    size_t end = upper_bound(day, day + rows, toDay) - day;
+
+    const uint16_t* code = nullptr;
+    vector<uint32_t> bucketOfDay;
+    vector<string> labels;
+    if (group == BY_CATEGORY) code = snapshot.column<uint16_t>(LINE_CATEGORY), labels = snapshot.dictionary(DICT_CATEGORY);
+    else if (group == BY_EMPLOYEE) code = snapshot.column<uint16_t>(SALE_EMPLOYEE), labels = snapshot.dictionary(DICT_EMPLOYEE);
+    else if (group == BY_PAYMENT) code = snapshot.column<uint16_t>(SALE_PAYMENT), labels = snapshot.dictionary(DICT_PAYMENT);
+    else {
+        // Each day of the range maps to its bucket; the label is the bucket's value (Monday for weeks)
+        int last = -1;
+        for (int32_t d = fromDay; d <= toDay; d++) {
+            int date = dateOfDay(d);
+            int value = group == BY_DAY ? date : group == BY_WEEK ? dateOfDay(d - (d + 3) % 7) : group == BY_MONTH ? date / 100 : date / 10000;
+            if (value != last) labels.push_back(to_string(value));
+            last = value;
+            bucketOfDay.push_back(static_cast<uint32_t>(labels.size() - 1));
+        }
+    }
+    size_t slots = labels.size() * ANALYTICS_LANES;
+    const int32_t* cents = snapshot.column<int32_t>(lines ? LINE_CENTS : SALE_CENTS);
+    const int32_t* quantity = lines ? snapshot.column<int32_t>(LINE_QUANTITY) : nullptr;
+
+    size_t threads = max<size_t>(1, min<size_t>(thread::hardware_concurrency(), (end - begin) / ANALYTICS_MIN_ROWS));
+    vector<vector<long long>> counts(threads, vector<long long>(slots)), totals(threads, vector<long long>(slots));
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        size_t from = begin + (end - begin) * t / threads, to = begin + (end - begin) * (t + 1) / threads;
+        auto work = [&, t, from, to] {
+            if (quantity) analyticsKernel<true>(code, day, bucketOfDay.data(), fromDay, cents, quantity, from, to, counts[t].data(), totals[t].data());
+            else analyticsKernel<false>(code, day, bucketOfDay.data(), fromDay, cents, nullptr, from, to, counts[t].data(), totals[t].data());
+        };
+        if (t + 1 < threads) workers.emplace_back(work);
+        else work();
+    }
+    for (thread& worker : workers) worker.join();
+
+    for (size_t g = 0; g < labels.size(); g++) {
+        AnalyticsRow row;
+        row.label = labels[g];
+        for (size_t t = 0; t < threads; t++) {
+            for (size_t lane = 0; lane < ANALYTICS_LANES; lane++) {
+                row.count += counts[t][g * ANALYTICS_LANES + lane];
+                row.cents += totals[t][g * ANALYTICS_LANES + lane];
+            }
+        }
+        if (row.count != 0 || row.cents != 0) result.push_back(row);
+    }
+    if (code) {
+        stable_sort(result.begin(), result.end(), [](const AnalyticsRow& a, const AnalyticsRow& b) { return a.cents > b.cents; });
+    }
+    return result;
+}
+
+// The same totals straight from the tables, for --bench-analytics to time and check the snapshot against
+bool sqlAnalytics(sqlite3* db, AnalyticsGroup group, int fromDate, int toDate, vector<AnalyticsRow>& rows) {
+    static const char* keys[] = {
+        "category", "employee_id, employee", "payment", "ledger_date",
+        "CAST(strftime('%Y%m%d', printf('%04d-%02d-%02d', ledger_date / 10000, ledger_date / 100 % 100, ledger_date % 100),"
+        " '-6 days', 'weekday 1') AS INTEGER)",
+        "ledger_date / 100", "ledger_date / 10000"};
+    bool lines = group == BY_CATEGORY;
+    string label = group == BY_EMPLOYEE ? "employee" : keys[group];
+    string sql = "SELECT " + label + ", " + (lines ? "SUM(quantity)" : "COUNT(*)") + ", SUM(cents) FROM " +
+                 allSalesSQL(db, lines) + " WHERE ledger_date BETWEEN ?1 AND ?2 GROUP BY " + keys[group] +
+                 " HAVING " + (lines ? "SUM(quantity)" : "COUNT(*)") + " <> 0 OR SUM(cents) <> 0;";
+    Query<tuple<int, int>, tuple<string_view, sqlite3_int64, sqlite3_int64>> stmt(db, sql.c_str());
+    if (!stmt) return false;
+    rows.clear();
+    return stmt.run(fromDate, toDate, [&](string_view label, sqlite3_int64 count, sqlite3_int64 cents) {
+        rows.push_back({string(label), count, cents});
+    });
+}
+
+// Maps a snapshot and prints one --analytics report from it
+int runAnalytics(const char* path, const string& groupName, int fromDate, int toDate) {
+    AnalyticsGroup group;
+    if (!parseAnalyticsGroup(groupName, group)) {
+        cerr << "❌ Unknown group '" << groupName << "' (expected category, employee, payment, day, week, month or year)" << endl;
+        return 1;
+    }
+    if ((fromDate != 0 && !validDate(fromDate)) || (toDate != 0 && !validDate(toDate))) {
+        cerr << "❌ Dates must be YYYYMMDD" << endl;
+        return 1;
+    }
+    SalesSnapshot snapshot;
+    string error;
+    if (!snapshot.open(path, error)) {
+        cerr << "❌ Cannot open " << path << ": " << error << endl;
+        return 1;
+    }
+    if (fromDate == 0) fromDate = 10000101;
+    if (toDate == 0) toDate = 99991231;
+    auto start = chrono::steady_clock::now();
+    vector<AnalyticsRow> rows = snapshotAnalytics(snapshot, group, fromDate, toDate);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    long long count = 0, cents = 0;
+    char line[256];
+    for (const AnalyticsRow& row : rows) {
+        snprintf(line, sizeof(line), "%s | %s: %lld | Revenue: $%.2f", row.label.c_str(), group == BY_CATEGORY ? "Units" : "Sales",
+                 row.count, row.cents / 100.0);
+        cout << line << '\n';
+        count += row.count;
+        cents += row.cents;
+    }
+    snprintf(line, sizeof(line), "Total: %lld %s | Revenue: $%.2f (%.2f ms)", count, group == BY_CATEGORY ? "units" : "sales",
+             cents / 100.0, ms);
+    cout << line << endl;
+    return 0;
+}
+
+// Writes a fresh snapshot to path, then times each group over the whole history and over the last year both
+// ways (best of three) and checks that the snapshot gives exactly the SQL totals
+int benchmarkAnalytics(sqlite3* db, const char* path) {
+    if (writeSalesSnapshot(db, path) != 0) return 1;
+    SalesSnapshot snapshot;
+    string error;
+    if (!snapshot.open(path, error)) {
+        cerr << "❌ Cannot open " << path << ": " << error << endl;
+        return 1;
+    }
+    const int RUNS = 3;
+    int lastDate = snapshot.header().saleRows > 0 ? dateOfDay(snapshot.header().lastDay) : todayDate();
+    struct Range { const char* name; int fromDate, toDate; };
+    const Range ranges[] = {{"all", 10000101, 99991231}, {"last year", dateOfDay(dayNumber(lastDate) - 364), lastDate}};
+    static const char* names[] = {"category", "employee", "payment", "day", "week", "month", "year"};
+    cout << "Threads: " << max(1u, thread::hardware_concurrency()) << '\n';
+    char line[256];
+    snprintf(line, sizeof(line), "%-10s %-10s %12s %12s %9s  %s", "group", "range", "sqlite ms", "snapshot ms", "speedup", "totals");
+    cout << line << '\n';
+    bool allMatch = true;
+    for (const Range& range : ranges) {
+        for (int g = BY_CATEGORY; g <= BY_YEAR; g++) {
+            AnalyticsGroup group = static_cast<AnalyticsGroup>(g);
+            vector<AnalyticsRow> expected, actual;
+            double sqlMs = 1e18, snapshotMs = 1e18;
+            for (int run = 0; run < RUNS; run++) {
+                auto start = chrono::steady_clock::now();
+                if (!sqlAnalytics(db, group, range.fromDate, range.toDate, expected)) {
+                    cerr << "❌ Query failed: " << sqlite3_errmsg(db) << endl;
+                    return 1;
+                }
+                sqlMs = min(sqlMs, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+                start = chrono::steady_clock::now();
+                actual = snapshotAnalytics(snapshot, group, range.fromDate, range.toDate);
+                snapshotMs = min(snapshotMs, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+            }
+            auto byLabel = [](const AnalyticsRow& a, const AnalyticsRow& b) {
+                return tie(a.label, a.count, a.cents) < tie(b.label, b.count, b.cents);
+            };
+            sort(expected.begin(), expected.end(), byLabel);
+            sort(actual.begin(), actual.end(), byLabel);
+            bool match = expected.size() == actual.size() &&
+                         equal(expected.begin(), expected.end(), actual.begin(), [](const AnalyticsRow& a, const AnalyticsRow& b) {
+                             return a.label == b.label && a.count == b.count && a.cents == b.cents;
+                         });
+            allMatch = allMatch && match;
+            snprintf(line, sizeof(line), "%-10s %-10s %12.2f %12.3f %8.0fx  %s", names[g], range.name, sqlMs, snapshotMs,
+                     sqlMs / max(snapshotMs, 0.001), match ? "✅ same" : "❌ differ");
+            cout << line << '\n';
+        }
+    }
+    cout << (allMatch ? "✅ Snapshot totals match SQLite exactly" : "❌ Snapshot totals differ from SQLite") << endl;
+    return allMatch ? 0 : 1;
+}
+
+// A text column the way the list formatters read it before they took typed columns
+static const char* rawName(sqlite3_stmt* stmt, int column) {
+    const unsigned char* value = sqlite3_column_text(stmt, column);
+    return value ? reinterpret_cast<const char*>(value) : "(Unnamed)";
+}
+
+// Reading the two export joins and the medical records join three ways: stepping only, copying each row
+// into std::strings the way the hand-written loops did, and through Query with string_view columns.
+// Then paging through every list screen with the typed row formatters and the raw ones. The checksums must agree
+int benchmarkRowDecoding(sqlite3* db, int runs) {
+    if (!attachArchives(db)) {
+        cerr << "❌ Could not attach the history archives: " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+    using Text = string_view;
+    runs = max(runs, 1);
+    struct Timing { double nsPerRow = 1e18; long long rows = 0; unsigned long long checksum = 0; };
+    // Length and last byte, so the text is touched without the checksum costing more than the copy
+    auto hash = [](unsigned long long sum, Text text) {
+        return sum * 31 + text.size() * 257 + (text.empty() ? 0 : static_cast<unsigned char>(text.back()));
+    };
+    auto timed = [&](Timing& timing, const function<bool(long long&, unsigned long long&)>& read) {
+        long long rows = 0;
+        unsigned long long checksum = 0;
+        auto start = chrono::steady_clock::now();
+        if (!read(rows, checksum)) return false;
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        timing.nsPerRow = min(timing.nsPerRow, ns / max(rows, 1LL));
+        timing.rows = rows;
+        timing.checksum = checksum;
+        return true;
+    };
+    auto stepOnly = [&](const char* sql) {
+        return [&, sql](long long& rows, unsigned long long&) {
+            CachedStatement stmt(db, sql);
+            int rc;
+            while (stmt && (rc = sqlite3_step(stmt)) == SQLITE_ROW) rows++;
+            return stmt && rc == SQLITE_DONE;
+        };
+    };
+    auto text = [](sqlite3_stmt* stmt, int column) {
+        const unsigned char* value = sqlite3_column_text(stmt, column);
+        return value ? string(reinterpret_cast<const char*>(value)) : string();
+    };
+
+    static const char* MEDICAL_SQL = R"(
+        SELECT m.record_id, p.pet_name, m.date_of_last_update, m.vaccine_record, m.medical_history
+        FROM medical_record m LEFT JOIN pet p ON p.pet_id = m.pet_id ORDER BY m.record_id;
+    )";
+    struct Report { const char* name; const char* sql; function<bool(long long&, unsigned long long&)> copied, typed; };
+    Report reports[] = {
+        {"grooming", GROOMING_EXPORT_SQL,
+         [&](long long& rows, unsigned long long& checksum) {
+             struct Row { int appointmentId, date, time, clientId; string client; int groomerId; string groomer; };
+             CachedStatement stmt(db, GROOMING_EXPORT_SQL);
+             int rc;
+             while (stmt && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                 Row row{sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2), sqlite3_column_int(stmt, 3),
+                         text(stmt, 4), sqlite3_column_int(stmt, 5), text(stmt, 6)};
+                 checksum = hash(hash(checksum + row.appointmentId + row.date + row.time + row.clientId + row.groomerId, row.client), row.groomer);
+                 rows++;
+             }
+             return stmt && rc == SQLITE_DONE;
+         },
+         [&](long long& rows, unsigned long long& checksum) {
+             Query<tuple<>, tuple<int, int, int, int, Text, int, Text>> stmt(db, GROOMING_EXPORT_SQL);
+             return stmt && stmt.run([&](int appointmentId, int date, int time, int clientId, Text client, int groomerId, Text groomer) {
+                 checksum = hash(hash(checksum + appointmentId + date + time + clientId + groomerId, client), groomer);
+                 rows++;
+             });
+         }},
+        {"boarding", BOARDING_EXPORT_SQL,
+         [&](long long& rows, unsigned long long& checksum) {
+             struct Row { sqlite3_int64 reservationId; int clientId; string client; int petId; string pet; int checkIn, checkOut; double amount; };
+             CachedStatement stmt(db, BOARDING_EXPORT_SQL);
+             int rc;
+             while (stmt && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                 Row row{sqlite3_column_int64(stmt, 0), sqlite3_column_int(stmt, 1), text(stmt, 2), sqlite3_column_int(stmt, 3),
+                         text(stmt, 4), sqlite3_column_int(stmt, 5), sqlite3_column_int(stmt, 6), sqlite3_column_double(stmt, 7)};
+                 checksum = hash(hash(checksum + row.reservationId + row.clientId + row.petId + row.checkIn + row.checkOut +
+                                      static_cast<long long>(row.amount * 100), row.client), row.pet);
+                 rows++;
+             }
+             return stmt && rc == SQLITE_DONE;
+         },
+         [&](long long& rows, unsigned long long& checksum) {
+             Query<tuple<>, tuple<sqlite3_int64, int, Text, int, Text, int, int, double>> stmt(db, BOARDING_EXPORT_SQL);
+             return stmt && stmt.run([&](sqlite3_int64 reservationId, int clientId, Text client, int petId, Text pet, int checkIn, int checkOut, double amount) {
+                 checksum = hash(hash(checksum + reservationId + clientId + petId + checkIn + checkOut + static_cast<long long>(amount * 100), client), pet);
+                 rows++;
+             });
+         }},
+        {"medical", MEDICAL_SQL,
+         [&](long long& rows, unsigned long long& checksum) {
+             struct Row { int recordId; string pet, updated, vaccines, history; };
+             CachedStatement stmt(db, MEDICAL_SQL);
+             int rc;
+             while (stmt && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                 Row row{sqlite3_column_int(stmt, 0), text(stmt, 1), text(stmt, 2), text(stmt, 3), text(stmt, 4)};
+                 checksum = hash(hash(hash(hash(checksum + row.recordId, row.pet), row.updated), row.vaccines), row.history);
+                 rows++;
+             }
+             return stmt && rc == SQLITE_DONE;
+         },
+         [&](long long& rows, unsigned long long& checksum) {
+             Query<tuple<>, tuple<int, Text, Text, Text, Text>> stmt(db, MEDICAL_SQL);
+             return stmt && stmt.run([&](int recordId, Text pet, Text updated, Text vaccines, Text history) {
+                 checksum = hash(hash(hash(hash(checksum + recordId, pet), updated), vaccines), history);
+                 rows++;
+             });
+         }}};
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-10s %10s %12s %14s %12s  %s", "report", "rows", "step ns/row", "strings ns/row", "typed ns/row", "checksums");
+    cout << line << '\n';
+    bool allMatch = true;
+    for (Report& report : reports) {
+        Timing step, copied, typed;
+        for (int run = 0; run < runs; run++) { // Interleaved, so a slow patch of the machine hits all three alike
+            if (!timed(step, stepOnly(report.sql)) || !timed(copied, report.copied) || !timed(typed, report.typed)) {
+                cerr << "❌ Query failed: " << sqlite3_errmsg(db) << endl;
+                return 1;
+            }
+        }
+        bool match = copied.checksum == typed.checksum && copied.rows == typed.rows;
+        allMatch = allMatch && match;
+        snprintf(line, sizeof(line), "%-10s %10lld %12.1f %14.1f %12.1f  %s", report.name, typed.rows, step.nsPerRow, copied.nsPerRow,
+                 typed.nsPerRow, match ? "✅ same" : "❌ differ");
+        cout << line << '\n';
+    }
+
+    // The list screens as the menus and the server page them, every page through fetchPagedList, with the
+    // typed formatters and with the sqlite3_column_* ones they replaced; the formatted text must be the same
+    auto walkPages = [&](const PagedList& list, sqlite3_int64 scopeValue) {
+        return [&, scopeValue](long long& rows, unsigned long long& checksum) {
+            vector<PageRow> page;
+            vector<sqlite3_int64> cursor;
+            do {
+                if (!fetchPagedList(db, list, scopeValue, "", rows > 0 ? &cursor : nullptr, false, page)) return false;
+                for (const PageRow& row : page) checksum = checksum * 31 + std::hash<string>()(row.text);
+                rows += static_cast<long long>(page.size());
+                if (!page.empty()) cursor = page.back().key;
+            } while (page.size() == static_cast<size_t>(PAGE_SIZE));
+            return true;
+        };
+    };
+    struct ListRun { const PagedList* list; sqlite3_int64 scopeValue; void (*rawFormat)(sqlite3_stmt*, ostream&); };
+    sqlite3_int64 busiestClient = 0;
+    {
+        Query<tuple<>, tuple<sqlite3_int64>> busiest(db, "SELECT client_id FROM boarding_history GROUP BY client_id ORDER BY COUNT(*) DESC LIMIT 1;");
+        if (busiest) busiest.run([&](sqlite3_int64 clientId) { busiestClient = clientId; });
+    }
+    ListRun lists[] = {
+        {&CLIENT_PICK_LIST, 0, [](sqlite3_stmt* stmt, ostream& out) { out << sqlite3_column_int(stmt, 0) << ": " << rawName(stmt, 1); }},
+        {&PET_PICK_LIST, 0, [](sqlite3_stmt* stmt, ostream& out) { out << sqlite3_column_int(stmt, 0) << ": " << rawName(stmt, 1); }},
+        {&BOARDING_HISTORY_LIST, busiestClient, [](sqlite3_stmt* stmt, ostream& out) {
+             float amount = sqlite3_column_double(stmt, 3);
+             out << "Pet: " << rawName(stmt, 0) << " | Check-In: " << sqlite3_column_int(stmt, 1)
+                 << " | Check-Out: " << sqlite3_column_int(stmt, 2) << " | Amount: $" << amount;
+         }},
+        {&GROOMING_APPOINTMENTS_LIST, 0, [](sqlite3_stmt* stmt, ostream& out) {
+             out << "Appt ID: " << sqlite3_column_int(stmt, 0) << " | Client: " << rawName(stmt, 1) << " | Groomer: " << rawName(stmt, 2)
+                 << " | Date: " << sqlite3_column_int(stmt, 3) << " | Time: " << sqlite3_column_int(stmt, 4);
+         }}};
+    snprintf(line, sizeof(line), "\n%-22s %10s %14s %12s  %s", "list (every page)", "rows", "raw ns/row", "typed ns/row", "text");
+    cout << line << '\n';
+    for (const ListRun& run : lists) {
+        PagedList raw = *run.list;
+        raw.formatRow = run.rawFormat;
+        Timing copied, typed;
+        for (int i = 0; i < runs; i++) {
+            if (!timed(copied, walkPages(raw, run.scopeValue)) || !timed(typed, walkPages(*run.list, run.scopeValue))) {
+                cerr << "❌ Query failed: " << sqlite3_errmsg(db) << endl;
+                return 1;
+            }
+        }
+        bool match = copied.checksum == typed.checksum && copied.rows == typed.rows;
+        allMatch = allMatch && match;
+        snprintf(line, sizeof(line), "%-22s %10lld %14.1f %12.1f  %s", run.list->title, typed.rows, copied.nsPerRow, typed.nsPerRow,
+                 match ? "✅ same" : "❌ differ");
+        cout << line << '\n';
+    }
+    cout << (allMatch ? "✅ Typed rows match the copied rows" : "❌ Typed rows differ from the copied rows") << endl;
+    return allMatch ? 0 : 1;
+}
+
+// Set by SIGINT/SIGTERM to stop --serve (and --tail-changes --follow)
+atomic<bool> serverStopRequested(false);
+
+void requestServerStop(int) {
+    serverStopRequested = true;
+}
+
+// Opening a listening socket for "unix:<path>", "tcp:<port>" or "tcp:<host>:<port>", returns -1 on failure
+static int openListener(const string& address) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        string path = address.substr(5);
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) return -1;
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str()); // A stale socket file from an earlier run would block bind
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    if (address.compare(0, 4, "tcp:") == 0) {
+        string hostPort = address.substr(4), host = "127.0.0.1";
+        size_t colon = hostPort.rfind(':');
+        if (colon != string::npos) {
+            host = hostPort.substr(0, colon);
+            hostPort = hostPort.substr(colon + 1);
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(atoi(hostPort.c_str())));
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) return -1;
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int yes = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    return -1;
+}
+
+// Connecting to a server address in the same format as openListener, returns -1 on failure
+static int connectToServer(const string& address) {
+    int fd = -1;
+    if (address.compare(0, 5, "unix:") == 0) {
+        sockaddr_un addr{};
+        string path = address.substr(5);
+        if (path.size() >= sizeof(addr.sun_path)) return -1;
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) { close(fd); fd = -1; }
+    } else if (address.compare(0, 4, "tcp:") == 0) {
+        string hostPort = address.substr(4), host = "127.0.0.1";
+        size_t colon = hostPort.rfind(':');
+        if (colon != string::npos) {
+            host = hostPort.substr(0, colon);
+            hostPort = hostPort.substr(colon + 1);
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(atoi(hostPort.c_str())));
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) return -1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) { close(fd); fd = -1; }
+    }
+    return fd;
+}
+
+// Writing a whole buffer to a socket
+static bool sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, 0);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Taking one complete line off the front of buffer, without its "\r\n" or "\n"
+static bool takeLine(string& buffer, string& line) {
+    size_t newline = buffer.find('\n');
+    if (newline == string::npos) return false;
+    line = buffer.substr(0, newline);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    buffer.erase(0, newline + 1);
+    return true;
+}
+
+// Reading one '\n'-terminated line from a socket; buffer keeps whatever arrived after it
+static bool readLine(int fd, string& buffer, string& line) {
+    while (true) {
+        if (takeLine(buffer, line)) return true;
+        char chunk[4096];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+// Parsing a whole field as an int
+static bool parseIntField(const string& field, int& value) {
+    char* end;
+    long number = strtol(field.c_str(), &end, 10);
+    if (field.empty() || *end != '\0') return false;
+    value = static_cast<int>(number);
+    return true;
+}
+
+// Parsing a whole field as a number
+static bool parseDoubleField(const string& field, double& value) {
+    char* end;
+    double number = strtod(field.c_str(), &end);
+    if (field.empty() || *end != '\0') return false;
+    value = number;
+    return true;
+}
+
+// Sending one page of a list as ROW lines, with the cursor for the next page on the OK line
+static void writePageResponse(sqlite3* db, const PagedList& list, sqlite3_int64 scopeValue,
+                              const vector<string>& args, size_t firstKeyArg, ostream& out) {
+    vector<sqlite3_int64> cursor;
+    for (size_t i = firstKeyArg; i < args.size() && !args[i].empty(); i++) cursor.push_back(atoll(args[i].c_str()));
+    if (!cursor.empty() && cursor.size() != static_cast<size_t>(list.keyCount)) {
+        out << "ERR cursor needs " << list.keyCount << " key values\n";
+        return;
+    }
+    vector<PageRow> page;
+    if (!fetchPagedList(db, list, scopeValue, "", cursor.empty() ? nullptr : &cursor, false, page)) {
+        out << "ERR " << sqlite3_errmsg(db) << "\n";
+        return;
+    }
+    for (const PageRow& row : page) out << "ROW " << row.text << "\n";
+    out << "OK " << page.size();
+    if (page.size() == static_cast<size_t>(PAGE_SIZE)) {
+        out << " next=";
+        for (size_t k = 0; k < page.back().key.size(); k++) out << (k ? "," : "") << page.back().key[k];
+    }
+    out << "\n";
+}
+
+// Running one write command on the writer and returning its reply. The reply is only sent once the
+// write is committed, which with batched durability is when its whole group is
+static string serverWrite(KennelServer& server, const function<string(sqlite3*)>& write) {
+    string reply;
+    bool committed = server.writes->run([&](sqlite3* db) {
+        reply = write(db);
+        return reply.compare(0, 2, "OK") == 0;
+    });
+    if (!committed && reply.compare(0, 2, "OK") == 0) reply = "ERR the write could not be committed\n";
+    return reply;
+}
+
+// Running one protocol command. Reads use this worker's connection; writes take the single writer connection
+static string handleServerCommand(KennelServer& server, sqlite3* reader, const string& line) {
+    size_t space = line.find(' ');
+    string verb = line.substr(0, space);
+    string rest = space == string::npos ? "" : line.substr(space + 1);
+    vector<string> args;
+    splitCsvLine(rest, args);
+    ostringstream out;
+    int id = 0;
+
+    if (verb == "PING") {
+        out << "OK pong\n";
+    } else if (verb == "ADD_CLIENT" || verb == "UPDATE_CLIENT") {
+        bool update = verb == "UPDATE_CLIENT";
+        size_t base = update ? 1 : 0;
+        if (args.size() != base + 4 || (update && !parseIntField(args[0], id))) {
+            out << "ERR usage: " << verb << (update ? " id," : " ") << "name,phone,email,address\n";
+        } else {
+            ClientRecord client{args[base], args[base + 1], args[base + 2], args[base + 3]};
+            out << serverWrite(server, [&](sqlite3* db) {
+                sqlite3_int64 result = update ? updateClientRecord(db, id, client) : insertClient(db, client);
+                if (result < 0) return string("ERR ") + sqlite3_errmsg(db) + "\n";
+                if (update && result == 0) return "ERR no client with ID " + to_string(id) + "\n";
+                return "OK " + to_string(update ? id : result) + "\n";
+            });
+        }
+    } else if (verb == "ADD_PET" || verb == "UPDATE_PET") {
+        bool update = verb == "UPDATE_PET";
+        size_t base = update ? 1 : 0;
+        PetRecord pet;
+        if (args.size() == base + 8) {
+            pet.name = args[base];
+            pet.breed = args[base + 1];
+            pet.medicalCondition = args[base + 3];
+            pet.dietRestriction = args[base + 4];
+            pet.emergencyContact = args[base + 6];
+        }
+        if (args.size() != base + 8 || (update && !parseIntField(args[0], id)) || !parseIntField(args[base + 2], pet.age) ||
+            !parseIntField(args[base + 5], pet.friendly) || !parseIntField(args[base + 7], pet.clientId)) {
+            out << "ERR usage: " << verb << (update ? " id," : " ")
+                << "name,breed,age,medical_condition,diet_restriction,friendly,emergency_contact,client_id\n";
+        } else {
+            out << serverWrite(server, [&](sqlite3* db) {
+                sqlite3_int64 result = update ? updatePetRecord(db, id, pet) : insertPet(db, pet);
+                if (result < 0) return string("ERR ") + sqlite3_errmsg(db) + "\n";
+                if (update && result == 0) return "ERR no pet with ID " + to_string(id) + "\n";
+                return "OK " + to_string(update ? id : result) + "\n";
+            });
+        }
+    } else if (verb == "DELETE_CLIENT" || verb == "DELETE_PET") {
+        if (args.size() != 1 || !parseIntField(args[0], id)) {
+            out << "ERR usage: " << verb << " id\n";
+        } else {
+            out << serverWrite(server, [&](sqlite3* db) {
+                int result = verb == "DELETE_CLIENT" ? deleteClientRecord(db, id) : deletePetRecord(db, id);
+                if (result < 0) return string("ERR ") + sqlite3_errmsg(db) + "\n";
+                if (result == 0) return "ERR no record with ID " + to_string(id) + "\n";
+                return "OK " + to_string(id) + "\n";
+            });
+        }
+    } else if (verb == "SALE") {
+        Sale sale;
+        string error;
+        float total = 0.0;
+        if (!parseSaleLine(rest, sale, error)) {
+            out << "ERR " << error << "\n";
+        } else {
+            out << serverWrite(server, [&](sqlite3* db) {
+                if (!processSale(db, sale, total, error)) return "ERR " + error + "\n";
+                ostringstream reply;
+                reply << "OK " << total << "\n";
+                return reply.str();
+            });
+        }
+    } else if (verb == "BOARDING") {
+        if (args.empty() || !parseIntField(args[0], id)) out << "ERR usage: BOARDING client_id[,check_in,reservation_id]\n";
+        else if (!attachArchives(reader)) out << "ERR " << sqlite3_errmsg(reader) << "\n";
+        else writePageResponse(reader, BOARDING_HISTORY_LIST, id, args, 1, out);
+    } else if (verb == "GROOMING") {
+        writePageResponse(reader, GROOMING_APPOINTMENTS_LIST, 0, args, 0, out);
+    } else if (verb == "FREE_SLOTS") {
+        int fromDate = 0, fromTime = 0, count = 10;
+        if (args.size() > 3 || (args.size() > 0 && !parseIntField(args[0], fromDate)) ||
+            (args.size() > 1 && !parseIntField(args[1], fromTime)) || (args.size() > 2 && !parseIntField(args[2], count))) {
+            out << "ERR usage: FREE_SLOTS [date,time,count]\n";
+        } else {
+            bool loaded;
+            {
+                lock_guard<mutex> lock(server.writerMutex);
+                loaded = loadGroomingSchedule(server.writer, server.schedule);
+            }
+            if (!loaded) {
+                out << "ERR failed to load the grooming schedule\n";
+            } else {
+                vector<FreeSlot> slots = findFreeSlots(server.schedule, fromDate == 0 ? todayDate() : fromDate, fromTime, min(count, 200));
+                for (const FreeSlot& slot : slots) out << "ROW " << slot.date << "," << slot.time << "," << slot.groomerId << "\n";
+                out << "OK " << slots.size() << "\n";
+            }
+        }
+    } else if (verb == "BOOK_GROOMING") {
+        int clientId = 0, groomerId = 0, date = 0, time = 0;
+        if (args.size() != 4 || !parseIntField(args[0], clientId) || !parseIntField(args[1], groomerId) ||
+            !parseIntField(args[2], date) || !parseIntField(args[3], time)) {
+            out << "ERR usage: BOOK_GROOMING client_id,groomer_id,date,time\n";
+        } else {
+            string error;
+            out << serverWrite(server, [&](sqlite3* db) {
+                sqlite3_int64 appointmentId = bookGroomingAppointment(db, server.schedule, clientId, groomerId, date, time, error);
+                return appointmentId < 0 ? "ERR " + error + "\n" : "OK " + to_string(appointmentId) + "\n";
+            });
+        }
+    } else if (verb == "PROFILE") {
+        shared_ptr<const ClientProfile> profile;
+        if (args.size() != 1 || !parseIntField(args[0], id)) {
+            out << "ERR usage: PROFILE client_id\n";
+        } else if (!fetchClientProfile(reader, id, profile)) {
+            out << "ERR " << sqlite3_errmsg(reader) << "\n";
+        } else if (!profile) {
+            out << "ERR no record with ID " << id << "\n";
+        } else {
+            ostringstream rows;
+            writeClientProfile(*profile, rows, "ROW ");
+            string text = rows.str();
+            out << text << "OK " << count(text.begin(), text.end(), '\n') << "\n";
+        }
+    } else if (verb == "OCCUPANCY") {
+        int fromDate = 0, nightCount = 90;
+        if (args.size() > 2 || (args.size() > 0 && !parseIntField(args[0], fromDate)) ||
+            (args.size() > 1 && !parseIntField(args[1], nightCount))) {
+            out << "ERR usage: OCCUPANCY [date,nights]\n";
+        } else {
+            bool synced;
+            {
+                lock_guard<mutex> lock(server.writerMutex);
+                synced = syncBoardingOccupancy(server.writer, server.occupancy);
+            }
+            if (!synced) {
+                out << "ERR failed to load boarding reservations\n";
+            } else {
+                vector<int> counts;
+                int day = dayNumber(nightlyOccupancy(server.occupancy, fromDate == 0 ? todayDate() : fromDate,
+                                                     min(max(nightCount, 0), MAX_BOARDING_NIGHTS), counts));
+                for (size_t night = 0; night < counts.size(); night++) {
+                    out << "ROW " << dateOfDay(day + static_cast<int>(night)) << "," << counts[night] << "\n";
+                }
+                out << "OK " << counts.size() << "\n";
+            }
+        }
+    } else if (verb == "BOOK_BOARDING") {
+        int clientId = 0, petId = 0, checkIn = 0, checkOut = 0;
+        double amount = 0;
+        if (args.size() != 5 || !parseIntField(args[0], clientId) || !parseIntField(args[1], petId) ||
+            !parseIntField(args[2], checkIn) || !parseIntField(args[3], checkOut) || !parseDoubleField(args[4], amount)) {
+            out << "ERR usage: BOOK_BOARDING client_id,pet_id,check_in,check_out,amount\n";
+        } else {
+            string error;
+            out << serverWrite(server, [&](sqlite3* db) {
+                sqlite3_int64 reservationId = bookBoardingReservation(db, server.occupancy, clientId, petId,
+                                                                      checkIn, checkOut, amount, error);
+                return reservationId < 0 ? "ERR " + error + "\n" : "OK " + to_string(reservationId) + "\n";
+            });
+        }
+    } else if (verb == "SEARCH") {
+        ostringstream results;
+        int matches = writeSearchResults(reader, rest, results);
+        if (matches < 0) {
+            out << "ERR nothing to search for\n";
+        } else {
+            string resultLine;
+            istringstream lines(results.str());
+            while (getline(lines, resultLine)) {
+                if (!resultLine.empty()) out << "ROW " << resultLine << "\n";
+            }
+            out << "OK " << matches << "\n";
+        }
+    } else {
+        out << "ERR unknown command '" << verb << "'\n";
+    }
+    return out.str();
+}
+
+// Reading what a terminal has sent and answering every complete command in it. Returns false once the
+// terminal has hung up or quit. The accept loop saw the socket readable, so this does not wait on it
+static bool serveReadyCommands(KennelServer& server, sqlite3* reader, ServerConnection& connection) {
+    char chunk[4096];
+    ssize_t n = recv(connection.fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) return false;
+    if (n > 0) connection.buffer.append(chunk, static_cast<size_t>(n));
+    string line;
+    while (takeLine(connection.buffer, line)) {
+        if (line.empty()) continue;
+        if (line == "QUIT") return false;
+        if (!sendAll(connection.fd, handleServerCommand(server, reader, line))) return false;
+    }
+    return true;
+}
+
+// Worker thread: one read-only connection, answering whichever terminal has a command waiting
+static void serverWorker(KennelServer& server) {
+    sqlite3* reader = nullptr;
+    if (sqlite3_open_v2(server.dbPath.c_str(), &reader, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        cerr << "❌ Worker failed to open database: " << sqlite3_errmsg(reader) << endl;
+        sqlite3_close(reader);
+        return;
+    }
+    sqlite3_busy_timeout(reader, 5000);
+    applyTuningProfile(reader);
+    enableProfiling(reader);
+
+    while (true) {
+        ServerConnection connection;
+        {
+            unique_lock<mutex> lock(server.queueMutex);
+            server.queueReady.wait(lock, [&] { return server.stopping || !server.readyConnections.empty(); });
+            if (server.stopping) break;
+            connection = move(server.readyConnections.front());
+            server.readyConnections.pop_front();
+        }
+        if (!serveReadyCommands(server, reader, connection)) {
+            close(connection.fd);
+            continue;
+        }
+        {
+            lock_guard<mutex> lock(server.queueMutex);
+            server.servedConnections.push_back(move(connection));
+        }
+        char wake = 1;
+        if (write(server.wakeFds[1], &wake, 1) < 0) {} // A full pipe already has the loop awake
+    }
+    clearStatementCache(reader);
+    sqlite3_close(reader);
+}
+
+// Owning the database and serving terminals over a socket until stop is set.
+// WAL lets the worker readers run alongside the single writer connection
+int runServer(const char* dbPath, const string& address, int workers, atomic<bool>& stop, Durability durability, int backupMinutes) {
+    KennelServer server;
+    server.dbPath = dbPath;
+    if (sqlite3_open(dbPath, &server.writer) != SQLITE_OK) {
+        cerr << "Failed to open database: " << sqlite3_errmsg(server.writer) << endl;
+        sqlite3_close(server.writer);
+        return 1;
+    }
+    sqlite3_busy_timeout(server.writer, 5000);
+    applyTuningProfile(server.writer);
+    enableProfiling(server.writer);
+    if (!runMigrations(server.writer) ||
+        sqlite3_exec(server.writer, "PRAGMA journal_mode = WAL; PRAGMA wal_autocheckpoint = 0;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "❌ Failed to prepare database: " << sqlite3_errmsg(server.writer) << endl;
+        clearStatementCache(server.writer);
+        sqlite3_close(server.writer);
+        return 1;
+    }
+
+    int listener = openListener(address);
+    if (listener < 0) {
+        cerr << "❌ Failed to listen on " << address << ": " << strerror(errno) << endl;
+        clearStatementCache(server.writer);
+        sqlite3_close(server.writer);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN); // A terminal hanging up mid-response must not kill the server
+    if (pipe(server.wakeFds) != 0) {
+        cerr << "❌ Failed to create the worker pipe: " << strerror(errno) << endl;
+        close(listener);
+        clearStatementCache(server.writer);
+        sqlite3_close(server.writer);
+        return 1;
+    }
+    fcntl(server.wakeFds[0], F_SETFL, O_NONBLOCK);
+    fcntl(server.wakeFds[1], F_SETFL, O_NONBLOCK);
+
+    WalCheckpointer checkpointer(dbPath);
+    ChangeLog changeLog(string(dbPath) + CHANGE_LOG_SUFFIX);
+    changeLog.attach(server.writer);
+    server.writes = make_unique<GroupCommitWriter>(server.writer, server.writerMutex, durability);
+    unique_ptr<BackgroundBackup> backup;
+    if (backupMinutes > 0) {
+        backup = make_unique<BackgroundBackup>(server.writer, server.writerMutex, string(dbPath) + BACKUP_SUFFIX,
+                                               chrono::minutes(backupMinutes), &cout);
+    }
+    vector<thread> pool;
+    for (int i = 0; i < max(1, workers); i++) pool.emplace_back(serverWorker, ref(server));
+    cout << "Serving " << dbPath << " on " << address << " with " << pool.size() << " workers, "
+         << durabilityName(durability) << " durability." << endl;
+
+    // Accept loop: watches the listener and every idle terminal, and queues a terminal for the workers
+    // as soon as it sends something. Polls with a timeout so a stop request is noticed
+    vector<ServerConnection> idle;
+    vector<pollfd> waitFor;
+    while (!stop) {
+        waitFor.assign({{listener, POLLIN, 0}, {server.wakeFds[0], POLLIN, 0}});
+        for (const ServerConnection& connection : idle) waitFor.push_back({connection.fd, POLLIN, 0});
+        if (poll(waitFor.data(), waitFor.size(), 200) <= 0) continue;
+        vector<ServerConnection> ready;
+        for (size_t i = idle.size(); i-- > 0;) {
+            if (!waitFor[i + 2].revents) continue;
+            ready.push_back(move(idle[i]));
+            idle.erase(idle.begin() + i);
+        }
+        if (waitFor[1].revents) {
+            char drain[256];
+            while (read(server.wakeFds[0], drain, sizeof(drain)) > 0) {}
+        }
+        if (waitFor[0].revents) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) idle.push_back({fd, ""});
+        }
+        lock_guard<mutex> lock(server.queueMutex);
+        for (ServerConnection& connection : server.servedConnections) idle.push_back(move(connection));
+        server.servedConnections.clear();
+        for (ServerConnection& connection : ready) {
+            server.readyConnections.push_back(move(connection));
+            server.queueReady.notify_one();
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(server.queueMutex);
+        server.stopping = true;
+    }
+    server.queueReady.notify_all();
+    for (thread& worker : pool) worker.join();
+    for (const ServerConnection& connection : idle) close(connection.fd);
+    for (const ServerConnection& connection : server.readyConnections) close(connection.fd);
+    for (const ServerConnection& connection : server.servedConnections) close(connection.fd);
+    close(server.wakeFds[0]);
+    close(server.wakeFds[1]);
+    server.writes->shutdown(); // Nothing queued is lost on the way out
+    backup.reset();
+    close(listener);
+    if (address.compare(0, 5, "unix:") == 0) unlink(address.substr(5).c_str());
+
+    changeLog.detach(server.writer);
+    clearStatementCache(server.writer);
+    sqlite3_close(server.writer);
+    cout << "Server stopped." << endl;
+    return 0;
+}
+
+// Sending a command and collecting the reply up to its OK/ERR line
+static bool sendServerCommand(int fd, string& buffer, const string& command, string& status) {
+    if (!sendAll(fd, command + "\n")) return false;
+    string line;
+    while (readLine(fd, buffer, line)) {
+        if (line.compare(0, 2, "OK") == 0 || line.compare(0, 3, "ERR") == 0) {
+            status = line;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Load test: an in-process server on a scratch copy, driven by 1, 2, 4 ... maxClients terminals.
+// Each terminal runs a front-desk mix of 40% boarding history, 30% grooming page, 30% sales
+int runLoadTest(const char* dbPath, int maxClients, double secondsPerStep, Durability durability) {
+    const char* scratchPath = "kennel_loadtest.db";
+    const string address = "unix:kennel_loadtest.sock";
+    sqlite3* source;
+    if (sqlite3_open_v2(dbPath, &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        cerr << "Failed to open database: " << sqlite3_errmsg(source) << endl;
+        sqlite3_close(source);
+        return 1;
+    }
+    remove(scratchPath);
+    string copySQL = string("VACUUM INTO '") + scratchPath + "';";
+    bool copied = sqlite3_exec(source, copySQL.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+    sqlite3_close(source);
+    sqlite3* scratch;
+    if (!copied || sqlite3_open(scratchPath, &scratch) != SQLITE_OK) {
+        cerr << "❌ Failed to create " << scratchPath << endl;
+        return 1;
+    }
+    sqlite3_exec(scratch, "UPDATE retail_item SET stock_level = 1000000000;", nullptr, nullptr, nullptr);
+    int clientCount = 1;
+    {
+        CachedStatement count(scratch, "SELECT MAX(client_id) FROM client;");
+        if (count && sqlite3_step(count) == SQLITE_ROW) clientCount = max(1, sqlite3_column_int(count, 0));
+    }
+    clearStatementCache(scratch);
+    sqlite3_close(scratch);
+
+    atomic<bool> stop(false);
+    thread serverThread([&] { runServer(scratchPath, address, maxClients, stop, durability); });
+    this_thread::sleep_for(chrono::milliseconds(300)); // Letting the server bind
+
+    cout << "\nClients | Ops/sec | Avg latency (ms) | Errors" << endl;
+    for (int clients = 1; clients <= maxClients; clients = (clients < maxClients && clients * 2 > maxClients) ? maxClients : clients * 2) {
+        atomic<long long> ops(0), errors(0), totalMicros(0);
+        auto deadline = chrono::steady_clock::now() + chrono::duration<double>(secondsPerStep);
+        vector<thread> terminals;
+        for (int t = 0; t < clients; t++) {
+            terminals.emplace_back([&, t] {
+                int fd = connectToServer(address);
+                if (fd < 0) { errors++; return; }
+                mt19937 random(1234 + t);
+                string buffer, status;
+                while (chrono::steady_clock::now() < deadline) {
+                    int pick = static_cast<int>(random() % 10);
+                    string command;
+                    if (pick < 4) command = "BOARDING " + to_string(1 + random() % clientCount);
+                    else if (pick < 7) command = "GROOMING";
+                    else command = "SALE " + to_string(1 + random() % clientCount) + ",1,20240101,1200,Card,1:1;2:1";
+                    auto start = chrono::steady_clock::now();
+                    if (!sendServerCommand(fd, buffer, command, status)) { errors++; break; }
+                    totalMicros += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+                    if (status.compare(0, 2, "OK") == 0) ops++;
+                    else errors++;
+                }
+                sendAll(fd, "QUIT\n");
+                close(fd);
+            });
+        }
+        for (thread& terminal : terminals) terminal.join();
+        long long done = ops + errors;
+        printf("%7d | %7.0f | %16.3f | %lld\n", clients, ops / secondsPerStep,
+               done ? totalMicros / 1000.0 / done : 0.0, static_cast<long long>(errors));
+    }
+
+    stop = true;
+    serverThread.join();
+    remove(scratchPath);
+    remove((string(scratchPath) + "-wal").c_str());
+    remove((string(scratchPath) + "-shm").c_str());
+    remove((string(scratchPath) + CHANGE_LOG_SUFFIX).c_str());
+    return 0;
+}
+
+// Runs one timed pass of sales against an open scratch database, returns sales per second
+static double timeSalePass(sqlite3* db, int saleCount) {
+    Sale sale{1, 1, 20240101, 1200, "Card", {{1, 1}, {2, 2}, {3, 1}}};
+    string error;
+    float total = 0.0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < saleCount; i++) {
+        if (!processSale(db, sale, total, error)) {
+            cerr << "❌ Benchmark sale failed: " << error << endl;
+            return 0.0;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return saleCount / seconds;
+}
+
+// Benchmark of sale throughput with the statement cache off (before) and on (after)
+int benchmarkSales(const char* dbPath, int saleCount) {
+    const char* benchPath = "kennel_bench.db";
+    sqlite3* source;
+    if (sqlite3_open_v2(dbPath, &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        cerr << "Failed to open database: " << sqlite3_errmsg(source) << endl;
+        sqlite3_close(source);
+        return 1;
+    }
+    // Working on a scratch copy so the real data is never touched
+    remove(benchPath);
+    string copySQL = string("VACUUM INTO '") + benchPath + "';";
+    if (sqlite3_exec(source, copySQL.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "Failed to copy database: " << sqlite3_errmsg(source) << endl;
+        sqlite3_close(source);
+        return 1;
+    }
+    sqlite3_close(source);
+
+    sqlite3* db;
+    if (sqlite3_open(benchPath, &db) != SQLITE_OK) {
+        cerr << "Failed to open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    if (!runMigrations(db)) {
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return 1;
+    }
+    // Plenty of stock for every pass, WAL like the menu and the server, and no fsync so statement overhead is what gets measured
+    sqlite3_exec(db, "UPDATE retail_item SET stock_level = 1000000000; PRAGMA journal_mode = WAL; PRAGMA synchronous = OFF;", nullptr, nullptr, nullptr);
+
+    cout << "Benchmarking " << saleCount << " sales of 3 items each on " << benchPath << endl;
+    StatementCache& cache = statementCacheFor(db);
+    cache.enabled = false;
+    double before = timeSalePass(db, saleCount);
+    cout << "Without statement cache: " << before << " sales/sec" << endl;
+
+    cache.enabled = true;
+    cache.hits = cache.misses = 0;
+    double after = timeSalePass(db, saleCount);
+    cout << "With statement cache:    " << after << " sales/sec";
+    if (before > 0) cout << " (" << after / before << "x)";
+    cout << endl;
+    printStatementCacheStats(db);
+
+    // The same sales inside one outer transaction: what is left once the per-sale commit is taken out
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    double statementsOnly = timeSalePass(db, saleCount);
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    if (after > 0 && statementsOnly > 0) {
+        char line[160];
+        snprintf(line, sizeof(line), "Per sale: %.1f µs = %.1f µs statements and rollup triggers + %.1f µs commit",
+                 1e6 / after, 1e6 / statementsOnly, 1e6 / after - 1e6 / statementsOnly);
+        cout << line << endl;
+    }
+
+    string logPath = string(benchPath) + CHANGE_LOG_SUFFIX;
+    remove(logPath.c_str());
+    {
+        // Alternating short passes with the hooks off and on, best of each, so drift between passes cancels out
+        ChangeLog changeLog(logPath);
+        double plain = 0, captured = 0;
+        for (int round = 0; round < 5; round++) {
+            plain = max(plain, timeSalePass(db, max(1, saleCount / 5)));
+            changeLog.attach(db);
+            captured = max(captured, timeSalePass(db, max(1, saleCount / 5)));
+            changeLog.detach(db);
+        }
+        cout << "Without change capture:  " << plain << " sales/sec" << endl;
+        cout << "With change capture:     " << captured << " sales/sec";
+        if (plain > 0) cout << " (" << showpos << 100 * (captured - plain) / plain << noshowpos << "%)";
+        cout << endl;
+        changeLog.printStats(cout);
+    }
+    remove(logPath.c_str());
+
+    clearStatementCache(db);
+    sqlite3_close(db);
+    remove(benchPath);
+    return 0;
+}
+
+// Word lists for generated datasets
+static const char* const GEN_FIRST_NAMES[] = {
+    "James", "Mary", "Robert", "Patricia", "John", "Jennifer", "Michael", "Linda", "David", "Elizabeth",
+    "William", "Barbara", "Richard", "Susan", "Joseph", "Jessica", "Thomas", "Sarah", "Carlos", "Karen",
+    "Daniel", "Lisa", "Matthew", "Nancy", "Anthony", "Betty", "Mark", "Sandra", "Priya", "Ashley"};
+static const char* const GEN_LAST_NAMES[] = {
+    "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller", "Davis", "Rodriguez", "Martinez",
+    "Hernandez", "Lopez", "Gonzalez", "Wilson", "Anderson", "Thomas", "Taylor", "Moore", "Jackson", "Martin",
+    "Lee", "Perez", "Thompson", "White", "Harris", "Sanchez", "Clark", "Ramirez", "Lewis", "Robinson"};
+static const char* const GEN_STREETS[] = {
+    "Main St", "Oak Ave", "Pine Rd", "Maple Dr", "Cedar Ln", "Elm St", "Washington Blvd", "Lake Rd",
+    "Hill St", "Park Ave", "River Rd", "Sunset Dr"};
+static const char* const GEN_PET_NAMES[] = {
+    "Buddy", "Max", "Bella", "Lucy", "Charlie", "Daisy", "Rocky", "Molly", "Bailey", "Sadie",
+    "Whiskers", "Luna", "Oliver", "Milo", "Coco", "Spike", "Ginger", "Duke", "Rosie", "Bear",
+    "Zoe", "Toby", "Lola", "Jack", "Penny", "Oscar", "Ruby", "Leo", "Nala", "Simba"};
+static const char* const GEN_BREEDS[] = {
+    "Golden Retriever", "Labrador Retriever", "German Shepherd", "Bulldog", "Beagle", "Poodle", "Husky",
+    "Dachshund", "Boxer", "Shih Tzu", "Siamese", "Persian", "Maine Coon", "Ragdoll", "Bengal", "Tabby",
+    "Border Collie", "Corgi", "Chihuahua", "Mixed"};
+static const char* const GEN_CONDITIONS[] = {
+    "None", "None", "None", "Allergy to Fish", "Hip Dysplasia", "Diabetes", "Arthritis", "Heart Murmur"};
+static const char* const GEN_DIETS[] = {"None", "None", "Grain-Free", "Low fat", "Prescription", "Raw"};
+static const char* const GEN_VACCINES[] = {
+    "Rabies", "Rabies, Distemper", "FVRCP, Rabies", "Rabies, Bordetella", "DHPP, Rabies, Leptospirosis"};
+static const char* const GEN_HISTORIES[] = {
+    "Healthy", "Regular checkup needed", "Mild arthritis observed", "Recovering from surgery",
+    "Dental cleaning recommended", "Ear infection treated", "Weight management plan", "Skin allergy flare-up"};
+static const char* const GEN_SCHEDULES[] = {"Mon-Fri 9-5", "Tue-Sat 10-6", "Mon, Wed, Fri 8-4", "Weekends 9-3"};
+static const char* const GEN_JOB_TITLES[] = {"Manager", "Clerk", "Assistant", "Kennel Technician", "Receptionist"};
+static const char* const GEN_PAYMENT_METHODS[] = {"Cash", "Credit", "Debit", "Card"};
+static const struct { const char* name; const char* category; double price; } GEN_RETAIL_ITEMS[] = {
+    {"Dog Food", "Pet Supplies", 25.99}, {"Cat Litter", "Pet Supplies", 15.49}, {"Leash", "Accessories", 10.00},
+    {"Collar", "Accessories", 8.50}, {"Chew Toy", "Toys", 5.99}, {"Cat Food", "Pet Supplies", 19.99},
+    {"Shampoo", "Grooming", 12.75}, {"Brush", "Grooming", 9.25}, {"Dog Bed", "Accessories", 45.00},
+    {"Treats", "Pet Supplies", 6.49}, {"Flea Collar", "Health", 18.00}, {"Water Bowl", "Accessories", 7.99}};
+
+const int GENERATED_DAYS = 7 * 365;                 // Generated dates run from 2019 through 2025
+const long long GENERATE_ROWS_PER_COMMIT = 200000;  // Keeps FTS pending data and the page cache bounded
+
+template <size_t N>
+static const char* pickWord(mt19937& random, const char* const (&words)[N]) {
+    return words[random() % N];
+}
+
+// Day number since 2019-01-01 -> YYYYMMDD, ignoring leap days
+static int generatedDate(long long day) {
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int year = 2019 + static_cast<int>(day / 365);
+    int rest = static_cast<int>(day % 365), month = 0;
+    while (rest >= monthDays[month]) rest -= monthDays[month++];
+    return year * 10000 + (month + 1) * 100 + rest + 1;
+}
+
+// Opening hours 8:00-17:45 in quarter hours, as HHMM
+static int generatedTime(mt19937& random) {
+    return static_cast<int>(8 + random() % 10) * 100 + static_cast<int>(random() % 4) * 15;
+}
+
+// Steps and resets one generated row, committing every GENERATE_ROWS_PER_COMMIT rows
+static bool stepGeneratedRow(sqlite3* db, sqlite3_stmt* stmt, long long& rows) {
+    bool stepped = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_reset(stmt);
+    if (!stepped) {
+        cerr << "❌ Insert failed: " << sqlite3_errmsg(db) << endl;
+        return false;
+    }
+    if (++rows % GENERATE_ROWS_PER_COMMIT == 0) {
+        return runCachedStatement(db, "COMMIT;") && runCachedStatement(db, "BEGIN;");
+    }
+    return true;
+}
+
+// Reads one volume option such as ledger=5000000 or seed=7
+bool parseDatasetOption(const string& option, DatasetSize& size) {
+    size_t equals = option.find('=');
+    if (equals == string::npos) return false;
+    string name = option.substr(0, equals);
+    const char* text = option.c_str() + equals + 1;
+    char* end;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || value < 0) return false;
+    if (name == "seed") {
+        size.seed = static_cast<unsigned>(value);
+        return true;
+    }
+    const pair<const char*, long long DatasetSize::*> fields[] = {
+        {"clients", &DatasetSize::clients}, {"pets", &DatasetSize::pets}, {"groomers", &DatasetSize::groomers},
+        {"employees", &DatasetSize::employees}, {"items", &DatasetSize::retailItems},
+        {"grooming", &DatasetSize::groomingAppointments}, {"boarding", &DatasetSize::boardingReservations},
+        {"medical", &DatasetSize::medicalRecords}, {"ledger", &DatasetSize::ledgerRows}};
+    for (const auto& field : fields) {
+        if (name == field.first) {
+            size.*field.second = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Builds a new database at outPath with the schema of templatePath and generated, referentially
+// consistent rows in every table. Volumes left at -1 are scaled from the ledger count
+int generateDataset(const char* templatePath, const char* outPath, const DatasetSize& requested) {
+    DatasetSize size = requested;
+    if (size.clients < 0) size.clients = max(10LL, size.ledgerRows / 20);
+    if (size.pets < 0) size.pets = size.clients * 3 / 2;
+    if (size.groomers < 0) size.groomers = 10;
+    if (size.employees < 0) size.employees = 25;
+    if (size.retailItems < 0) size.retailItems = 200;
+    if (size.groomingAppointments < 0) size.groomingAppointments = size.clients * 2;
+    if (size.boardingReservations < 0) size.boardingReservations = size.clients;
+    if (size.medicalRecords < 0) size.medicalRecords = size.pets;
+    if (size.clients < 1 || size.groomers < 1 || size.employees < 1 || size.retailItems < 1 ||
+        (size.pets < 1 && (size.boardingReservations > 0 || size.medicalRecords > 0))) {
+        cerr << "❌ clients, groomers, employees and items must be at least 1, and pets too when there is boarding or medical data" << endl;
+        return 1;
+    }
+    if (FILE* existing = fopen(outPath, "rb")) { // Never overwriting, so the real database can't be clobbered by a typo
+        fclose(existing);
+        cerr << "❌ " << outPath << " already exists; remove it or pick another name" << endl;
+        return 1;
+    }
+
+    // Copying the schema (and the few template rows, deleted below) with VACUUM INTO
+    sqlite3* source;
+    if (sqlite3_open_v2(templatePath, &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        cerr << "Failed to open database: " << sqlite3_errmsg(source) << endl;
+        sqlite3_close(source);
+        return 1;
+    }
+    string copySQL = string("VACUUM INTO '") + outPath + "';";
+    bool copied = sqlite3_exec(source, copySQL.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!copied) cerr << "Failed to copy schema: " << sqlite3_errmsg(source) << endl;
+    sqlite3_close(source);
+    sqlite3* db;
+    if (!copied || sqlite3_open(outPath, &db) != SQLITE_OK) {
+        cerr << "❌ Failed to create " << outPath << endl;
+        return 1;
+    }
+    if (!runMigrations(db)) {
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return 1;
+    }
+    // A fresh scratch file, so no rollback journal or fsync: a crash just means generating again
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, R"(
+            PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; PRAGMA cache_size = -262144;
+            BEGIN;
+            DELETE FROM ledger_item; DELETE FROM general_ledger; DELETE FROM medical_record;
+            DELETE FROM boarding_reservation; DELETE FROM grooming_appointment; DELETE FROM pet;
+            DELETE FROM client; DELETE FROM groomer; DELETE FROM employee; DELETE FROM retail_item;
+            DELETE FROM daily_revenue; DELETE FROM daily_item_sales; DELETE FROM sqlite_sequence;
+        )", nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        cerr << "❌ Failed to clear template rows: " << errMsg << endl;
+        sqlite3_free(errMsg);
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return 1;
+    }
+
+    cout << "Generating " << outPath << " (seed " << size.seed << ")" << endl;
+    mt19937 random(size.seed);
+    long long rows = 0;
+    bool ok = true;
+    auto start = chrono::steady_clock::now();
+    auto report = [&](const char* table, long long count) {
+        if (ok) cout << "  " << table << ": " << count << " rows" << endl;
+    };
+
+    // Reference tables first so every foreign key below points at an existing row
+    {
+        CachedStatement stmt(db, "INSERT INTO employee (employee_id, employee_name, job_title, contact_information) VALUES (?, ?, ?, ?);");
+        for (long long id = 1; ok && stmt && id <= size.employees; id++) {
+            string first = pickWord(random, GEN_FIRST_NAMES), last = pickWord(random, GEN_LAST_NAMES);
+            string email = first + "." + last + to_string(id) + "@kennel.example.com";
+            transform(email.begin(), email.end(), email.begin(), [](unsigned char c) { return tolower(c); });
+            sqlite3_bind_int64(stmt, 1, id);
+            sqlite3_bind_text(stmt, 2, (first + " " + last).c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, pickWord(random, GEN_JOB_TITLES), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 4, email.c_str(), -1, SQLITE_TRANSIENT);
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("employee", size.employees);
+    }
+    {
+        CachedStatement stmt(db, "INSERT INTO groomer (groomer_id, groomer_name, contact_information, schedule) VALUES (?, ?, ?, ?);");
+        for (long long id = 1; ok && stmt && id <= size.groomers; id++) {
+            string name = string(pickWord(random, GEN_FIRST_NAMES)) + " " + pickWord(random, GEN_LAST_NAMES);
+            string phone = "555-" + to_string(1000 + random() % 9000);
+            sqlite3_bind_int64(stmt, 1, id);
+            sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, phone.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 4, pickWord(random, GEN_SCHEDULES), -1, SQLITE_STATIC);
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("groomer", size.groomers);
+    }
+    vector<double> prices; // Price of each retail item, so ledger amounts match their items
+    {
+        CachedStatement stmt(db, "INSERT INTO retail_item (item_id, item_name, category, price, stock_level) VALUES (?, ?, ?, ?, ?);");
+        const size_t baseItems = sizeof(GEN_RETAIL_ITEMS) / sizeof(GEN_RETAIL_ITEMS[0]);
+        for (long long id = 1; ok && stmt && id <= size.retailItems; id++) {
+            const auto& base = GEN_RETAIL_ITEMS[(id - 1) % baseItems];
+            string name = id <= static_cast<long long>(baseItems) ? base.name : string(base.name) + " #" + to_string((id - 1) / baseItems + 1);
+            double price = round(base.price * (0.8 + (random() % 41) / 100.0) * 100) / 100;
+            prices.push_back(price);
+            sqlite3_bind_int64(stmt, 1, id);
+            sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, base.category, -1, SQLITE_STATIC);
+            sqlite3_bind_double(stmt, 4, price);
+            sqlite3_bind_int(stmt, 5, 20 + static_cast<int>(random() % 500));
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("retail_item", size.retailItems);
+    }
+    {
+        CachedStatement stmt(db, "INSERT INTO client (client_id, client_name, phone, email, client_address) VALUES (?, ?, ?, ?, ?);");
+        for (long long id = 1; ok && stmt && id <= size.clients; id++) {
+            string first = pickWord(random, GEN_FIRST_NAMES), last = pickWord(random, GEN_LAST_NAMES);
+            string phone = to_string(200 + random() % 800) + "-555-" + to_string(1000 + random() % 9000);
+            string email = first + "." + last + to_string(id) + "@example.com";
+            transform(email.begin(), email.end(), email.begin(), [](unsigned char c) { return tolower(c); });
+            string address = to_string(1 + random() % 9999) + " " + pickWord(random, GEN_STREETS);
+            sqlite3_bind_int64(stmt, 1, id);
+            sqlite3_bind_text(stmt, 2, (first + " " + last).c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, phone.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 4, email.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 5, address.c_str(), -1, SQLITE_TRANSIENT);
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("client", size.clients);
+    }
+    vector<int> petOwners; // Owner of each pet, so boarding rows name the pet's real owner
+    petOwners.reserve(static_cast<size_t>(size.pets));
+    {
+        CachedStatement stmt(db, R"(
+            INSERT INTO pet (pet_id, pet_name, breed, age, medical_condition, diet_restriction, friendly, emergency_contact, client_id)
+            VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);
+        )");
+        for (long long id = 1; ok && stmt && id <= size.pets; id++) {
+            // The first pass gives every client a pet, the rest go to random clients
+            int owner = id <= size.clients ? static_cast<int>(id) : static_cast<int>(1 + random() % size.clients);
+            petOwners.push_back(owner);
+            string contact = "555-" + to_string(1000 + random() % 9000);
+            sqlite3_bind_int64(stmt, 1, id);
+            sqlite3_bind_text(stmt, 2, pickWord(random, GEN_PET_NAMES), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 3, pickWord(random, GEN_BREEDS), -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 4, 1 + static_cast<int>(random() % 15));
+            sqlite3_bind_text(stmt, 5, pickWord(random, GEN_CONDITIONS), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 6, pickWord(random, GEN_DIETS), -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 7, random() % 10 < 8 ? 1 : 0);
+            sqlite3_bind_text(stmt, 8, contact.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, 9, owner);
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("pet", size.pets);
+    }
+    {
+        CachedStatement stmt(db, "INSERT INTO medical_record (pet_id, vaccine_record, date_of_last_update, medical_history) VALUES (?, ?, ?, ?);");
+        for (long long n = 0; ok && stmt && n < size.medicalRecords; n++) {
+            sqlite3_bind_int64(stmt, 1, n < size.pets ? n + 1 : static_cast<long long>(1 + random() % size.pets));
+            sqlite3_bind_text(stmt, 2, pickWord(random, GEN_VACCINES), -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 3, generatedDate(random() % GENERATED_DAYS));
+            sqlite3_bind_text(stmt, 4, pickWord(random, GEN_HISTORIES), -1, SQLITE_STATIC);
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("medical_record", size.medicalRecords);
+    }
+    {
+        CachedStatement stmt(db, "INSERT INTO grooming_appointment (grooming_date, grooming_time, client_id, groomer_id) VALUES (?, ?, ?, ?);");
+        for (long long n = 0; ok && stmt && n < size.groomingAppointments; n++) {
+            sqlite3_bind_int(stmt, 1, generatedDate(random() % GENERATED_DAYS));
+            sqlite3_bind_int(stmt, 2, generatedTime(random));
+            sqlite3_bind_int64(stmt, 3, static_cast<long long>(1 + random() % size.clients));
+            sqlite3_bind_int64(stmt, 4, static_cast<long long>(1 + random() % size.groomers));
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("grooming_appointment", size.groomingAppointments);
+    }
+    {
+        CachedStatement stmt(db, "INSERT INTO boarding_reservation (check_in, check_out, client_id, pet_id, amount) VALUES (?, ?, ?, ?, ?);");
+        for (long long n = 0; ok && stmt && n < size.boardingReservations; n++) {
+            long long day = random() % GENERATED_DAYS;
+            int nights = 1 + static_cast<int>(random() % 14);
+            size_t pet = random() % petOwners.size();
+            sqlite3_bind_int(stmt, 1, generatedDate(day));
+            sqlite3_bind_int(stmt, 2, generatedDate(day + nights));
+            sqlite3_bind_int(stmt, 3, petOwners[pet]);
+            sqlite3_bind_int64(stmt, 4, static_cast<long long>(pet + 1));
+            sqlite3_bind_double(stmt, 5, nights * 35.0);
+            ok = stepGeneratedRow(db, stmt, rows);
+        }
+        ok = ok && stmt;
+        report("boarding_reservation", size.boardingReservations);
+    }
+    // Ledger rows in date order as a real till would write them; retail sales get 1-4 items
+    // and an amount equal to their items, services have no items
+    long long ledgerItems = 0;
+    {
+        CachedStatement ledgerStmt(db, R"(
+            INSERT INTO general_ledger (general_ledger_id, ledger_date, ledger_time, item_or_service_purchase, amount, discount, payment_method, client_id, employee_id)
+            VALUES (?, ?, ?, ?, ?, 0.0, ?, ?, ?);
+        )");
+        CachedStatement itemStmt(db, "INSERT INTO ledger_item (ledger_id, item_id, quantity) VALUES (?, ?, ?);");
+        for (long long id = 1; ok && ledgerStmt && itemStmt && id <= size.ledgerRows; id++) {
+            int kind = static_cast<int>(random() % 10);
+            const char* purchase = kind < 7 ? "Retail Sale" : kind < 9 ? "Grooming Service" : "Boarding Service";
+            double amount = kind < 7 ? 0.0 : kind < 9 ? 50.0 : 35.0 * (1 + random() % 14);
+            int itemCount = kind < 7 ? 1 + static_cast<int>(random() % 4) : 0;
+            SaleLine lines[4];
+            for (int i = 0; i < itemCount; i++) {
+                size_t item = random() % prices.size();
+                lines[i] = {static_cast<int>(item + 1), 1 + static_cast<int>(random() % 3)};
+                amount += prices[item] * lines[i].quantity;
+            }
+            sqlite3_bind_int64(ledgerStmt, 1, id);
+            sqlite3_bind_int(ledgerStmt, 2, generatedDate((id - 1) * GENERATED_DAYS / size.ledgerRows));
+            sqlite3_bind_int(ledgerStmt, 3, generatedTime(random));
+            sqlite3_bind_text(ledgerStmt, 4, purchase, -1, SQLITE_STATIC);
+            sqlite3_bind_double(ledgerStmt, 5, round(amount * 100) / 100);
+            sqlite3_bind_text(ledgerStmt, 6, pickWord(random, GEN_PAYMENT_METHODS), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(ledgerStmt, 7, static_cast<long long>(1 + random() % size.clients));
+            sqlite3_bind_int64(ledgerStmt, 8, static_cast<long long>(1 + random() % size.employees));
+            ok = stepGeneratedRow(db, ledgerStmt, rows);
+            // Items after their ledger row, which the item rollup trigger reads the date from
+            for (int i = 0; ok && i < itemCount; i++) {
+                sqlite3_bind_int64(itemStmt, 1, id);
+                sqlite3_bind_int(itemStmt, 2, lines[i].itemId);
+                sqlite3_bind_int(itemStmt, 3, lines[i].quantity);
+                ok = stepGeneratedRow(db, itemStmt, rows);
+                ledgerItems++;
+            }
+            if (ok && id % 1000000 == 0) cout << "  general_ledger: " << id << " rows so far..." << endl;
+        }
+        ok = ok && ledgerStmt && itemStmt;
+        report("general_ledger", size.ledgerRows);
+        report("ledger_item", ledgerItems);
+    }
+
+    ok = ok && runCachedStatement(db, "COMMIT;");
+    if (ok) {
+        cout << "Updating planner statistics..." << endl;
+        ok = sqlite3_exec(db, "ANALYZE;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (!ok) cerr << "❌ Generation failed: " << sqlite3_errmsg(db) << endl;
+    clearStatementCache(db);
+    sqlite3_close(db);
+    if (!ok) {
+        remove(outPath);
+        return 1;
+    }
+    // A log left beside an earlier file of this name describes rows that are gone
+    ChangeLog(string(outPath) + CHANGE_LOG_SUFFIX).resync();
+    printf("✅ %lld rows in %.1f s (%.0f rows/sec)\n", rows, seconds, rows / seconds);
+    return 0;
+}
+
+// Latency samples of one benchmarked operation
+struct OperationTimings {
+    const char* name;
+    vector<double> micros;
+    int errors = 0;
+};
+
+// Prints ops/sec, p50 and p99 for one operation, sorting its samples
+static void printOperationTimings(OperationTimings& timings) {
+    vector<double>& micros = timings.micros;
+    sort(micros.begin(), micros.end());
+    double total = 0;
+    for (double sample : micros) total += sample;
+    auto percentile = [&](double p) {
+        return micros.empty() ? 0.0 : micros[min(micros.size() - 1, static_cast<size_t>(p * micros.size()))] / 1000.0;
+    };
+    printf("%-16s | %9.0f | %8.3f | %8.3f | %d\n", timings.name, total > 0 ? micros.size() / (total / 1e6) : 0.0,
+           percentile(0.50), percentile(0.99), timings.errors);
+}
+
+// Runs every headless operation iterations times against dbPath and reports per-operation latency.
+// Changes the database (adds sales, adds and removes its own clients and pets), so it refuses the real one
+int runBenchmarkSuite(const char* dbPath, int iterations) {
+    if (string(dbPath) == "kennel_project.db") {
+        cerr << "❌ --bench writes to the database it measures; make one with --generate first" << endl;
+        return 1;
+    }
+    sqlite3* db;
+    if (sqlite3_open_v2(dbPath, &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        cerr << "Failed to open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    enableProfiling(db);
+    applyTuningProfile(db);
+    if (!runMigrations(db) || !attachArchives(db)) {
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return 1;
+    }
+    long long clientCount = 0, itemCount = 0, employeeCount = 0;
+    {
+        CachedStatement count(db, "SELECT (SELECT MAX(client_id) FROM client), (SELECT MAX(item_id) FROM retail_item), (SELECT MAX(employee_id) FROM employee);");
+        if (count && sqlite3_step(count) == SQLITE_ROW) {
+            clientCount = sqlite3_column_int64(count, 0);
+            itemCount = sqlite3_column_int64(count, 1);
+            employeeCount = sqlite3_column_int64(count, 2);
+        }
+    }
+    if (clientCount < 1 || itemCount < 1 || employeeCount < 1) {
+        cerr << "❌ " << dbPath << " needs at least one client, retail item and employee" << endl;
+        clearStatementCache(db);
+        sqlite3_close(db);
+        return 1;
+    }
+    // Enough stock that every benchmark sale goes through
+    string stockSQL = "UPDATE retail_item SET stock_level = stock_level + " + to_string(iterations * 9LL) + ";";
+    sqlite3_exec(db, stockSQL.c_str(), nullptr, nullptr, nullptr);
+
+    cout << "Benchmarking " << iterations << " calls of each operation on " << dbPath << " (" << clientCount << " clients)" << endl;
+    mt19937 random(99);
+    vector<sqlite3_int64> clientIds, petIds; // Rows the benchmark created, updated and then deletes
+    vector<OperationTimings> results;
+    auto timeOperation = [&](const char* name, auto&& operation) {
+        OperationTimings timings{name, {}};
+        timings.micros.reserve(iterations);
+        for (int i = 0; i < iterations; i++) {
+            auto start = chrono::steady_clock::now();
+            bool ok = operation(i);
+            timings.micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            if (!ok) timings.errors++;
+        }
+        results.push_back(move(timings));
+    };
+    auto randomClient = [&] { return static_cast<sqlite3_int64>(1 + random() % clientCount); };
+
+    timeOperation("add_client", [&](int i) {
+        ClientRecord client{"Bench Client " + to_string(i), "555-0000", "bench@example.com", "1 Bench St"};
+        sqlite3_int64 id = insertClient(db, client);
+        if (id > 0) clientIds.push_back(id);
+        return id > 0;
+    });
+    timeOperation("add_pet", [&](int i) {
+        PetRecord pet{"Bench Pet " + to_string(i), "Mixed", 3, "None", "None", 1, "555-0000",
+                      static_cast<int>(clientIds.empty() ? 1 : clientIds[i % clientIds.size()])};
+        sqlite3_int64 id = insertPet(db, pet);
+        if (id > 0) petIds.push_back(id);
+        return id > 0;
+    });
+    timeOperation("update_client", [&](int i) {
+        if (clientIds.empty()) return false;
+        ClientRecord client{"Bench Client " + to_string(i) + " Updated", "555-0001", "bench2@example.com", "2 Bench St"};
+        return updateClientRecord(db, static_cast<int>(clientIds[i % clientIds.size()]), client) == 1;
+    });
+    timeOperation("update_pet", [&](int i) {
+        if (petIds.empty() || clientIds.empty()) return false;
+        PetRecord pet{"Bench Pet " + to_string(i) + " Updated", "Mixed", 4, "None", "Grain-Free", 1, "555-0001",
+                      static_cast<int>(clientIds[i % clientIds.size()])};
+        return updatePetRecord(db, static_cast<int>(petIds[i % petIds.size()]), pet) == 1;
+    });
+    timeOperation("sale", [&](int) {
+        Sale sale{static_cast<int>(randomClient()), static_cast<int>(1 + random() % employeeCount), 20250101, 1200, "Card", {}};
+        int lines = 1 + static_cast<int>(random() % 3);
+        for (int l = 0; l < lines; l++) sale.items.push_back({static_cast<int>(1 + random() % itemCount), 1 + static_cast<int>(random() % 3)});
+        float total = 0;
+        string error;
+        return processSale(db, sale, total, error);
+    });
+    vector<PageRow> page;
+    timeOperation("boarding_page", [&](int) {
+        return fetchPagedList(db, BOARDING_HISTORY_LIST, randomClient(), "", nullptr, false, page);
+    });
+    // A check-in: the first lookup reads the profile, repeats during the visit come from the cache
+    vector<int> visitClients;
+    timeOperation("client_profile", [&](int) {
+        visitClients.push_back(static_cast<int>(randomClient()));
+        shared_ptr<const ClientProfile> profile;
+        return fetchClientProfile(db, visitClients.back(), profile);
+    });
+    timeOperation("profile_repeat", [&](int i) { // Within the cache's size, so every lookup is a hit
+        size_t recentVisits = min(visitClients.size(), PROFILE_CACHE_SIZE / 2);
+        shared_ptr<const ClientProfile> profile;
+        return fetchClientProfile(db, visitClients[visitClients.size() - 1 - i % recentVisits], profile);
+    });
+    timeOperation("grooming_page", [&](int) {
+        return fetchPagedList(db, GROOMING_APPOINTMENTS_LIST, 0, "", nullptr, false, page);
+    });
+    timeOperation("client_pick_list", [&](int) {
+        return fetchPagedList(db, CLIENT_PICK_LIST, 0, pickWord(random, GEN_FIRST_NAMES), nullptr, false, page);
+    });
+    timeOperation("search", [&](int) {
+        ostringstream out;
+        string text = string(pickWord(random, GEN_PET_NAMES)) + " " + pickWord(random, GEN_BREEDS);
+        return writeSearchResults(db, text, out) >= 0;
+    });
+    GroomingSchedule schedule;
+    if (!loadGroomingSchedule(db, schedule)) cerr << "❌ Failed to load the grooming schedule: " << sqlite3_errmsg(db) << endl;
+    timeOperation("free_slots", [&](int) {
+        return !findFreeSlots(schedule, schedule.firstDate, 800, 10).empty();
+    });
+    // Whole-hour starts only, so no two of the slots booked here overlap each other
+    vector<FreeSlot> openSlots;
+    for (const FreeSlot& slot : findFreeSlots(schedule, schedule.firstDate, 800, iterations * 4)) {
+        if (slot.time % 100 == 0) openSlots.push_back(slot);
+    }
+    timeOperation("book_grooming", [&](int i) {
+        if (i >= static_cast<int>(openSlots.size())) return false;
+        string error;
+        const FreeSlot& slot = openSlots[i];
+        return bookGroomingAppointment(db, schedule, static_cast<int>(randomClient()), slot.groomerId, slot.date, slot.time, error) > 0;
+    });
+    BoardingOccupancy occupancy;
+    if (!syncBoardingOccupancy(db, occupancy)) cerr << "❌ Failed to load boarding reservations: " << sqlite3_errmsg(db) << endl;
+    vector<int> nightCounts;
+    timeOperation("occupancy_90", [&](int) {
+        nightlyOccupancy(occupancy, todayDate(), 90, nightCounts);
+        return true;
+    });
+    // Stays are booked for existing pets, so the benchmark's own pets can still be deleted below
+    vector<pair<int, int>> boardingPets; // pet_id, client_id
+    {
+        CachedStatement pets(db, "SELECT pet_id, client_id FROM pet WHERE client_id IN (SELECT client_id FROM client) LIMIT 1000;");
+        while (pets && sqlite3_step(pets) == SQLITE_ROW) boardingPets.push_back({sqlite3_column_int(pets, 0), sqlite3_column_int(pets, 1)});
+    }
+    timeOperation("book_boarding", [&](int) {
+        if (boardingPets.empty()) return false;
+        int checkIn = dateOfDay(dayNumber(todayDate()) + 1 + static_cast<int>(random() % 300));
+        int checkOut = dateOfDay(dayNumber(checkIn) + 1 + static_cast<int>(random() % 7));
+        string error;
+        const auto& pet = boardingPets[random() % boardingPets.size()];
+        return bookBoardingReservation(db, occupancy, pet.second, pet.first, checkIn, checkOut, 50.0, error) > 0;
+    });
+    timeOperation("delete_pet", [&](int i) {
+        return i < static_cast<int>(petIds.size()) && deletePetRecord(db, static_cast<int>(petIds[i])) == 1;
+    });
+    timeOperation("delete_client", [&](int i) {
+        return i < static_cast<int>(clientIds.size()) && deleteClientRecord(db, static_cast<int>(clientIds[i])) == 1;
+    });
+
+    cout << "\nOperation        |   Ops/sec | p50 (ms) | p99 (ms) | Errors" << endl;
+    for (OperationTimings& timings : results) printOperationTimings(timings);
+
+    clearStatementCache(db);
+    sqlite3_close(db);
+    return 0;
+}
+
+// Writes/sec and commit latency for each durability mode: terminals threads each make writesPerTerminal
+// writes (alternating new clients and sales) and wait for each to commit, as server terminals do.
+// The last row posts the same writes without waiting, as the menu does in batched mode
+int runDurabilityBenchmark(const char* dbPath, int writesPerTerminal, int terminals) {
+    if (string(dbPath) == "kennel_project.db") {
+        cerr << "❌ --bench-durability writes to the database it measures; make one with --generate first" << endl;
+        return 1;
+    }
+    cout << "Benchmarking " << writesPerTerminal << " writes from each of " << terminals << " terminals on " << dbPath << endl;
+    cout << "\nDurability       |  Writes/sec | p50 (ms) | p99 (ms) | Errors" << endl;
+    struct Pass {
+        Durability durability;
+        bool wait;
+        const char* name;
+    };
+    for (Pass pass : {Pass{DURABILITY_FULL, true, "full"}, Pass{DURABILITY_NORMAL, true, "normal"},
+                      Pass{DURABILITY_BATCHED, true, "batched"}, Pass{DURABILITY_BATCHED, false, "batched (async)"}}) {
+        sqlite3* db;
+        if (sqlite3_open_v2(dbPath, &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+            cerr << "Failed to open database: " << sqlite3_errmsg(db) << endl;
+            sqlite3_close(db);
+            return 1;
+        }
+        sqlite3_busy_timeout(db, 5000);
+        applyTuningProfile(db);
+        if (!runMigrations(db) || sqlite3_exec(db, "PRAGMA journal_mode = WAL;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            clearStatementCache(db);
+            sqlite3_close(db);
+            return 1;
+        }
+        string stockSQL = "UPDATE retail_item SET stock_level = stock_level + " + to_string(writesPerTerminal * terminals * 2LL) + ";";
+        sqlite3_exec(db, stockSQL.c_str(), nullptr, nullptr, nullptr);
+
+        mutex dbMutex, timingsMutex;
+        OperationTimings timings{pass.name, {}};
+        atomic<int> errors(0);
+        auto makeWrite = [](int terminal, int i) -> WriteOperation {
+            if (i % 2 == 0) {
+                ClientRecord client{"Durability Client " + to_string(terminal) + "-" + to_string(i), "555-0000", "bench@example.com", "1 Bench St"};
+                return [client](sqlite3* db) { return insertClient(db, client) > 0; };
+            }
+            Sale sale{1, 1, 20250101, 1200, "Card", {{1, 1}}};
+            return [sale](sqlite3* db) {
+                float total = 0;
+                string error;
+                return processSale(db, sale, total, error);
+            };
+        };
+        auto record = [&](chrono::steady_clock::time_point start, bool ok) {
+            double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+            lock_guard<mutex> lock(timingsMutex);
+            timings.micros.push_back(micros);
+            if (!ok) errors++;
+        };
+
+        auto started = chrono::steady_clock::now();
+        {
+            GroupCommitWriter writes(db, dbMutex, pass.durability);
+            if (pass.wait) {
+                vector<thread> pool;
+                for (int t = 0; t < terminals; t++) {
+                    pool.emplace_back([&, t] {
+                        for (int i = 0; i < writesPerTerminal; i++) {
+                            auto start = chrono::steady_clock::now();
+                            record(start, writes.run(makeWrite(t, i)));
+                        }
+                    });
+                }
+                for (thread& terminal : pool) terminal.join();
+            } else {
+                for (int i = 0; i < writesPerTerminal * terminals; i++) {
+                    auto start = chrono::steady_clock::now();
+                    writes.post(makeWrite(0, i), [&record, start](bool ok) { record(start, ok); });
+                }
+                writes.flush();
+            }
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        vector<double>& micros = timings.micros;
+        sort(micros.begin(), micros.end());
+        auto percentile = [&](double p) {
+            return micros.empty() ? 0.0 : micros[min(micros.size() - 1, static_cast<size_t>(p * micros.size()))] / 1000.0;
+        };
+        printf("%-16s | %11.0f | %8.3f | %8.3f | %d\n", pass.name, micros.size() / seconds, percentile(0.50),
+               percentile(0.99), errors.load());
+        clearStatementCache(db);
+        sqlite3_close(db);
+    }
+    return 0;
 }